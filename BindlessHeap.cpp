@@ -0,0 +1,244 @@
+#include "BindlessHeap.h"
+#include "VkUtil.h"
+#include <algorithm>
+
+BindlessHeap::BindlessHeap()
+	:mDevice(VK_NULL_HANDLE)
+	,mSetLayout(VK_NULL_HANDLE)
+	,mDescriptorPool(VK_NULL_HANDLE)
+	,mSet(VK_NULL_HANDLE)
+	,mTables()
+{
+}
+
+void BindlessHeap::Create(VkPhysicalDevice physicalDevice, VkDevice device, PipelineLibrary& library, DeferDestroyFunction deferDestroy)
+{
+    mDevice = device;
+    mDeferDestroy = std::move(deferDestroy);
+
+    VkPhysicalDeviceVulkan12Properties vulkan12Properties{};
+    vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+    VkPhysicalDeviceProperties2 properties{};
+    properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties.pNext = &vulkan12Properties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    // 스테이지당 한도와 세트 한도 중 작은 쪽
+    mTables[BINDING_TEXTURES].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    mTables[BINDING_TEXTURES].capacity = std::min({ static_cast<uint32_t>(MAX_TEXTURES),
+        vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages });
+    mTables[BINDING_SAMPLERS].type = VK_DESCRIPTOR_TYPE_SAMPLER;
+    mTables[BINDING_SAMPLERS].capacity = std::min({ static_cast<uint32_t>(MAX_SAMPLERS),
+        vulkan12Properties.maxDescriptorSetUpdateAfterBindSamplers, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSamplers });
+    mTables[BINDING_BUFFERS].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    mTables[BINDING_BUFFERS].capacity = std::min({ static_cast<uint32_t>(MAX_BUFFERS),
+        vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers, vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers });
+
+    // 모든 테이블이 같은 스테이지에 보이므로 합계도 스테이지당 전체 리소스 한도 안에
+    uint64_t total = 0;
+    for (const Table& table : mTables)
+    {
+        total += table.capacity;
+    }
+    uint32_t limit = vulkan12Properties.maxPerStageUpdateAfterBindResources;
+    limit = limit > RESERVED_STAGE_RESOURCES ? limit - RESERVED_STAGE_RESOURCES : 0;
+    if (total > limit)
+    {
+        for (Table& table : mTables)
+        {
+            table.capacity = static_cast<uint32_t>(table.capacity * static_cast<uint64_t>(limit) / total);
+        }
+    }
+    for (Table& table : mTables)
+    {
+        VkUtil::ExitIfFalse(table.capacity > 0, "bindless descriptor limits too small");
+        table.used.assign(table.capacity, false);
+    }
+
+    // 비어 있는 슬롯이 있어도 되고, 그리는 중에도 쓰지 않는 슬롯은 갱신 가능
+    DescriptorSetLayoutDesc layoutDesc;
+    layoutDesc.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutDesc.bindingCount = BINDING_COUNT;
+    for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+    {
+        layoutDesc.bindings[i].binding = i;
+        layoutDesc.bindings[i].descriptorType = mTables[i].type;
+        layoutDesc.bindings[i].descriptorCount = mTables[i].capacity;
+        layoutDesc.bindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+        layoutDesc.bindingFlags[i] = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    }
+    mSetLayout = library.GetDescriptorSetLayout(layoutDesc);
+
+    VkDescriptorPoolSize poolSizes[BINDING_COUNT]{};
+    for (uint32_t i = 0; i < BINDING_COUNT; ++i)
+    {
+        poolSizes[i].type = mTables[i].type;
+        poolSizes[i].descriptorCount = mTables[i].capacity;
+    }
+
+    VkDescriptorPoolCreateInfo poolCI{};
+    poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCI.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolCI.maxSets = 1;
+    poolCI.poolSizeCount = BINDING_COUNT;
+    poolCI.pPoolSizes = poolSizes;
+    VkResult result = vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &mDescriptorPool);
+    VkUtil::ExitIfFailed(result, "fail vkCreateDescriptorPool (bindless)");
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &mSetLayout;
+    result = vkAllocateDescriptorSets(mDevice, &allocInfo, &mSet);
+    VkUtil::ExitIfFailed(result, "fail vkAllocateDescriptorSets (bindless)");
+}
+
+void BindlessHeap::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+    mDescriptorPool = VK_NULL_HANDLE;
+    mSet = VK_NULL_HANDLE;
+    mSetLayout = VK_NULL_HANDLE;
+    for (Table& table : mTables)
+    {
+        table.next = 0;
+        table.count = 0;
+        table.freeSlots.clear();
+        table.used.clear();
+    }
+    mPendingWrites.clear();
+    mDevice = VK_NULL_HANDLE;
+}
+
+BindlessIndex BindlessHeap::AddTexture(VkImageView view, VkImageLayout layout)
+{
+    BindlessIndex index = allocateSlot(BINDING_TEXTURES);
+    PendingWrite write{};
+    write.binding = BINDING_TEXTURES;
+    write.index = index;
+    write.image.imageView = view;
+    write.image.imageLayout = layout;
+    mPendingWrites.push_back(write);
+    return index;
+}
+
+BindlessIndex BindlessHeap::AddSampler(VkSampler sampler)
+{
+    BindlessIndex index = allocateSlot(BINDING_SAMPLERS);
+    PendingWrite write{};
+    write.binding = BINDING_SAMPLERS;
+    write.index = index;
+    write.image.sampler = sampler;
+    mPendingWrites.push_back(write);
+    return index;
+}
+
+BindlessIndex BindlessHeap::AddBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    BindlessIndex index = allocateSlot(BINDING_BUFFERS);
+    PendingWrite write{};
+    write.binding = BINDING_BUFFERS;
+    write.index = index;
+    write.buffer.buffer = buffer;
+    write.buffer.offset = offset;
+    write.buffer.range = range;
+    mPendingWrites.push_back(write);
+    return index;
+}
+
+void BindlessHeap::Remove(Binding binding, BindlessIndex index)
+{
+    if (index == INVALID_BINDLESS)
+    {
+        return;
+    }
+    Table& table = mTables[binding];
+    VkUtil::ExitIfFalse(index < table.next && table.used[index], "bindless slot removed twice or never added");
+    table.used[index] = false;
+    // 아직 쓰지 않은 디스크립터는 버림
+    mPendingWrites.erase(std::remove_if(mPendingWrites.begin(), mPendingWrites.end(),
+        [binding, index](const PendingWrite& write) { return write.binding == binding && write.index == index; }), mPendingWrites.end());
+    --table.count;
+    // 이미 제출된 프레임이 읽고 있을 수 있으므로 끝난 뒤에 다시 내줌
+    mDeferDestroy([this, binding, index]() { mTables[binding].freeSlots.push_back(index); });
+}
+
+void BindlessHeap::Prepare()
+{
+    if (mPendingWrites.empty())
+    {
+        return;
+    }
+    std::vector<VkWriteDescriptorSet> writes(mPendingWrites.size());
+    for (size_t i = 0; i < mPendingWrites.size(); ++i)
+    {
+        const PendingWrite& pending = mPendingWrites[i];
+        VkWriteDescriptorSet& write = writes[i];
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = mSet;
+        write.dstBinding = pending.binding;
+        write.dstArrayElement = pending.index;
+        write.descriptorCount = 1;
+        write.descriptorType = mTables[pending.binding].type;
+        if (pending.binding == BINDING_BUFFERS)
+        {
+            write.pBufferInfo = &pending.buffer;
+        }
+        else
+        {
+            write.pImageInfo = &pending.image;
+        }
+    }
+    vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    mPendingWrites.clear();
+}
+
+void BindlessHeap::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t setIndex) const
+{
+    vkCmdBindDescriptorSets(cmd, bindPoint, layout, setIndex, 1, &mSet, 0, nullptr);
+}
+
+VkDescriptorSetLayout BindlessHeap::GetSetLayout() const
+{
+    return mSetLayout;
+}
+
+VkDescriptorSet BindlessHeap::GetSet() const
+{
+    return mSet;
+}
+
+uint32_t BindlessHeap::GetCount(Binding binding) const
+{
+    return mTables[binding].count;
+}
+
+uint32_t BindlessHeap::GetCapacity(Binding binding) const
+{
+    return mTables[binding].capacity;
+}
+
+BindlessIndex BindlessHeap::allocateSlot(Binding binding)
+{
+    Table& table = mTables[binding];
+    BindlessIndex index;
+    if (table.freeSlots.empty() == false)
+    {
+        index = table.freeSlots.back();
+        table.freeSlots.pop_back();
+    }
+    else
+    {
+        VkUtil::ExitIfFalse(table.next < table.capacity, "bindless descriptor table is full");
+        index = table.next++;
+    }
+    table.used[index] = true;
+    ++table.count;
+    return index;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "PipelineLibrary.h"
+#include "DeletionQueue.h"
+
+typedef uint32_t BindlessIndex;
+const BindlessIndex INVALID_BINDLESS = UINT32_MAX;
+
+// One update-after-bind descriptor set holding every sampled image, sampler and
+// storage buffer. Shaders index the arrays with slots taken from push constants or
+// instance data, so the set is bound once per command buffer instead of per draw.
+class BindlessHeap
+{
+public:
+	enum Binding
+	{
+		BINDING_TEXTURES = 0,
+		BINDING_SAMPLERS = 1,
+		BINDING_BUFFERS = 2,
+		BINDING_COUNT = 3
+	};
+
+	enum
+	{
+		// clamped to the device's update-after-bind limits
+		MAX_TEXTURES = 16384,
+		MAX_SAMPLERS = 256,
+		MAX_BUFFERS = 8192,
+		// per stage resources left to the other sets of a pipeline layout and the attachments
+		RESERVED_STAGE_RESOURCES = 32
+	};
+
+	BindlessHeap();
+
+	// the device must have descriptor indexing with update-after-bind enabled;
+	// deferDestroy hands removed slots back, its pending entries must run before Destroy()
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, PipelineLibrary& library, DeferDestroyFunction deferDestroy);
+	void Destroy();
+
+	// the descriptor is written at the next Prepare(); the slot stays valid until removed
+	BindlessIndex AddTexture(VkImageView view, VkImageLayout layout);
+	BindlessIndex AddSampler(VkSampler sampler);
+	BindlessIndex AddBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+	// the slot is handed out again once the GPU work submitted so far has finished
+	void Remove(Binding binding, BindlessIndex index);
+
+	// once per frame before recording, writes the pending descriptors
+	void Prepare();
+	void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t setIndex) const;
+
+	VkDescriptorSetLayout GetSetLayout() const;
+	VkDescriptorSet GetSet() const;
+	uint32_t GetCount(Binding binding) const;
+	uint32_t GetCapacity(Binding binding) const;
+
+private:
+	struct Table
+	{
+		VkDescriptorType type;
+		uint32_t capacity;
+		// slots below this have been handed out at least once
+		uint32_t next;
+		uint32_t count;
+		std::vector<BindlessIndex> freeSlots;
+		// per slot, catches a slot removed twice
+		std::vector<bool> used;
+	};
+
+	struct PendingWrite
+	{
+		Binding binding;
+		BindlessIndex index;
+		VkDescriptorImageInfo image;
+		VkDescriptorBufferInfo buffer;
+	};
+
+	VkDevice mDevice;
+	DeferDestroyFunction mDeferDestroy;
+
+	// owned by the PipelineLibrary
+	VkDescriptorSetLayout mSetLayout;
+	VkDescriptorPool mDescriptorPool;
+	VkDescriptorSet mSet;
+
+	Table mTables[BINDING_COUNT];
+	std::vector<PendingWrite> mPendingWrites;
+
+	BindlessIndex allocateSlot(Binding binding);
+};
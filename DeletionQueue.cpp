@@ -0,0 +1,33 @@
+#include "DeletionQueue.h"
+#include <utility>
+
+void DeletionQueue::Push(uint64_t value, std::function<void()> destroy)
+{
+    mEntries.push_back({ value, std::move(destroy) });
+}
+
+void DeletionQueue::Collect(uint64_t completedValue)
+{
+    // 값이 증가하는 순서로 쌓이므로 앞에서부터 끝난 것만
+    while (mEntries.empty() == false && mEntries.front().value <= completedValue)
+    {
+        std::function<void()> destroy = std::move(mEntries.front().destroy);
+        mEntries.pop_front();
+        destroy();
+    }
+}
+
+void DeletionQueue::Flush()
+{
+    while (mEntries.empty() == false)
+    {
+        std::function<void()> destroy = std::move(mEntries.front().destroy);
+        mEntries.pop_front();
+        destroy();
+    }
+}
+
+size_t DeletionQueue::GetPendingCount() const
+{
+    return mEntries.size();
+}
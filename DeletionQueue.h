@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <functional>
+
+// runs destroy once the GPU no longer uses what it destroys (Renderer::DeferDestroy)
+typedef std::function<void(std::function<void()> destroy)> DeferDestroyFunction;
+
+// Destroys objects once the GPU timeline they were last used on has reached a value,
+// instead of counting frames. Values pushed must not decrease.
+class DeletionQueue
+{
+public:
+	// value : timeline value of the last submission that may use the object
+	void Push(uint64_t value, std::function<void()> destroy);
+	// runs every entry whose value has completed, oldest first
+	void Collect(uint64_t completedValue);
+	// runs everything, the device must be idle
+	void Flush();
+
+	size_t GetPendingCount() const;
+
+private:
+	struct Entry
+	{
+		uint64_t value;
+		std::function<void()> destroy;
+	};
+
+	std::deque<Entry> mEntries;
+};
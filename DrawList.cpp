@@ -0,0 +1,281 @@
+#include "DrawList.h"
+#include <cstring>
+#include <utility>
+
+namespace
+{
+    const uint32_t DEPTH_SHIFT = 0;
+    const uint32_t MESH_SHIFT = DEPTH_SHIFT + DrawList::DEPTH_BITS;
+    const uint32_t MATERIAL_SHIFT = MESH_SHIFT + DrawList::MESH_BITS;
+    const uint32_t PIPELINE_SHIFT = MATERIAL_SHIFT + DrawList::MATERIAL_BITS;
+    const uint32_t PASS_SHIFT = PIPELINE_SHIFT + DrawList::PIPELINE_BITS;
+
+    static_assert(PASS_SHIFT + DrawList::PASS_BITS == 64, "draw key fields must fill 64 bits");
+
+    // 8비트씩 8번
+    const uint32_t RADIX_BITS = 8;
+    const uint32_t RADIX_SIZE = 1u << RADIX_BITS;
+
+    uint64_t field(uint32_t value, uint32_t bits, uint32_t shift)
+    {
+        return (static_cast<uint64_t>(value) & ((1ull << bits) - 1)) << shift;
+    }
+
+    bool isSameSet(const DrawPacket::Set& a, const DrawPacket::Set& b)
+    {
+        return a.set == b.set
+            && a.dynamicOffsetCount == b.dynamicOffsetCount
+            && memcmp(a.dynamicOffsets, b.dynamicOffsets, a.dynamicOffsetCount * sizeof(uint32_t)) == 0;
+    }
+}
+
+void DrawList::BindState::Reset()
+{
+    pipeline = VK_NULL_HANDLE;
+    layout = VK_NULL_HANDLE;
+    for (uint32_t i = 0; i < DrawPacket::MAX_SETS; ++i)
+    {
+        setValid[i] = false;
+    }
+    vertexBuffer = VK_NULL_HANDLE;
+    indexBuffer = VK_NULL_HANDLE;
+    indexType = VK_INDEX_TYPE_UINT16;
+    pushConstantStages = 0;
+    pushConstantOffset = 0;
+    pushConstantSize = 0;
+}
+
+DrawList::DrawList()
+{
+}
+
+uint64_t DrawList::MakeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth)
+{
+    return field(pass, PASS_BITS, PASS_SHIFT)
+        | field(pipeline, PIPELINE_BITS, PIPELINE_SHIFT)
+        | field(material, MATERIAL_BITS, MATERIAL_SHIFT)
+        | field(mesh, MESH_BITS, MESH_SHIFT)
+        | field(depth, DEPTH_BITS, DEPTH_SHIFT);
+}
+
+uint32_t DrawList::GetPass(uint64_t key)
+{
+    return static_cast<uint32_t>(key >> PASS_SHIFT);
+}
+
+void DrawList::Clear()
+{
+    // 용량은 남겨서 매 프레임 재할당하지 않음
+    mPackets.clear();
+    mPushConstantData.clear();
+    mItems.clear();
+}
+
+uint32_t DrawList::AddPushConstants(const void* data, uint32_t size)
+{
+    uint32_t offset = static_cast<uint32_t>(mPushConstantData.size());
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    mPushConstantData.insert(mPushConstantData.end(), bytes, bytes + size);
+    return offset;
+}
+
+void DrawList::Add(uint64_t key, const DrawPacket& packet)
+{
+    mItems.push_back({ key, static_cast<uint32_t>(mPackets.size()) });
+    mPackets.push_back(packet);
+}
+
+void DrawList::Sort()
+{
+    size_t count = mItems.size();
+    if (count <= 1)
+    {
+        return;
+    }
+    mScratch.resize(count);
+
+    // 모든 키에서 같은 자리는 건너뜀 - 대부분 필드가 비어 있거나 같음
+    uint64_t allOr = 0;
+    uint64_t allAnd = ~0ull;
+    for (const Item& item : mItems)
+    {
+        allOr |= item.key;
+        allAnd &= item.key;
+    }
+    uint64_t varying = allOr ^ allAnd;
+
+    Item* src = mItems.data();
+    Item* dst = mScratch.data();
+    for (uint32_t shift = 0; shift < 64; shift += RADIX_BITS)
+    {
+        if (((varying >> shift) & (RADIX_SIZE - 1)) == 0)
+        {
+            continue;
+        }
+
+        uint32_t offsets[RADIX_SIZE] = {};
+        for (size_t i = 0; i < count; ++i)
+        {
+            ++offsets[(src[i].key >> shift) & (RADIX_SIZE - 1)];
+        }
+        uint32_t sum = 0;
+        for (uint32_t digit = 0; digit < RADIX_SIZE; ++digit)
+        {
+            uint32_t digitCount = offsets[digit];
+            offsets[digit] = sum;
+            sum += digitCount;
+        }
+        // 앞에서부터 흩뿌려서 같은 키의 순서 유지
+        for (size_t i = 0; i < count; ++i)
+        {
+            dst[offsets[(src[i].key >> shift) & (RADIX_SIZE - 1)]++] = src[i];
+        }
+        std::swap(src, dst);
+    }
+
+    if (src != mItems.data())
+    {
+        mItems.swap(mScratch);
+    }
+}
+
+size_t DrawList::GetCount() const
+{
+    return mItems.size();
+}
+
+void DrawList::GetPassRange(uint32_t pass, size_t& outBegin, size_t& outEnd) const
+{
+    // 정렬돼 있으므로 패스는 연속
+    outBegin = 0;
+    while (outBegin < mItems.size() && GetPass(mItems[outBegin].key) < pass)
+    {
+        ++outBegin;
+    }
+    outEnd = outBegin;
+    while (outEnd < mItems.size() && GetPass(mItems[outEnd].key) == pass)
+    {
+        ++outEnd;
+    }
+}
+
+void DrawList::Record(VkCommandBuffer cmd, size_t begin, size_t end, BindState& state, DrawListStats& stats) const
+{
+    for (size_t i = begin; i < end; ++i)
+    {
+        const DrawPacket& packet = mPackets[mItems[i].packet];
+
+        if (packet.pipeline != state.pipeline)
+        {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.pipeline);
+            state.pipeline = packet.pipeline;
+            ++stats.pipelineBinds;
+        }
+        else
+        {
+            ++stats.pipelineBindsSkipped;
+        }
+
+        // 레이아웃이 바뀌면 이전에 바인딩한 세트와 푸시 상수는 믿을 수 없음
+        if (packet.layout != state.layout)
+        {
+            for (uint32_t s = 0; s < DrawPacket::MAX_SETS; ++s)
+            {
+                state.setValid[s] = false;
+            }
+            state.pushConstantSize = 0;
+            state.layout = packet.layout;
+        }
+
+        // 바뀐 세트만, 연속된 세트는 한 번에
+        uint32_t s = 0;
+        while (s < packet.setCount)
+        {
+            if (state.setValid[s] && isSameSet(state.sets[s], packet.sets[s]))
+            {
+                ++stats.descriptorBindsSkipped;
+                ++s;
+                continue;
+            }
+            uint32_t first = s;
+            VkDescriptorSet sets[DrawPacket::MAX_SETS];
+            uint32_t dynamicOffsets[DrawPacket::MAX_SETS * DrawPacket::MAX_DYNAMIC_OFFSETS];
+            uint32_t dynamicOffsetCount = 0;
+            while (s < packet.setCount && (state.setValid[s] == false || isSameSet(state.sets[s], packet.sets[s]) == false))
+            {
+                const DrawPacket::Set& set = packet.sets[s];
+                sets[s - first] = set.set;
+                memcpy(dynamicOffsets + dynamicOffsetCount, set.dynamicOffsets, set.dynamicOffsetCount * sizeof(uint32_t));
+                dynamicOffsetCount += set.dynamicOffsetCount;
+                state.sets[s] = set;
+                state.setValid[s] = true;
+                ++stats.descriptorBinds;
+                ++s;
+            }
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, packet.layout, first, s - first, sets, dynamicOffsetCount, dynamicOffsets);
+        }
+
+        if (packet.vertexBuffer != state.vertexBuffer || packet.indexBuffer != state.indexBuffer || packet.indexType != state.indexType)
+        {
+            VkDeviceSize offset = 0;
+            vkCmdBindVertexBuffers(cmd, 0, 1, &packet.vertexBuffer, &offset);
+            vkCmdBindIndexBuffer(cmd, packet.indexBuffer, 0, packet.indexType);
+            state.vertexBuffer = packet.vertexBuffer;
+            state.indexBuffer = packet.indexBuffer;
+            state.indexType = packet.indexType;
+            ++stats.vertexBufferBinds;
+        }
+        else
+        {
+            ++stats.vertexBufferBindsSkipped;
+        }
+
+        if (packet.pushConstantSize > 0)
+        {
+            const uint8_t* data = mPushConstantData.data() + packet.pushConstantOffset;
+            bool same = packet.pushConstantStages == state.pushConstantStages && packet.pushConstantSize == state.pushConstantSize
+                && memcmp(data, mPushConstantData.data() + state.pushConstantOffset, packet.pushConstantSize) == 0;
+            if (same == false)
+            {
+                vkCmdPushConstants(cmd, packet.layout, packet.pushConstantStages, 0, packet.pushConstantSize, data);
+                state.pushConstantStages = packet.pushConstantStages;
+                state.pushConstantOffset = packet.pushConstantOffset;
+                state.pushConstantSize = packet.pushConstantSize;
+                ++stats.pushConstants;
+            }
+            else
+            {
+                ++stats.pushConstantsSkipped;
+            }
+        }
+
+        const DrawCommand& command = packet.command;
+        if (command.indirectBuffer == VK_NULL_HANDLE)
+        {
+            vkCmdDrawIndexed(cmd, command.indexCount, command.instanceCount, command.firstIndex, command.vertexOffset, command.firstInstance);
+        }
+        else if (command.countBuffer != VK_NULL_HANDLE)
+        {
+            vkCmdDrawIndexedIndirectCount(cmd, command.indirectBuffer, command.indirectOffset, command.countBuffer, command.countOffset,
+                command.maxDrawCount, command.stride);
+        }
+        else
+        {
+            vkCmdDrawIndexedIndirect(cmd, command.indirectBuffer, command.indirectOffset, command.maxDrawCount, command.stride);
+        }
+        ++stats.draws;
+    }
+}
+
+void DrawList::AddStats(DrawListStats& total, const DrawListStats& stats)
+{
+    total.draws += stats.draws;
+    total.pipelineBinds += stats.pipelineBinds;
+    total.pipelineBindsSkipped += stats.pipelineBindsSkipped;
+    total.descriptorBinds += stats.descriptorBinds;
+    total.descriptorBindsSkipped += stats.descriptorBindsSkipped;
+    total.vertexBufferBinds += stats.vertexBufferBinds;
+    total.vertexBufferBindsSkipped += stats.vertexBufferBindsSkipped;
+    total.pushConstants += stats.pushConstants;
+    total.pushConstantsSkipped += stats.pushConstantsSkipped;
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <cstdint>
+
+// vkCmdDrawIndexed when indirectBuffer is VK_NULL_HANDLE, otherwise the indirect
+// variant; countBuffer set : the draw count is read from the GPU
+struct DrawCommand
+{
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+
+	VkBuffer indirectBuffer;
+	VkDeviceSize indirectOffset;
+	VkBuffer countBuffer;
+	VkDeviceSize countOffset;
+	uint32_t maxDrawCount;
+	uint32_t stride;
+};
+
+// everything a draw binds, compared against what is already bound while recording
+struct DrawPacket
+{
+	enum
+	{
+		MAX_SETS = 4,
+		MAX_DYNAMIC_OFFSETS = 2
+	};
+
+	struct Set
+	{
+		VkDescriptorSet set;
+		uint32_t dynamicOffsetCount;
+		uint32_t dynamicOffsets[MAX_DYNAMIC_OFFSETS];
+	};
+
+	VkPipeline pipeline;
+	VkPipelineLayout layout;
+	// bound from set 0
+	uint32_t setCount;
+	Set sets[MAX_SETS];
+	VkBuffer vertexBuffer;
+	VkBuffer indexBuffer;
+	VkIndexType indexType;
+	// range in the list's push constant data, from DrawList::AddPushConstants()
+	VkShaderStageFlags pushConstantStages;
+	uint32_t pushConstantOffset;
+	uint32_t pushConstantSize;
+	DrawCommand command;
+};
+
+struct DrawListStats
+{
+	uint64_t draws;
+	uint64_t pipelineBinds;
+	uint64_t pipelineBindsSkipped;
+	// counted per set
+	uint64_t descriptorBinds;
+	uint64_t descriptorBindsSkipped;
+	// vertex and index buffer counted as one
+	uint64_t vertexBufferBinds;
+	uint64_t vertexBufferBindsSkipped;
+	uint64_t pushConstants;
+	uint64_t pushConstantsSkipped;
+};
+
+// Draws of a frame, each with a 64-bit key (pass, pipeline, material, mesh, depth from
+// the most significant bits). Sort() orders them with an LSD radix sort, which keeps
+// draws with equal keys in the order they were added, so recording walks the state
+// changes in order and only binds what differs from the previous draw.
+class DrawList
+{
+public:
+	enum
+	{
+		PASS_BITS = 4,
+		PIPELINE_BITS = 12,
+		MATERIAL_BITS = 16,
+		MESH_BITS = 16,
+		DEPTH_BITS = 16
+	};
+
+	// what is bound on a command buffer, reset when the command buffer begins or
+	// after vkCmdExecuteCommands
+	struct BindState
+	{
+		VkPipeline pipeline;
+		VkPipelineLayout layout;
+		DrawPacket::Set sets[DrawPacket::MAX_SETS];
+		bool setValid[DrawPacket::MAX_SETS];
+		VkBuffer vertexBuffer;
+		VkBuffer indexBuffer;
+		VkIndexType indexType;
+		VkShaderStageFlags pushConstantStages;
+		uint32_t pushConstantOffset;
+		uint32_t pushConstantSize;
+
+		void Reset();
+	};
+
+	DrawList();
+
+	// fields wider than their bits are truncated; depth : 0 nearest, front to back
+	static uint64_t MakeKey(uint32_t pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint32_t depth);
+	static uint32_t GetPass(uint64_t key);
+
+	void Clear();
+	// returns the offset to put in DrawPacket::pushConstantOffset
+	uint32_t AddPushConstants(const void* data, uint32_t size);
+	void Add(uint64_t key, const DrawPacket& packet);
+	void Sort();
+
+	size_t GetCount() const;
+	// sorted draws of one pass, [outBegin, outEnd)
+	void GetPassRange(uint32_t pass, size_t& outBegin, size_t& outEnd) const;
+	// safe from several threads, each with its own state and stats
+	void Record(VkCommandBuffer cmd, size_t begin, size_t end, BindState& state, DrawListStats& stats) const;
+
+	static void AddStats(DrawListStats& total, const DrawListStats& stats);
+
+private:
+	struct Item
+	{
+		uint64_t key;
+		uint32_t packet;
+	};
+
+	std::vector<DrawPacket> mPackets;
+	std::vector<uint8_t> mPushConstantData;
+	std::vector<Item> mItems;
+	std::vector<Item> mScratch;
+};
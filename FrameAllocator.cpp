@@ -0,0 +1,168 @@
+#include "FrameAllocator.h"
+#include "VkUtil.h"
+#include <algorithm>
+
+FrameAllocator::FrameAllocator()
+	:mDevice(VK_NULL_HANDLE)
+	,mAllocator(nullptr)
+	,mAlignment(1)
+	,mUniformRange(0)
+	,mStorageRange(0)
+	,mBuffer(VK_NULL_HANDLE)
+	,mAllocation(nullptr)
+	,mRegionSize(0)
+	,mRegionBegin(0)
+	,mHead(0)
+	,mPeakBytes(0)
+	,mSetLayout(VK_NULL_HANDLE)
+	,mDescriptorPool(VK_NULL_HANDLE)
+	,mSet(VK_NULL_HANDLE)
+{
+}
+
+void FrameAllocator::Create(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, PipelineLibrary& library,
+    uint32_t frameSlotCount, VkDeviceSize regionSize)
+{
+    mDevice = device;
+    mAllocator = &allocator;
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    // 모든 할당이 두 바인딩 어느 쪽의 동적 오프셋으로도 쓰일 수 있게
+    mAlignment = std::max<VkDeviceSize>({ properties.limits.minUniformBufferOffsetAlignment,
+        properties.limits.minStorageBufferOffsetAlignment, 1 });
+    mRegionSize = (regionSize + mAlignment - 1) / mAlignment * mAlignment;
+    mUniformRange = std::min<VkDeviceSize>({ MAX_UNIFORM_RANGE, properties.limits.maxUniformBufferRange, mRegionSize });
+    mStorageRange = std::min<VkDeviceSize>(mRegionSize, properties.limits.maxStorageBufferRange);
+
+    // 마지막 영역 끝에서 바인딩해도 범위가 버퍼 안에 들어오도록 여유를 둠
+    VkBufferCreateInfo bufferCI{};
+    bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCI.size = mRegionSize * frameSlotCount + std::max(mUniformRange, mStorageRange);
+    bufferCI.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkResult result = vkCreateBuffer(mDevice, &bufferCI, nullptr, &mBuffer);
+    VkUtil::ExitIfFailed(result, "fail vkCreateBuffer (frame allocator)");
+    mAllocation = mAllocator->AllocateForBuffer(mBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkUtil::ExitIfFalse(mAllocation->mapped != nullptr, "frame allocator buffer is not mapped");
+
+    DescriptorSetLayoutDesc layoutDesc;
+    layoutDesc.bindingCount = 2;
+    layoutDesc.bindings[BINDING_UNIFORM].binding = BINDING_UNIFORM;
+    layoutDesc.bindings[BINDING_UNIFORM].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    layoutDesc.bindings[BINDING_UNIFORM].descriptorCount = 1;
+    layoutDesc.bindings[BINDING_UNIFORM].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    layoutDesc.bindings[BINDING_STORAGE].binding = BINDING_STORAGE;
+    layoutDesc.bindings[BINDING_STORAGE].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    layoutDesc.bindings[BINDING_STORAGE].descriptorCount = 1;
+    layoutDesc.bindings[BINDING_STORAGE].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    mSetLayout = library.GetDescriptorSetLayout(layoutDesc);
+
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+    poolSizes[1].descriptorCount = 1;
+
+    VkDescriptorPoolCreateInfo poolCI{};
+    poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCI.maxSets = 1;
+    poolCI.poolSizeCount = 2;
+    poolCI.pPoolSizes = poolSizes;
+    result = vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &mDescriptorPool);
+    VkUtil::ExitIfFailed(result, "fail vkCreateDescriptorPool (frame allocator)");
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &mSetLayout;
+    result = vkAllocateDescriptorSets(mDevice, &allocInfo, &mSet);
+    VkUtil::ExitIfFailed(result, "fail vkAllocateDescriptorSets (frame allocator)");
+
+    // 세트는 한 번만 쓰고 영역/할당 위치는 동적 오프셋으로 고름
+    VkDescriptorBufferInfo bufferInfos[2]{};
+    bufferInfos[BINDING_UNIFORM].buffer = mBuffer;
+    bufferInfos[BINDING_UNIFORM].range = mUniformRange;
+    bufferInfos[BINDING_STORAGE].buffer = mBuffer;
+    bufferInfos[BINDING_STORAGE].range = mStorageRange;
+
+    VkWriteDescriptorSet writes[2]{};
+    for (uint32_t i = 0; i < 2; ++i)
+    {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = mSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = layoutDesc.bindings[i].descriptorType;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(mDevice, 2, writes, 0, nullptr);
+
+    Begin(0);
+}
+
+void FrameAllocator::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+    vkDestroyBuffer(mDevice, mBuffer, nullptr);
+    mAllocator->Free(mAllocation);
+    mDescriptorPool = VK_NULL_HANDLE;
+    mSet = VK_NULL_HANDLE;
+    mSetLayout = VK_NULL_HANDLE;
+    mBuffer = VK_NULL_HANDLE;
+    mAllocation = nullptr;
+    mDevice = VK_NULL_HANDLE;
+}
+
+void FrameAllocator::Begin(uint32_t frameSlot)
+{
+    mPeakBytes = std::max(mPeakBytes, GetUsedBytes());
+    mRegionBegin = mRegionSize * frameSlot;
+    mHead.store(0, std::memory_order_relaxed);
+}
+
+uint32_t FrameAllocator::Allocate(VkDeviceSize size, void*& outData)
+{
+    // 크기를 정렬 단위로 올려서 다음 할당의 오프셋도 정렬되게 함
+    VkDeviceSize alignedSize = (size + mAlignment - 1) / mAlignment * mAlignment;
+    VkDeviceSize offset = mHead.fetch_add(alignedSize, std::memory_order_relaxed);
+    VkUtil::ExitIfFalse(offset + alignedSize <= mRegionSize, "frame allocator region is full");
+
+    VkDeviceSize bufferOffset = mRegionBegin + offset;
+    outData = static_cast<uint8_t*>(mAllocation->mapped) + bufferOffset;
+    return static_cast<uint32_t>(bufferOffset);
+}
+
+void FrameAllocator::Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t setIndex,
+    uint32_t uniformOffset, uint32_t storageOffset) const
+{
+    // 바인딩 번호 순서대로
+    const uint32_t dynamicOffsets[2] = { uniformOffset, storageOffset };
+    vkCmdBindDescriptorSets(cmd, bindPoint, layout, setIndex, 1, &mSet, 2, dynamicOffsets);
+}
+
+VkDescriptorSetLayout FrameAllocator::GetSetLayout() const
+{
+    return mSetLayout;
+}
+
+VkDescriptorSet FrameAllocator::GetSet() const
+{
+    return mSet;
+}
+
+VkDeviceSize FrameAllocator::GetUsedBytes() const
+{
+    return mHead.load(std::memory_order_relaxed);
+}
+
+VkDeviceSize FrameAllocator::GetPeakBytes() const
+{
+    return std::max(mPeakBytes, GetUsedBytes());
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstring>
+#include "MemoryAllocator.h"
+#include "PipelineLibrary.h"
+
+// Linear allocator for per-frame and per-draw constants. One persistently mapped,
+// host coherent buffer is split into a region per frame in flight; Allocate() bumps
+// an atomic head inside the current region and returns the dynamic offset to bind
+// the set with, so a constant update costs a bump and a memcpy.
+class FrameAllocator
+{
+public:
+	enum
+	{
+		BINDING_UNIFORM = 0,
+		BINDING_STORAGE = 1,
+		// descriptor range of the dynamic uniform binding, clamped to maxUniformBufferRange
+		MAX_UNIFORM_RANGE = 64 * 1024
+	};
+
+	FrameAllocator();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, PipelineLibrary& library,
+		uint32_t frameSlotCount, VkDeviceSize regionSize);
+	void Destroy();
+
+	// frameSlot must not be in use by the GPU (its timeline value already waited)
+	void Begin(uint32_t frameSlot);
+	// safe from several recording threads; outData points at size writable bytes,
+	// the return value is the dynamic offset of the allocation
+	uint32_t Allocate(VkDeviceSize size, void*& outData);
+	template <typename T>
+	uint32_t Push(const T& value)
+	{
+		void* data;
+		uint32_t offset = Allocate(sizeof(T), data);
+		memcpy(data, &value, sizeof(T));
+		return offset;
+	}
+
+	// the uniform binding reads MAX_UNIFORM_RANGE bytes from uniformOffset, the storage binding the rest of the region
+	void Bind(VkCommandBuffer cmd, VkPipelineBindPoint bindPoint, VkPipelineLayout layout, uint32_t setIndex,
+		uint32_t uniformOffset, uint32_t storageOffset = 0) const;
+
+	VkDescriptorSetLayout GetSetLayout() const;
+	// dynamic offsets in binding order, as Bind() passes them
+	VkDescriptorSet GetSet() const;
+	// bytes allocated in the current frame
+	VkDeviceSize GetUsedBytes() const;
+	VkDeviceSize GetPeakBytes() const;
+
+private:
+	VkDevice mDevice;
+	MemoryAllocator* mAllocator;
+	VkDeviceSize mAlignment;
+	VkDeviceSize mUniformRange;
+	VkDeviceSize mStorageRange;
+
+	VkBuffer mBuffer;
+	Allocation* mAllocation;
+	VkDeviceSize mRegionSize;
+	VkDeviceSize mRegionBegin;
+	std::atomic<VkDeviceSize> mHead;
+	VkDeviceSize mPeakBytes;
+
+	// owned by the PipelineLibrary
+	VkDescriptorSetLayout mSetLayout;
+	VkDescriptorPool mDescriptorPool;
+	VkDescriptorSet mSet;
+};
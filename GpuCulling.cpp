@@ -0,0 +1,455 @@
+#include "GpuCulling.h"
+#include "VkUtil.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+GpuCulling::GpuCulling()
+	:mDevice(VK_NULL_HANDLE)
+	,mAllocator(nullptr)
+	,mDrawIndirectCount(false)
+	,mMaxDrawCount(1)
+	,mSetLayout(VK_NULL_HANDLE)
+	,mDescriptorPool(VK_NULL_HANDLE)
+	,mPipelineLayout(VK_NULL_HANDLE)
+	,mPipeline(VK_NULL_HANDLE)
+	,mPlanes()
+	,mGeneration(0)
+{
+}
+
+void GpuCulling::Create(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, PipelineLibrary& library,
+    VkPipelineCache pipelineCache, VkDescriptorSetLayout instanceSetLayout, VkShaderModule cullModule, uint32_t frameSlotCount,
+    DeferDestroyFunction deferDestroy)
+{
+    mDevice = device;
+    mAllocator = &allocator;
+    mDeferDestroy = std::move(deferDestroy);
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(physicalDevice, &features);
+    mDrawIndirectCount = vulkan12Features.drawIndirectCount == VK_TRUE;
+    // 메시별 버킷 시작 위치를 firstInstance로 넘기고, 메시마다 커맨드 하나라 drawCount > 1이므로 둘 다 필수
+    if (features.features.drawIndirectFirstInstance == VK_FALSE || features.features.multiDrawIndirect == VK_FALSE)
+    {
+        cullModule = VK_NULL_HANDLE;
+    }
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    mMaxDrawCount = properties.limits.maxDrawIndirectCount;
+
+    // 0 : 메시 테이블, 1 : 보이는 오브젝트 인덱스, 2 : 카운터, 3 : 인다이렉트 커맨드
+    DescriptorSetLayoutDesc layoutDesc;
+    layoutDesc.bindingCount = 4;
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        layoutDesc.bindings[i].binding = i;
+        layoutDesc.bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutDesc.bindings[i].descriptorCount = 1;
+        layoutDesc.bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    layoutDesc.bindings[1].stageFlags |= VK_SHADER_STAGE_VERTEX_BIT;
+    mSetLayout = library.GetDescriptorSetLayout(layoutDesc);
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 4 * frameSlotCount;
+
+    VkDescriptorPoolCreateInfo poolCI{};
+    poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCI.maxSets = frameSlotCount;
+    poolCI.poolSizeCount = 1;
+    poolCI.pPoolSizes = &poolSize;
+    VkResult result = vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &mDescriptorPool);
+    VkUtil::ExitIfFailed(result, "fail vkCreateDescriptorPool (culling)");
+
+    mFrames.resize(frameSlotCount);
+    std::vector<VkDescriptorSetLayout> layouts(frameSlotCount, mSetLayout);
+    std::vector<VkDescriptorSet> sets(frameSlotCount);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = frameSlotCount;
+    allocInfo.pSetLayouts = layouts.data();
+    result = vkAllocateDescriptorSets(mDevice, &allocInfo, sets.data());
+    VkUtil::ExitIfFailed(result, "fail vkAllocateDescriptorSets (culling)");
+    for (uint32_t i = 0; i < frameSlotCount; ++i)
+    {
+        FrameResources& frame = mFrames[i];
+        frame.set = sets[i];
+        frame.objectCount = 0;
+        frame.meshCount = 0;
+        createObjectBuffers(frame, INITIAL_OBJECT_CAPACITY);
+        createMeshBuffers(frame, INITIAL_MESH_CAPACITY);
+        writeDescriptors(frame);
+    }
+
+    // 단위 행렬 : 클립 공간 그대로
+    const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f };
+    SetViewProjection(identity);
+
+    if (cullModule == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    PipelineLayoutDesc pipelineLayoutDesc;
+    pipelineLayoutDesc.setLayoutCount = 2;
+    pipelineLayoutDesc.setLayouts[0] = instanceSetLayout;
+    pipelineLayoutDesc.setLayouts[1] = mSetLayout;
+    pipelineLayoutDesc.pushConstantRangeCount = 1;
+    pipelineLayoutDesc.pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineLayoutDesc.pushConstantRanges[0].offset = 0;
+    pipelineLayoutDesc.pushConstantRanges[0].size = sizeof(CullConstants);
+    mPipelineLayout = library.GetPipelineLayout(pipelineLayoutDesc);
+
+    VkComputePipelineCreateInfo pipelineCI{};
+    pipelineCI.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineCI.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineCI.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineCI.stage.module = cullModule;
+    pipelineCI.stage.pName = "main";
+    pipelineCI.layout = mPipelineLayout;
+    result = vkCreateComputePipelines(mDevice, pipelineCache, 1, &pipelineCI, nullptr, &mPipeline);
+    VkUtil::ExitIfFailed(result, "fail vkCreateComputePipelines (culling)");
+}
+
+void GpuCulling::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    for (FrameResources& frame : mFrames)
+    {
+        destroyObjectBuffers(frame, false);
+        destroyMeshBuffers(frame, false);
+    }
+    mFrames.clear();
+    mMeshes.clear();
+
+    vkDestroyPipeline(mDevice, mPipeline, nullptr);
+    vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+    mPipeline = VK_NULL_HANDLE;
+    mPipelineLayout = VK_NULL_HANDLE;
+    mSetLayout = VK_NULL_HANDLE;
+    mDevice = VK_NULL_HANDLE;
+}
+
+uint32_t GpuCulling::AddMesh(const MeshDraw& draw)
+{
+    mMeshes.push_back(draw);
+    return static_cast<uint32_t>(mMeshes.size()) - 1;
+}
+
+void GpuCulling::SetViewProjection(const float viewProjection[16])
+{
+    // Gribb-Hartmann, 열 우선이므로 행 r은 m[r], m[4 + r], m[8 + r], m[12 + r]
+    float rows[4][4];
+    for (uint32_t r = 0; r < 4; ++r)
+    {
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            rows[r][c] = viewProjection[c * 4 + r];
+        }
+    }
+    // left, right, bottom, top, near (z >= 0), far
+    for (uint32_t c = 0; c < 4; ++c)
+    {
+        mPlanes[0 * 4 + c] = rows[3][c] + rows[0][c];
+        mPlanes[1 * 4 + c] = rows[3][c] - rows[0][c];
+        mPlanes[2 * 4 + c] = rows[3][c] + rows[1][c];
+        mPlanes[3 * 4 + c] = rows[3][c] - rows[1][c];
+        mPlanes[4 * 4 + c] = rows[2][c];
+        mPlanes[5 * 4 + c] = rows[3][c] - rows[2][c];
+    }
+    // 셰이더에서 반지름과 바로 비교하도록 정규화
+    for (uint32_t p = 0; p < 6; ++p)
+    {
+        float* plane = &mPlanes[p * 4];
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        if (length > 0.0f)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                plane[c] /= length;
+            }
+        }
+    }
+}
+
+void GpuCulling::Prepare(uint32_t frameSlot, uint32_t objectCount, const std::vector<uint32_t>& meshObjectCounts)
+{
+    FrameResources& frame = mFrames[frameSlot];
+    bool grown = false;
+    if (objectCount > frame.objectCapacity)
+    {
+        uint32_t capacity = frame.objectCapacity;
+        while (capacity < objectCount)
+        {
+            capacity *= 2;
+        }
+        destroyObjectBuffers(frame, true);
+        createObjectBuffers(frame, capacity);
+        grown = true;
+    }
+    uint32_t meshCount = static_cast<uint32_t>(mMeshes.size());
+    if (meshCount > frame.meshCapacity)
+    {
+        uint32_t capacity = frame.meshCapacity;
+        while (capacity < meshCount)
+        {
+            capacity *= 2;
+        }
+        destroyMeshBuffers(frame, true);
+        createMeshBuffers(frame, capacity);
+        grown = true;
+    }
+    if (grown)
+    {
+        writeDescriptors(frame);
+    }
+
+    // 메시마다 오브젝트 수만큼 보이는 목록에 자리를 잡아둠
+    MeshEntry* entries = static_cast<MeshEntry*>(frame.meshAllocation->mapped);
+    uint32_t instanceBase = 0;
+    for (uint32_t i = 0; i < meshCount; ++i)
+    {
+        const MeshDraw& draw = mMeshes[i];
+        MeshEntry& entry = entries[i];
+        entry.indexCount = draw.indexCount;
+        entry.firstIndex = draw.firstIndex;
+        entry.vertexOffset = draw.vertexOffset;
+        entry.instanceBase = instanceBase;
+        memcpy(entry.boundingSphere, draw.boundingSphere, sizeof(entry.boundingSphere));
+        if (i < meshObjectCounts.size())
+        {
+            instanceBase += meshObjectCounts[i];
+        }
+    }
+    frame.objectCount = objectCount;
+    frame.meshCount = meshCount;
+}
+
+void GpuCulling::RecordCull(VkCommandBuffer cmd, uint32_t frameSlot, VkDescriptorSet instanceSet) const
+{
+    const FrameResources& frame = mFrames[frameSlot];
+
+    // 카운터 초기화 -> 오브젝트 컬링 -> 메시별 커맨드 압축
+    vkCmdFillBuffer(cmd, frame.counterBuffer, 0, VK_WHOLE_SIZE, 0);
+
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    VkDescriptorSet sets[] = { instanceSet, frame.set };
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, 0, 2, sets, 0, nullptr);
+
+    // 그룹 수 한도를 넘으면 y로 나눠서 디스패치
+    uint32_t groupCount = (frame.objectCount + GROUP_SIZE - 1) / GROUP_SIZE;
+    uint32_t groupsX = std::max(std::min<uint32_t>(groupCount, MAX_GROUPS_X), 1u);
+    uint32_t groupsY = (groupCount + groupsX - 1) / groupsX;
+
+    CullConstants constants{};
+    memcpy(constants.planes, mPlanes, sizeof(constants.planes));
+    constants.objectCount = frame.objectCount;
+    constants.meshCount = frame.meshCount;
+    constants.rowWidth = groupsX * GROUP_SIZE;
+    constants.phase = 0;
+    constants.compact = mDrawIndirectCount ? 1 : 0;
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    constants.phase = 1;
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullConstants), &constants);
+    vkCmdDispatch(cmd, (frame.meshCount + GROUP_SIZE - 1) / GROUP_SIZE, 1, 1);
+    // 드로우 쪽 장벽은 렌더 그래프가 넣음
+}
+
+void GpuCulling::Bind(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t frameSlot) const
+{
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 1, 1, &mFrames[frameSlot].set, 0, nullptr);
+}
+
+VkDescriptorSet GpuCulling::GetSet(uint32_t frameSlot) const
+{
+    return mFrames[frameSlot].set;
+}
+
+DrawCommand GpuCulling::GetDrawCommand(uint32_t frameSlot) const
+{
+    const FrameResources& frame = mFrames[frameSlot];
+    DrawCommand command{};
+    command.indirectBuffer = frame.indirectBuffer;
+    command.indirectOffset = 0;
+    // multiDrawIndirect가 있으면 한도는 최소 2^16 - 1
+    command.maxDrawCount = std::min(frame.meshCount, mMaxDrawCount);
+    command.stride = sizeof(VkDrawIndexedIndirectCommand);
+    // 개수를 GPU에서 못 읽으면 메시마다 하나씩, 살아남은 게 없으면 instanceCount 0
+    if (mDrawIndirectCount)
+    {
+        command.countBuffer = frame.counterBuffer;
+        command.countOffset = 0;
+    }
+    return command;
+}
+
+bool GpuCulling::IsEnabled() const
+{
+    return mPipeline != VK_NULL_HANDLE;
+}
+
+uint32_t GpuCulling::GetMeshCount() const
+{
+    return static_cast<uint32_t>(mMeshes.size());
+}
+
+VkDescriptorSetLayout GpuCulling::GetSetLayout() const
+{
+    return mSetLayout;
+}
+
+uint32_t GpuCulling::GetGeneration() const
+{
+    return mGeneration;
+}
+
+VkBuffer GpuCulling::GetVisibleBuffer(uint32_t frameSlot) const
+{
+    return mFrames[frameSlot].visibleBuffer;
+}
+
+VkBuffer GpuCulling::GetIndirectBuffer(uint32_t frameSlot) const
+{
+    return mFrames[frameSlot].indirectBuffer;
+}
+
+VkBuffer GpuCulling::GetCounterBuffer(uint32_t frameSlot) const
+{
+    return mFrames[frameSlot].counterBuffer;
+}
+
+void GpuCulling::createObjectBuffers(FrameResources& frame, uint32_t capacity)
+{
+    frame.objectCapacity = capacity;
+    frame.visibleBuffer = createBuffer(sizeof(uint32_t) * static_cast<VkDeviceSize>(capacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, frame.visibleAllocation);
+}
+
+void GpuCulling::createMeshBuffers(FrameResources& frame, uint32_t capacity)
+{
+    frame.meshCapacity = capacity;
+    // 메시 테이블은 매 프레임 CPU가 씀
+    frame.meshBuffer = createBuffer(sizeof(MeshEntry) * static_cast<VkDeviceSize>(capacity), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.meshAllocation);
+    VkUtil::ExitIfFalse(frame.meshAllocation->mapped != nullptr, "mesh table is not mapped");
+    frame.counterBuffer = createBuffer(sizeof(uint32_t) * (1 + static_cast<VkDeviceSize>(capacity)),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, frame.counterAllocation);
+    frame.indirectBuffer = createBuffer(sizeof(VkDrawIndexedIndirectCommand) * static_cast<VkDeviceSize>(capacity),
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 0, frame.indirectAllocation);
+}
+
+void GpuCulling::destroyObjectBuffers(FrameResources& frame, bool deferred)
+{
+    VkDevice device = mDevice;
+    MemoryAllocator* allocator = mAllocator;
+    VkBuffer visibleBuffer = frame.visibleBuffer;
+    Allocation* visibleAllocation = frame.visibleAllocation;
+    auto destroy = [device, allocator, visibleBuffer, visibleAllocation]()
+    {
+        vkDestroyBuffer(device, visibleBuffer, nullptr);
+        allocator->Free(visibleAllocation);
+    };
+    if (deferred)
+    {
+        mDeferDestroy(destroy);
+    }
+    else
+    {
+        destroy();
+    }
+    frame.visibleBuffer = VK_NULL_HANDLE;
+    frame.visibleAllocation = nullptr;
+}
+
+void GpuCulling::destroyMeshBuffers(FrameResources& frame, bool deferred)
+{
+    VkDevice device = mDevice;
+    MemoryAllocator* allocator = mAllocator;
+    VkBuffer buffers[3] = { frame.meshBuffer, frame.counterBuffer, frame.indirectBuffer };
+    Allocation* allocations[3] = { frame.meshAllocation, frame.counterAllocation, frame.indirectAllocation };
+    auto destroy = [device, allocator, buffers, allocations]()
+    {
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            vkDestroyBuffer(device, buffers[i], nullptr);
+            allocator->Free(allocations[i]);
+        }
+    };
+    if (deferred)
+    {
+        mDeferDestroy(destroy);
+    }
+    else
+    {
+        destroy();
+    }
+    frame.meshBuffer = VK_NULL_HANDLE;
+    frame.counterBuffer = VK_NULL_HANDLE;
+    frame.indirectBuffer = VK_NULL_HANDLE;
+    frame.meshAllocation = nullptr;
+    frame.counterAllocation = nullptr;
+    frame.indirectAllocation = nullptr;
+}
+
+void GpuCulling::writeDescriptors(const FrameResources& frame)
+{
+    ++mGeneration;
+    VkDescriptorBufferInfo bufferInfos[4]{};
+    bufferInfos[0].buffer = frame.meshBuffer;
+    bufferInfos[1].buffer = frame.visibleBuffer;
+    bufferInfos[2].buffer = frame.counterBuffer;
+    bufferInfos[3].buffer = frame.indirectBuffer;
+
+    VkWriteDescriptorSet writes[4]{};
+    for (uint32_t i = 0; i < 4; ++i)
+    {
+        bufferInfos[i].offset = 0;
+        bufferInfos[i].range = VK_WHOLE_SIZE;
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = frame.set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+    vkUpdateDescriptorSets(mDevice, 4, writes, 0, nullptr);
+}
+
+VkBuffer GpuCulling::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required,
+    VkMemoryPropertyFlags preferred, Allocation*& outAllocation)
+{
+    VkBufferCreateInfo bufferCI{};
+    bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCI.size = size;
+    bufferCI.usage = usage;
+    bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkResult result = vkCreateBuffer(mDevice, &bufferCI, nullptr, &buffer);
+    VkUtil::ExitIfFailed(result, "fail vkCreateBuffer (culling)");
+    outAllocation = mAllocator->AllocateForBuffer(buffer, required, preferred);
+    return buffer;
+}
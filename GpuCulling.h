@@ -0,0 +1,135 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "MemoryAllocator.h"
+#include "PipelineLibrary.h"
+#include "DrawList.h"
+#include "DeletionQueue.h"
+
+// index range of the bound mesh drawn for objects with this mesh index
+struct MeshDraw
+{
+	uint32_t indexCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	// local space center xyz, radius w
+	float boundingSphere[4];
+};
+
+// Frustum culling on the GPU. A compute pass tests every object's bounding sphere,
+// writes the survivors' indices bucketed by mesh and compacts one indexed indirect
+// command per mesh that has survivors, so drawing costs the same few commands
+// no matter how many objects there are.
+class GpuCulling
+{
+public:
+	enum
+	{
+		GROUP_SIZE = 64,
+		MAX_GROUPS_X = 65535,
+		INITIAL_OBJECT_CAPACITY = 1024,
+		INITIAL_MESH_CAPACITY = 16
+	};
+
+	GpuCulling();
+
+	// cullModule may be VK_NULL_HANDLE, IsEnabled() is false then and the caller draws directly
+	// (also when the device lacks drawIndirectFirstInstance or multiDrawIndirect);
+	// the descriptor sets stay valid either way; deferDestroy releases buffers replaced when they grow
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, PipelineLibrary& library,
+		VkPipelineCache pipelineCache, VkDescriptorSetLayout instanceSetLayout, VkShaderModule cullModule, uint32_t frameSlotCount,
+		DeferDestroyFunction deferDestroy);
+	void Destroy();
+
+	uint32_t AddMesh(const MeshDraw& draw);
+	// column-major, clip = viewProjection * world
+	void SetViewProjection(const float viewProjection[16]);
+
+	// frameSlot must not be in use by the GPU; meshObjectCounts[i] is the number of objects using mesh i
+	void Prepare(uint32_t frameSlot, uint32_t objectCount, const std::vector<uint32_t>& meshObjectCounts);
+	// outside rendering, before the draw; the caller makes the visible, indirect and counter
+	// buffers visible to the draw (DRAW_INDIRECT and VERTEX_SHADER stages)
+	void RecordCull(VkCommandBuffer cmd, uint32_t frameSlot, VkDescriptorSet instanceSet) const;
+	// binds the visible list as set 1
+	void Bind(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t frameSlot) const;
+	VkDescriptorSet GetSet(uint32_t frameSlot) const;
+	// indirect draw of the compacted commands, with the mesh buffers and graphics pipeline bound
+	DrawCommand GetDrawCommand(uint32_t frameSlot) const;
+
+	bool IsEnabled() const;
+	uint32_t GetMeshCount() const;
+	VkDescriptorSetLayout GetSetLayout() const;
+	// bumped when a frame's descriptor set is rewritten, command buffers binding it must be re-recorded
+	uint32_t GetGeneration() const;
+	VkBuffer GetVisibleBuffer(uint32_t frameSlot) const;
+	VkBuffer GetIndirectBuffer(uint32_t frameSlot) const;
+	VkBuffer GetCounterBuffer(uint32_t frameSlot) const;
+
+private:
+	// std430 layout shared with cull.comp
+	struct MeshEntry
+	{
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		// first slot of this mesh's bucket in the visible list
+		uint32_t instanceBase;
+		float boundingSphere[4];
+	};
+
+	struct CullConstants
+	{
+		float planes[24];
+		uint32_t objectCount;
+		uint32_t meshCount;
+		// threads per dispatch row when the group count is split over y
+		uint32_t rowWidth;
+		uint32_t phase;
+		uint32_t compact;
+	};
+
+	struct FrameResources
+	{
+		VkDescriptorSet set;
+		VkBuffer meshBuffer;
+		Allocation* meshAllocation;
+		VkBuffer visibleBuffer;
+		Allocation* visibleAllocation;
+		// drawCount followed by one survivor counter per mesh
+		VkBuffer counterBuffer;
+		Allocation* counterAllocation;
+		VkBuffer indirectBuffer;
+		Allocation* indirectAllocation;
+		uint32_t objectCapacity;
+		uint32_t meshCapacity;
+		uint32_t objectCount;
+		uint32_t meshCount;
+	};
+
+	VkDevice mDevice;
+	MemoryAllocator* mAllocator;
+	DeferDestroyFunction mDeferDestroy;
+	bool mDrawIndirectCount;
+	// VkPhysicalDeviceLimits::maxDrawIndirectCount
+	uint32_t mMaxDrawCount;
+
+	// layouts are owned by the PipelineLibrary
+	VkDescriptorSetLayout mSetLayout;
+	VkDescriptorPool mDescriptorPool;
+	VkPipelineLayout mPipelineLayout;
+	VkPipeline mPipeline;
+	std::vector<FrameResources> mFrames;
+
+	std::vector<MeshDraw> mMeshes;
+	float mPlanes[24];
+	uint32_t mGeneration;
+
+	void createObjectBuffers(FrameResources& frame, uint32_t capacity);
+	void createMeshBuffers(FrameResources& frame, uint32_t capacity);
+	// deferred : through mDeferDestroy, otherwise right away (the device must be idle)
+	void destroyObjectBuffers(FrameResources& frame, bool deferred);
+	void destroyMeshBuffers(FrameResources& frame, bool deferred);
+	void writeDescriptors(const FrameResources& frame);
+	VkBuffer createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags required,
+		VkMemoryPropertyFlags preferred, Allocation*& outAllocation);
+};
@@ -0,0 +1,285 @@
+#include "GpuProfiler.h"
+#include "VkUtil.h"
+#include <cassert>
+
+GpuProfiler::GpuProfiler()
+	:mDevice(VK_NULL_HANDLE)
+	,mTimestampSupported(false)
+	,mStatisticsEnabled(false)
+	,mTimestampMask(0)
+	,mTimestampPeriodNs(0.0)
+	,mCurrentSlot(nullptr)
+	,mFrameNumber(0)
+	,mHistoryHead(0)
+	,mHistoryCount(0)
+{
+}
+
+void GpuProfiler::Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlotCount, bool pipelineStatistics)
+{
+    mDevice = device;
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &props);
+    mTimestampPeriodNs = props.limits.timestampPeriod;
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &familyCount, families.data());
+
+    // timestampValidBits == 0 이면 이 큐에서 타임스탬프 사용 불가
+    uint32_t validBits = families[queueFamilyIndex].timestampValidBits;
+    mTimestampSupported = validBits > 0;
+    mTimestampMask = validBits >= 64 ? UINT64_MAX : ((1ull << validBits) - 1);
+
+    VkPhysicalDeviceFeatures features{};
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    mStatisticsEnabled = pipelineStatistics && features.pipelineStatisticsQuery == VK_TRUE;
+
+    mSlots.resize(frameSlotCount);
+    for (FrameSlot& slot : mSlots)
+    {
+        slot.timestampPool = VK_NULL_HANDLE;
+        slot.statisticsPool = VK_NULL_HANDLE;
+        slot.frameNumber = 0;
+        slot.regionNames.reserve(MAX_REGIONS);
+        slot.statisticsWritten = false;
+        slot.pending = false;
+
+        if (mTimestampSupported)
+        {
+            VkQueryPoolCreateInfo poolCI{};
+            poolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolCI.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            poolCI.queryCount = MAX_REGIONS * 2;
+            VkResult result = vkCreateQueryPool(mDevice, &poolCI, nullptr, &slot.timestampPool);
+            VkUtil::ExitIfFailed(result, "fail vkCreateQueryPool (timestamp)");
+        }
+
+        if (mStatisticsEnabled)
+        {
+            VkQueryPoolCreateInfo poolCI{};
+            poolCI.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolCI.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            poolCI.queryCount = 1;
+            poolCI.pipelineStatistics =
+                VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+                VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+            VkResult result = vkCreateQueryPool(mDevice, &poolCI, nullptr, &slot.statisticsPool);
+            VkUtil::ExitIfFailed(result, "fail vkCreateQueryPool (pipeline statistics)");
+        }
+    }
+
+    mHistory.resize(HISTORY_SIZE);
+}
+
+void GpuProfiler::Destroy()
+{
+    for (FrameSlot& slot : mSlots)
+    {
+        if (slot.timestampPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(mDevice, slot.timestampPool, nullptr);
+        }
+        if (slot.statisticsPool != VK_NULL_HANDLE)
+        {
+            vkDestroyQueryPool(mDevice, slot.statisticsPool, nullptr);
+        }
+    }
+    mSlots.clear();
+    mCurrentSlot = nullptr;
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer cmd, uint32_t frameSlot)
+{
+    // Create 하지 않았으면 프로파일링 꺼짐
+    if (mSlots.empty())
+    {
+        return;
+    }
+    assert(frameSlot < mSlots.size());
+    FrameSlot& slot = mSlots[frameSlot];
+
+    // 이 슬롯을 마지막으로 쓴 프레임은 펜스 대기가 끝났으므로 결과를 기다리지 않고 읽을 수 있음
+    if (slot.pending)
+    {
+        readback(slot);
+    }
+
+    if (slot.timestampPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(cmd, slot.timestampPool, 0, MAX_REGIONS * 2);
+    }
+    if (slot.statisticsPool != VK_NULL_HANDLE)
+    {
+        vkCmdResetQueryPool(cmd, slot.statisticsPool, 0, 1);
+    }
+
+    slot.frameNumber = mFrameNumber++;
+    slot.regionNames.clear();
+    slot.statisticsWritten = false;
+    slot.pending = true;
+    mCurrentSlot = &slot;
+}
+
+void GpuProfiler::ReplayFrame(uint32_t frameSlot)
+{
+    if (mSlots.empty())
+    {
+        return;
+    }
+    assert(frameSlot < mSlots.size());
+    FrameSlot& slot = mSlots[frameSlot];
+    if (slot.pending)
+    {
+        readback(slot);
+    }
+    // 리셋과 쿼리 기록은 재사용하는 커맨드 버퍼 안에 들어 있음
+    slot.frameNumber = mFrameNumber++;
+    slot.pending = true;
+    mCurrentSlot = nullptr;
+}
+
+uint32_t GpuProfiler::BeginRegion(VkCommandBuffer cmd, const char* name)
+{
+    if (mCurrentSlot == nullptr || mCurrentSlot->timestampPool == VK_NULL_HANDLE || mCurrentSlot->regionNames.size() >= MAX_REGIONS)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t region = static_cast<uint32_t>(mCurrentSlot->regionNames.size());
+    mCurrentSlot->regionNames.push_back(name);
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mCurrentSlot->timestampPool, region * 2);
+    return region;
+}
+
+void GpuProfiler::EndRegion(VkCommandBuffer cmd, uint32_t region)
+{
+    if (region == UINT32_MAX)
+    {
+        return;
+    }
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mCurrentSlot->timestampPool, region * 2 + 1);
+}
+
+void GpuProfiler::BeginStatistics(VkCommandBuffer cmd)
+{
+    if (mCurrentSlot == nullptr || mCurrentSlot->statisticsPool == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkCmdBeginQuery(cmd, mCurrentSlot->statisticsPool, 0, 0);
+}
+
+void GpuProfiler::EndStatistics(VkCommandBuffer cmd)
+{
+    if (mCurrentSlot == nullptr || mCurrentSlot->statisticsPool == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkCmdEndQuery(cmd, mCurrentSlot->statisticsPool, 0);
+    mCurrentSlot->statisticsWritten = true;
+}
+
+bool GpuProfiler::IsTimestampSupported() const
+{
+    return mTimestampSupported;
+}
+
+const GpuFrameStats* GpuProfiler::GetLatest() const
+{
+    if (mHistoryCount == 0)
+    {
+        return nullptr;
+    }
+    return &mHistory[(mHistoryHead + HISTORY_SIZE - 1) % HISTORY_SIZE];
+}
+
+std::vector<GpuFrameStats> GpuProfiler::GetHistory() const
+{
+    std::vector<GpuFrameStats> history;
+    history.reserve(mHistoryCount);
+    uint32_t first = (mHistoryHead + HISTORY_SIZE - mHistoryCount) % HISTORY_SIZE;
+    for (uint32_t i = 0; i < mHistoryCount; ++i)
+    {
+        history.push_back(mHistory[(first + i) % HISTORY_SIZE]);
+    }
+    return history;
+}
+
+void GpuProfiler::readback(FrameSlot& slot)
+{
+    slot.pending = false;
+
+    GpuFrameStats& stats = mHistory[mHistoryHead];
+    stats.frameNumber = slot.frameNumber;
+    stats.frameMs = 0.0;
+    stats.regions.clear();
+    stats.hasPipelineStatistics = false;
+
+    uint32_t regionCount = static_cast<uint32_t>(slot.regionNames.size());
+    if (regionCount > 0)
+    {
+        // [timestamp, availability] 쌍, WAIT_BIT 없이 읽으므로 스톨 없음
+        uint64_t data[MAX_REGIONS * 2][2] = {};
+        VkResult result = vkGetQueryPoolResults(mDevice, slot.timestampPool, 0, regionCount * 2,
+            sizeof(data), data, sizeof(data[0]), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if (result != VK_SUCCESS && result != VK_NOT_READY)
+        {
+            return;
+        }
+
+        uint64_t frameBegin = UINT64_MAX;
+        uint64_t frameEnd = 0;
+        for (uint32_t i = 0; i < regionCount; ++i)
+        {
+            const uint64_t* begin = data[i * 2];
+            const uint64_t* end = data[i * 2 + 1];
+            if (begin[1] == 0 || end[1] == 0)
+            {
+                continue;
+            }
+
+            uint64_t beginTicks = begin[0] & mTimestampMask;
+            uint64_t endTicks = end[0] & mTimestampMask;
+            double ms = static_cast<double>((endTicks - beginTicks) & mTimestampMask) * mTimestampPeriodNs * 1e-6;
+            stats.regions.push_back({ slot.regionNames[i], ms });
+
+            frameBegin = beginTicks < frameBegin ? beginTicks : frameBegin;
+            frameEnd = endTicks > frameEnd ? endTicks : frameEnd;
+        }
+        if (frameEnd > frameBegin)
+        {
+            stats.frameMs = static_cast<double>(frameEnd - frameBegin) * mTimestampPeriodNs * 1e-6;
+        }
+    }
+
+    if (slot.statisticsWritten)
+    {
+        // 결과는 활성화한 비트 순서대로 + availability
+        uint64_t values[7] = {};
+        VkResult result = vkGetQueryPoolResults(mDevice, slot.statisticsPool, 0, 1,
+            sizeof(values), values, sizeof(values), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+        if ((result == VK_SUCCESS || result == VK_NOT_READY) && values[6] != 0)
+        {
+            stats.hasPipelineStatistics = true;
+            stats.inputAssemblyVertices = values[0];
+            stats.inputAssemblyPrimitives = values[1];
+            stats.vertexShaderInvocations = values[2];
+            stats.clippingInvocations = values[3];
+            stats.clippingPrimitives = values[4];
+            stats.fragmentShaderInvocations = values[5];
+        }
+    }
+
+    mHistoryHead = (mHistoryHead + 1) % HISTORY_SIZE;
+    if (mHistoryCount < HISTORY_SIZE)
+    {
+        ++mHistoryCount;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+struct GpuRegionTime
+{
+	const char* name;
+	double ms;
+};
+
+// one frame's GPU results, read back a few frames after submission
+struct GpuFrameStats
+{
+	uint64_t frameNumber;
+	double frameMs;
+	std::vector<GpuRegionTime> regions;
+
+	bool hasPipelineStatistics;
+	uint64_t inputAssemblyVertices;
+	uint64_t inputAssemblyPrimitives;
+	uint64_t vertexShaderInvocations;
+	uint64_t clippingInvocations;
+	uint64_t clippingPrimitives;
+	uint64_t fragmentShaderInvocations;
+};
+
+class GpuProfiler
+{
+public:
+	enum
+	{
+		MAX_REGIONS = 32,
+		HISTORY_SIZE = 64
+	};
+
+	GpuProfiler();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlotCount, bool pipelineStatistics);
+	void Destroy();
+
+	// frameSlot must not be in use by the GPU (its timeline value already waited)
+	void BeginFrame(VkCommandBuffer cmd, uint32_t frameSlot);
+	// instead of BeginFrame() when resubmitting a command buffer recorded earlier for this slot;
+	// the regions and statistics of the slot's last recording are kept
+	void ReplayFrame(uint32_t frameSlot);
+	uint32_t BeginRegion(VkCommandBuffer cmd, const char* name);
+	void EndRegion(VkCommandBuffer cmd, uint32_t region);
+
+	// outside of a render pass, around the draws to measure
+	void BeginStatistics(VkCommandBuffer cmd);
+	void EndStatistics(VkCommandBuffer cmd);
+
+	bool IsTimestampSupported() const;
+	const GpuFrameStats* GetLatest() const;
+	// oldest first
+	std::vector<GpuFrameStats> GetHistory() const;
+
+private:
+	struct FrameSlot
+	{
+		VkQueryPool timestampPool;
+		VkQueryPool statisticsPool;
+		uint64_t frameNumber;
+		std::vector<const char*> regionNames;
+		bool statisticsWritten;
+		bool pending;
+	};
+
+	VkDevice mDevice;
+	bool mTimestampSupported;
+	bool mStatisticsEnabled;
+	uint64_t mTimestampMask;
+	double mTimestampPeriodNs;
+
+	std::vector<FrameSlot> mSlots;
+	FrameSlot* mCurrentSlot;
+	uint64_t mFrameNumber;
+
+	std::vector<GpuFrameStats> mHistory;
+	uint32_t mHistoryHead;
+	uint32_t mHistoryCount;
+
+	void readback(FrameSlot& slot);
+};
@@ -0,0 +1,298 @@
+#include "InstanceBuffer.h"
+#include "VkUtil.h"
+#include <algorithm>
+#include <cstring>
+
+InstanceBuffer::InstanceBuffer()
+	:mDevice(VK_NULL_HANDLE)
+	,mAllocator(nullptr)
+	,mOffsetAlignment(1)
+	,mBuffer(VK_NULL_HANDLE)
+	,mAllocation(nullptr)
+	,mCapacity(0)
+	,mRegionStride(0)
+	,mSetLayout(VK_NULL_HANDLE)
+	,mDescriptorPool(VK_NULL_HANDLE)
+	,mLastUploadBytes(0)
+	,mGeneration(0)
+{
+}
+
+void InstanceBuffer::Create(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, PipelineLibrary& library, uint32_t frameSlotCount,
+    DeferDestroyFunction deferDestroy)
+{
+    mDevice = device;
+    mAllocator = &allocator;
+    mDeferDestroy = std::move(deferDestroy);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    mOffsetAlignment = std::max<VkDeviceSize>(properties.limits.minStorageBufferOffsetAlignment, 1);
+
+    DescriptorSetLayoutDesc layoutDesc;
+    layoutDesc.bindingCount = 1;
+    layoutDesc.bindings[0].binding = 0;
+    layoutDesc.bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    layoutDesc.bindings[0].descriptorCount = 1;
+    layoutDesc.bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    mSetLayout = library.GetDescriptorSetLayout(layoutDesc);
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = frameSlotCount;
+
+    VkDescriptorPoolCreateInfo poolCI{};
+    poolCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCI.maxSets = frameSlotCount;
+    poolCI.poolSizeCount = 1;
+    poolCI.pPoolSizes = &poolSize;
+    VkResult result = vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &mDescriptorPool);
+    VkUtil::ExitIfFailed(result, "fail vkCreateDescriptorPool (instances)");
+
+    mRegions.resize(frameSlotCount);
+    std::vector<VkDescriptorSetLayout> layouts(frameSlotCount, mSetLayout);
+    std::vector<VkDescriptorSet> sets(frameSlotCount);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = mDescriptorPool;
+    allocInfo.descriptorSetCount = frameSlotCount;
+    allocInfo.pSetLayouts = layouts.data();
+    result = vkAllocateDescriptorSets(mDevice, &allocInfo, sets.data());
+    VkUtil::ExitIfFailed(result, "fail vkAllocateDescriptorSets (instances)");
+    for (uint32_t i = 0; i < frameSlotCount; ++i)
+    {
+        mRegions[i].set = sets[i];
+        mRegions[i].dirtyBegin = UINT32_MAX;
+        mRegions[i].dirtyEnd = 0;
+        mRegions[i].descriptorStale = true;
+    }
+
+    createBuffer(INITIAL_CAPACITY);
+}
+
+void InstanceBuffer::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    vkDestroyBuffer(mDevice, mBuffer, nullptr);
+    mAllocator->Free(mAllocation);
+    mBuffer = VK_NULL_HANDLE;
+    mAllocation = nullptr;
+
+    vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+    mSetLayout = VK_NULL_HANDLE;
+    mRegions.clear();
+    mDevice = VK_NULL_HANDLE;
+}
+
+InstanceHandle InstanceBuffer::Add(const InstanceData& data)
+{
+    InstanceHandle handle;
+    if (mFreeHandles.empty() == false)
+    {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+    else
+    {
+        handle = static_cast<InstanceHandle>(mHandleToIndex.size());
+        mHandleToIndex.push_back(UINT32_MAX);
+    }
+
+    uint32_t index = static_cast<uint32_t>(mInstances.size());
+    mInstances.push_back(data);
+    mIndexToHandle.push_back(handle);
+    mHandleToIndex[handle] = index;
+    countMesh(data.meshIndex, 1);
+    markDirty(index, index + 1);
+    return handle;
+}
+
+void InstanceBuffer::Update(InstanceHandle handle, const InstanceData& data)
+{
+    VkUtil::ExitIfFalse(handle < mHandleToIndex.size() && mHandleToIndex[handle] != UINT32_MAX, "invalid instance handle");
+    uint32_t index = mHandleToIndex[handle];
+    countMesh(mInstances[index].meshIndex, -1);
+    countMesh(data.meshIndex, 1);
+    mInstances[index] = data;
+    markDirty(index, index + 1);
+}
+
+void InstanceBuffer::UpdateTransform(InstanceHandle handle, const float transform[12])
+{
+    VkUtil::ExitIfFalse(handle < mHandleToIndex.size() && mHandleToIndex[handle] != UINT32_MAX, "invalid instance handle");
+    uint32_t index = mHandleToIndex[handle];
+    memcpy(mInstances[index].transform, transform, sizeof(mInstances[index].transform));
+    markDirty(index, index + 1);
+}
+
+void InstanceBuffer::Remove(InstanceHandle handle)
+{
+    VkUtil::ExitIfFalse(handle < mHandleToIndex.size() && mHandleToIndex[handle] != UINT32_MAX, "invalid instance handle");
+    uint32_t index = mHandleToIndex[handle];
+    uint32_t last = static_cast<uint32_t>(mInstances.size()) - 1;
+    countMesh(mInstances[index].meshIndex, -1);
+
+    // 마지막 인스턴스를 빈자리로 옮겨서 배열을 빽빽하게 유지
+    if (index != last)
+    {
+        mInstances[index] = mInstances[last];
+        mIndexToHandle[index] = mIndexToHandle[last];
+        mHandleToIndex[mIndexToHandle[index]] = index;
+        markDirty(index, index + 1);
+    }
+    mInstances.pop_back();
+    mIndexToHandle.pop_back();
+    mHandleToIndex[handle] = UINT32_MAX;
+    mFreeHandles.push_back(handle);
+}
+
+void InstanceBuffer::Clear()
+{
+    mInstances.clear();
+    mIndexToHandle.clear();
+    mHandleToIndex.clear();
+    mFreeHandles.clear();
+    mMeshCounts.clear();
+}
+
+void InstanceBuffer::Prepare(uint32_t frameSlot)
+{
+    mLastUploadBytes = 0;
+
+    uint32_t count = static_cast<uint32_t>(mInstances.size());
+    if (count > mCapacity)
+    {
+        // 다른 프레임 슬롯의 제출이 아직 예전 버퍼를 읽고 있을 수 있음
+        VkDevice device = mDevice;
+        MemoryAllocator* allocator = mAllocator;
+        VkBuffer buffer = mBuffer;
+        Allocation* allocation = mAllocation;
+        mDeferDestroy([device, allocator, buffer, allocation]()
+        {
+            vkDestroyBuffer(device, buffer, nullptr);
+            allocator->Free(allocation);
+        });
+        uint32_t capacity = mCapacity;
+        while (capacity < count)
+        {
+            capacity *= 2;
+        }
+        createBuffer(capacity);
+    }
+
+    FrameRegion& region = mRegions[frameSlot];
+    if (region.descriptorStale)
+    {
+        VkDescriptorBufferInfo bufferInfo{};
+        bufferInfo.buffer = mBuffer;
+        bufferInfo.offset = mRegionStride * frameSlot;
+        bufferInfo.range = sizeof(InstanceData) * static_cast<VkDeviceSize>(mCapacity);
+
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = region.set;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pBufferInfo = &bufferInfo;
+        vkUpdateDescriptorSets(mDevice, 1, &write, 0, nullptr);
+        region.descriptorStale = false;
+    }
+
+    // 제거로 줄어든 뒷부분은 그리지 않으므로 쓰지 않음
+    uint32_t end = std::min(region.dirtyEnd, count);
+    if (region.dirtyBegin < end)
+    {
+        uint8_t* dst = static_cast<uint8_t*>(mAllocation->mapped) + mRegionStride * frameSlot;
+        size_t offset = sizeof(InstanceData) * region.dirtyBegin;
+        size_t size = sizeof(InstanceData) * (end - region.dirtyBegin);
+        memcpy(dst + offset, reinterpret_cast<const uint8_t*>(mInstances.data()) + offset, size);
+        mLastUploadBytes = size;
+    }
+    region.dirtyBegin = UINT32_MAX;
+    region.dirtyEnd = 0;
+}
+
+void InstanceBuffer::Bind(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t frameSlot) const
+{
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, layout, 0, 1, &mRegions[frameSlot].set, 0, nullptr);
+}
+
+VkDescriptorSet InstanceBuffer::GetSet(uint32_t frameSlot) const
+{
+    return mRegions[frameSlot].set;
+}
+
+uint32_t InstanceBuffer::GetCount() const
+{
+    return static_cast<uint32_t>(mInstances.size());
+}
+
+const std::vector<uint32_t>& InstanceBuffer::GetMeshCounts() const
+{
+    return mMeshCounts;
+}
+
+VkDescriptorSetLayout InstanceBuffer::GetSetLayout() const
+{
+    return mSetLayout;
+}
+
+uint64_t InstanceBuffer::GetLastUploadBytes() const
+{
+    return mLastUploadBytes;
+}
+
+uint32_t InstanceBuffer::GetGeneration() const
+{
+    return mGeneration;
+}
+
+void InstanceBuffer::createBuffer(uint32_t capacity)
+{
+    mCapacity = capacity;
+    ++mGeneration;
+    VkDeviceSize regionSize = sizeof(InstanceData) * static_cast<VkDeviceSize>(capacity);
+    mRegionStride = (regionSize + mOffsetAlignment - 1) / mOffsetAlignment * mOffsetAlignment;
+
+    VkBufferCreateInfo bufferCI{};
+    bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCI.size = mRegionStride * mRegions.size();
+    bufferCI.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkResult result = vkCreateBuffer(mDevice, &bufferCI, nullptr, &mBuffer);
+    VkUtil::ExitIfFailed(result, "fail vkCreateBuffer (instances)");
+
+    // ReBAR가 있으면 VRAM에 직접 쓰고, 없으면 시스템 메모리에서 읽음
+    mAllocation = mAllocator->AllocateForBuffer(mBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    VkUtil::ExitIfFalse(mAllocation->mapped != nullptr, "instance buffer is not mapped");
+
+    // 새 버퍼는 모든 영역을 다시 써야 함
+    for (FrameRegion& region : mRegions)
+    {
+        region.descriptorStale = true;
+    }
+    markDirty(0, capacity);
+}
+
+void InstanceBuffer::markDirty(uint32_t begin, uint32_t end)
+{
+    for (FrameRegion& region : mRegions)
+    {
+        region.dirtyBegin = std::min(region.dirtyBegin, begin);
+        region.dirtyEnd = std::max(region.dirtyEnd, end);
+    }
+}
+
+void InstanceBuffer::countMesh(uint32_t meshIndex, int32_t delta)
+{
+    if (meshIndex >= mMeshCounts.size())
+    {
+        mMeshCounts.resize(meshIndex + 1, 0);
+    }
+    mMeshCounts[meshIndex] += delta;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "MemoryAllocator.h"
+#include "PipelineLibrary.h"
+#include "DeletionQueue.h"
+
+typedef uint32_t InstanceHandle;
+const InstanceHandle INVALID_INSTANCE = UINT32_MAX;
+
+// std430 layout shared with shader.vert and cull.comp
+struct InstanceData
+{
+	// rows of a 3x4 affine transform
+	float transform[12];
+	float color[4];
+	// entry in the GpuCulling mesh table
+	uint32_t meshIndex;
+	// BindlessHeap slots sampled by shader.frag, 0 : the renderer's white texture / default sampler
+	uint32_t textureIndex;
+	uint32_t samplerIndex;
+	uint32_t padding;
+};
+
+// Per-instance data in a host visible storage buffer, one region per frame in flight.
+// Add/Update/Remove only touch the CPU copy; Prepare() writes the range that changed
+// since that region was last written.
+class InstanceBuffer
+{
+public:
+	enum
+	{
+		INITIAL_CAPACITY = 1024
+	};
+
+	InstanceBuffer();
+
+	// deferDestroy releases the old buffer when it grows
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, MemoryAllocator& allocator, PipelineLibrary& library, uint32_t frameSlotCount,
+		DeferDestroyFunction deferDestroy);
+	void Destroy();
+
+	InstanceHandle Add(const InstanceData& data);
+	void Update(InstanceHandle handle, const InstanceData& data);
+	// transform only, rows of a 3x4 affine transform
+	void UpdateTransform(InstanceHandle handle, const float transform[12]);
+	void Remove(InstanceHandle handle);
+	void Clear();
+
+	// frameSlot must not be in use by the GPU (its timeline value already waited)
+	void Prepare(uint32_t frameSlot);
+	// binds the region as set 0
+	void Bind(VkCommandBuffer cmd, VkPipelineLayout layout, uint32_t frameSlot) const;
+	VkDescriptorSet GetSet(uint32_t frameSlot) const;
+
+	uint32_t GetCount() const;
+	// number of instances per mesh index
+	const std::vector<uint32_t>& GetMeshCounts() const;
+	VkDescriptorSetLayout GetSetLayout() const;
+	// bytes written by the last Prepare()
+	uint64_t GetLastUploadBytes() const;
+	// bumped when the buffer is reallocated, command buffers binding the old sets must be re-recorded
+	uint32_t GetGeneration() const;
+
+private:
+	struct FrameRegion
+	{
+		VkDescriptorSet set;
+		// instance index range not yet written to this region
+		uint32_t dirtyBegin;
+		uint32_t dirtyEnd;
+		bool descriptorStale;
+	};
+
+	VkDevice mDevice;
+	MemoryAllocator* mAllocator;
+	DeferDestroyFunction mDeferDestroy;
+	VkDeviceSize mOffsetAlignment;
+
+	VkBuffer mBuffer;
+	Allocation* mAllocation;
+	uint32_t mCapacity;
+	VkDeviceSize mRegionStride;
+
+	// owned by the PipelineLibrary
+	VkDescriptorSetLayout mSetLayout;
+	VkDescriptorPool mDescriptorPool;
+	std::vector<FrameRegion> mRegions;
+
+	// dense, removal moves the last instance into the hole
+	std::vector<InstanceData> mInstances;
+	std::vector<InstanceHandle> mIndexToHandle;
+	std::vector<uint32_t> mHandleToIndex;
+	std::vector<InstanceHandle> mFreeHandles;
+	std::vector<uint32_t> mMeshCounts;
+	uint64_t mLastUploadBytes;
+	uint32_t mGeneration;
+
+	void createBuffer(uint32_t capacity);
+	void markDirty(uint32_t begin, uint32_t end);
+	void countMesh(uint32_t meshIndex, int32_t delta);
+};
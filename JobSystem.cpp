@@ -0,0 +1,148 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+JobSystem::JobSystem()
+	:mNextQueue(0)
+	,mQueuedCount(0)
+	,mRunning(false)
+	,mStealCount(0)
+{
+}
+
+void JobSystem::Create(uint32_t threadCount)
+{
+    threadCount = std::max(threadCount, 1u);
+    mQueues.clear();
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        mQueues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+    }
+
+    mRunning = true;
+    // 0번은 Dispatch/Wait를 부르는 스레드
+    for (uint32_t i = 1; i < threadCount; ++i)
+    {
+        mThreads.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+void JobSystem::Destroy()
+{
+    {
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+        mRunning = false;
+    }
+    mWake.notify_all();
+    for (std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+    mThreads.clear();
+    mQueues.clear();
+}
+
+void JobSystem::Dispatch(uint32_t count, const JobFunction& job, JobCounter& counter)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    counter.pending += count;
+    // 꺼내면서 빼므로 넣기 전에 더해 둬야 음수로 내려가지 않음
+    mQueuedCount += count;
+
+    // 큐마다 골고루 나눠 넣고, 치우친 부분은 훔쳐가면서 맞춰짐
+    uint32_t queueCount = static_cast<uint32_t>(mQueues.size());
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        WorkQueue& queue = *mQueues[mNextQueue];
+        mNextQueue = (mNextQueue + 1) % queueCount;
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back({ &job, i, &counter });
+    }
+
+    {
+        // 잠들기 직전의 워커가 알림을 놓치지 않도록
+        std::lock_guard<std::mutex> lock(mSleepMutex);
+    }
+    mWake.notify_all();
+}
+
+void JobSystem::Wait(JobCounter& counter)
+{
+    while (counter.pending.load(std::memory_order_acquire) > 0)
+    {
+        if (tryRunJob(0) == false)
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+uint32_t JobSystem::GetThreadCount() const
+{
+    return static_cast<uint32_t>(mQueues.size());
+}
+
+uint64_t JobSystem::GetStealCount() const
+{
+    return mStealCount.load();
+}
+
+bool JobSystem::tryRunJob(uint32_t threadIndex)
+{
+    Job job{};
+    bool found = false;
+    {
+        // 자기 큐는 뒤에서 (최근에 넣은 것부터)
+        WorkQueue& own = *mQueues[threadIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.jobs.empty() == false)
+        {
+            job = own.jobs.back();
+            own.jobs.pop_back();
+            found = true;
+        }
+    }
+
+    // 남의 큐는 앞에서 훔침
+    uint32_t queueCount = static_cast<uint32_t>(mQueues.size());
+    for (uint32_t i = 1; i < queueCount && found == false; ++i)
+    {
+        WorkQueue& victim = *mQueues[(threadIndex + i) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.jobs.empty() == false)
+        {
+            job = victim.jobs.front();
+            victim.jobs.pop_front();
+            found = true;
+            ++mStealCount;
+        }
+    }
+
+    if (found == false)
+    {
+        return false;
+    }
+    --mQueuedCount;
+    (*job.function)(job.index, threadIndex);
+    job.counter->pending.fetch_sub(1, std::memory_order_release);
+    return true;
+}
+
+void JobSystem::workerLoop(uint32_t threadIndex)
+{
+    while (true)
+    {
+        if (tryRunJob(threadIndex))
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mSleepMutex);
+        mWake.wait(lock, [this]() { return mQueuedCount.load() > 0 || mRunning.load() == false; });
+        if (mRunning.load() == false)
+        {
+            return;
+        }
+    }
+}
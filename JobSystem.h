@@ -0,0 +1,67 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+typedef std::function<void(uint32_t index, uint32_t threadIndex)> JobFunction;
+
+// jobs of one Dispatch() that have not finished yet
+struct JobCounter
+{
+	std::atomic<uint32_t> pending{ 0 };
+};
+
+// Fixed pool of worker threads, one job queue per thread. A thread pops its own
+// queue from the back and steals from the front of the others when it runs dry.
+// Dispatch() and Wait() are meant to be called from one (the owning) thread only,
+// which runs jobs as thread 0 while it waits.
+class JobSystem
+{
+public:
+	JobSystem();
+
+	// threadCount includes the owning thread, 1 runs every job inside Wait()
+	void Create(uint32_t threadCount);
+	void Destroy();
+
+	// job(index, threadIndex) for index in [0, count); job must stay alive until Wait() returns
+	void Dispatch(uint32_t count, const JobFunction& job, JobCounter& counter);
+	void Wait(JobCounter& counter);
+
+	uint32_t GetThreadCount() const;
+	// jobs run by a thread other than the one they were queued on
+	uint64_t GetStealCount() const;
+
+private:
+	struct Job
+	{
+		const JobFunction* function;
+		uint32_t index;
+		JobCounter* counter;
+	};
+
+	struct WorkQueue
+	{
+		std::mutex mutex;
+		std::deque<Job> jobs;
+	};
+
+	std::vector<std::thread> mThreads;
+	std::vector<std::unique_ptr<WorkQueue>> mQueues;
+	uint32_t mNextQueue;
+
+	std::mutex mSleepMutex;
+	std::condition_variable mWake;
+	// queued but not yet picked up
+	std::atomic<uint32_t> mQueuedCount;
+	std::atomic<bool> mRunning;
+	std::atomic<uint64_t> mStealCount;
+
+	bool tryRunJob(uint32_t threadIndex);
+	void workerLoop(uint32_t threadIndex);
+};
@@ -0,0 +1,352 @@
+#include "Logger.h"
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+
+namespace
+{
+    const size_t RING_MASK = Logger::RING_SIZE - 1;
+    // 링 끝에 레코드가 안 들어갈 때 남은 자리를 채우는 레코드
+    const uint8_t PADDING_LEVEL = 0xFF;
+
+    static_assert((Logger::RING_SIZE & RING_MASK) == 0, "RING_SIZE must be a power of two");
+
+    uint64_t steadyNanoseconds()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    struct Ring
+    {
+        uint64_t data[Logger::RING_SIZE / sizeof(uint64_t)];
+        // 생산자와 소비자가 서로 다른 캐시 라인을 씀
+        alignas(64) std::atomic<size_t> head{ 0 };
+        alignas(64) std::atomic<size_t> tail{ 0 };
+        // 생산자 스레드만 씀
+        size_t pendingHead = 0;
+        size_t pendingSize = 0;
+
+        uint8_t* bytes()
+        {
+            return reinterpret_cast<uint8_t*>(data);
+        }
+    };
+
+    struct Line
+    {
+        uint64_t timestamp;
+        uint8_t level;
+        std::string text;
+    };
+
+    struct LoggerState
+    {
+        std::mutex ringsMutex;
+        std::vector<std::unique_ptr<Ring>> rings;
+        std::mutex drainMutex;
+        std::vector<Line> lines;
+        uint64_t reportedDropped = 0;
+
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::thread thread;
+        bool running = false;
+
+        std::atomic<uint64_t> dropped{ 0 };
+        std::atomic<bool> stderrOnly{ false };
+        // 출력 시각은 로거를 처음 쓴 시점 기준
+        uint64_t startTime = steadyNanoseconds();
+    };
+
+    // exit()가 드레인 스레드가 살아 있는 채로 불려도 소멸자가 돌지 않게 해제하지 않음
+    LoggerState& state()
+    {
+        static LoggerState* instance = new LoggerState();
+        return *instance;
+    }
+
+    thread_local Ring* tRing = nullptr;
+
+    Ring* threadRing()
+    {
+        if (tRing == nullptr)
+        {
+            // 스레드당 처음 한 번만 잠금
+            LoggerState& s = state();
+            std::lock_guard<std::mutex> lock(s.ringsMutex);
+            s.rings.push_back(std::make_unique<Ring>());
+            tRing = s.rings.back().get();
+        }
+        return tRing;
+    }
+
+    const char* levelTag(uint8_t level)
+    {
+        switch (level)
+        {
+        case LOG_LEVEL_TRACE:
+            return "[T] ";
+        case LOG_LEVEL_INFO:
+            return "[I] ";
+        case LOG_LEVEL_WARNING:
+            return "[W] ";
+        default:
+            return "[E] ";
+        }
+    }
+}
+
+void Logger::Start()
+{
+    LoggerState& s = state();
+    std::lock_guard<std::mutex> lock(s.wakeMutex);
+    if (s.running)
+    {
+        return;
+    }
+    s.running = true;
+    s.thread = std::thread([]()
+    {
+        LoggerState& s = state();
+        std::unique_lock<std::mutex> lock(s.wakeMutex);
+        while (s.running)
+        {
+            lock.unlock();
+            drain();
+            lock.lock();
+            s.wake.wait_for(lock, std::chrono::milliseconds(DRAIN_INTERVAL_MS), [&s]() { return s.running == false; });
+        }
+    });
+}
+
+void Logger::Stop()
+{
+    LoggerState& s = state();
+    {
+        std::lock_guard<std::mutex> lock(s.wakeMutex);
+        s.running = false;
+    }
+    s.wake.notify_one();
+    if (s.thread.joinable())
+    {
+        s.thread.join();
+    }
+    drain();
+}
+
+void Logger::Flush()
+{
+    drain();
+}
+
+void Logger::SetStderrOnly(bool enabled)
+{
+    state().stderrOnly.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t Logger::GetDroppedCount()
+{
+    return state().dropped.load(std::memory_order_relaxed);
+}
+
+void Logger::writeString(uint8_t*& cursor, const char* text, size_t length)
+{
+    uint32_t clamped = static_cast<uint32_t>(clampLength(length));
+    *cursor++ = ARG_STRING;
+    memcpy(cursor, &clamped, sizeof(clamped));
+    cursor += sizeof(clamped);
+    if (clamped > 0)
+    {
+        memcpy(cursor, text, clamped);
+        cursor += clamped;
+    }
+}
+
+uint64_t Logger::now()
+{
+    return steadyNanoseconds();
+}
+
+uint8_t* Logger::beginRecord(size_t size)
+{
+    Ring* ring = threadRing();
+    size = (size + 7) & ~static_cast<size_t>(7);
+
+    size_t head = ring->head.load(std::memory_order_relaxed);
+    size_t offset = head & RING_MASK;
+    size_t toEnd = RING_SIZE - offset;
+    // 레코드는 끊기지 않게, 끝에 안 들어가면 나머지를 패딩으로 채우고 처음부터
+    size_t needed = toEnd < size ? toEnd + size : size;
+    size_t used = head - ring->tail.load(std::memory_order_acquire);
+    if (size > RING_SIZE / 2 || used + needed > RING_SIZE)
+    {
+        // 막지 않고 버림, 드레인 스레드가 개수를 알림
+        state().dropped.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    if (toEnd < size)
+    {
+        uint8_t* padding = ring->bytes() + offset;
+        uint32_t paddingSize = static_cast<uint32_t>(toEnd);
+        memcpy(padding, &paddingSize, sizeof(paddingSize));
+        padding[offsetof(RecordHeader, level)] = PADDING_LEVEL;
+        head += toEnd;
+        offset = 0;
+    }
+    ring->pendingHead = head;
+    ring->pendingSize = size;
+    return ring->bytes() + offset;
+}
+
+void Logger::endRecord()
+{
+    Ring* ring = tRing;
+    uint32_t size = static_cast<uint32_t>(ring->pendingSize);
+    memcpy(ring->bytes() + (ring->pendingHead & RING_MASK), &size, sizeof(size));
+    ring->head.store(ring->pendingHead + ring->pendingSize, std::memory_order_release);
+}
+
+void Logger::drain()
+{
+    LoggerState& s = state();
+    std::lock_guard<std::mutex> drainLock(s.drainMutex);
+
+    std::vector<Ring*> rings;
+    {
+        std::lock_guard<std::mutex> lock(s.ringsMutex);
+        for (const std::unique_ptr<Ring>& ring : s.rings)
+        {
+            rings.push_back(ring.get());
+        }
+    }
+
+    std::vector<Line>& lines = s.lines;
+    lines.clear();
+    for (Ring* ring : rings)
+    {
+        size_t tail = ring->tail.load(std::memory_order_relaxed);
+        size_t head = ring->head.load(std::memory_order_acquire);
+        while (tail != head)
+        {
+            const uint8_t* record = ring->bytes() + (tail & RING_MASK);
+            uint32_t size;
+            memcpy(&size, record, sizeof(size));
+            if (record[offsetof(RecordHeader, level)] != PADDING_LEVEL)
+            {
+                RecordHeader header;
+                memcpy(&header, record, sizeof(header));
+                Line line{ header.timestamp, header.level, std::string() };
+                formatRecord(header, record + sizeof(RecordHeader), line.text);
+                lines.push_back(std::move(line));
+            }
+            tail += size;
+        }
+        // 다 읽은 뒤에 자리를 돌려줌
+        ring->tail.store(tail, std::memory_order_release);
+    }
+
+    uint64_t dropped = s.dropped.load(std::memory_order_relaxed);
+    if (dropped != s.reportedDropped)
+    {
+        Line line{ now(), LOG_LEVEL_WARNING, std::to_string(dropped - s.reportedDropped) + " log messages dropped (ring full)" };
+        lines.push_back(std::move(line));
+        s.reportedDropped = dropped;
+    }
+    if (lines.empty())
+    {
+        return;
+    }
+
+    // 스레드별 링을 시간 순으로 합침
+    std::stable_sort(lines.begin(), lines.end(), [](const Line& a, const Line& b) { return a.timestamp < b.timestamp; });
+
+    std::string out;
+    std::string err;
+    for (const Line& line : lines)
+    {
+        std::string& target = line.level >= LOG_LEVEL_WARNING || s.stderrOnly.load(std::memory_order_relaxed) ? err : out;
+        char prefix[32];
+        double seconds = line.timestamp > s.startTime ? (line.timestamp - s.startTime) * 1e-9 : 0.0;
+        snprintf(prefix, sizeof(prefix), "[%10.3f] ", seconds);
+        target += prefix;
+        target += levelTag(line.level);
+        target += line.text;
+        target += '\n';
+    }
+    if (out.empty() == false)
+    {
+        fwrite(out.data(), 1, out.size(), stdout);
+        fflush(stdout);
+    }
+    if (err.empty() == false)
+    {
+        fwrite(err.data(), 1, err.size(), stderr);
+        fflush(stderr);
+    }
+}
+
+void Logger::formatRecord(const RecordHeader& header, const uint8_t* args, std::string& out)
+{
+    const char* format = header.format;
+    uint32_t argIndex = 0;
+    while (*format != '\0')
+    {
+        if (format[0] == '{' && format[1] == '}' && argIndex < header.argCount)
+        {
+            appendArg(args, out);
+            ++argIndex;
+            format += 2;
+            continue;
+        }
+        out += *format++;
+    }
+}
+
+void Logger::appendArg(const uint8_t*& cursor, std::string& out)
+{
+    uint8_t type = *cursor++;
+    if (type == ARG_STRING)
+    {
+        uint32_t length;
+        memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        out.append(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+        return;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, cursor, sizeof(bits));
+    cursor += sizeof(bits);
+
+    char buffer[32];
+    switch (type)
+    {
+    case ARG_INT:
+        snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(static_cast<int64_t>(bits)));
+        break;
+    case ARG_UINT:
+        snprintf(buffer, sizeof(buffer), "%llu", static_cast<unsigned long long>(bits));
+        break;
+    case ARG_DOUBLE:
+    {
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        snprintf(buffer, sizeof(buffer), "%g", value);
+        break;
+    }
+    default:
+        snprintf(buffer, sizeof(buffer), "%s", bits != 0 ? "true" : "false");
+        break;
+    }
+    out += buffer;
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+enum LogLevel
+{
+	LOG_LEVEL_TRACE = 0,
+	LOG_LEVEL_INFO = 1,
+	LOG_LEVEL_WARNING = 2,
+	LOG_LEVEL_ERROR = 3,
+	LOG_LEVEL_OFF = 4
+};
+
+// messages below this level compile to nothing, arguments are not evaluated;
+// build with LOG_MIN_LEVEL=0 to get the per-frame traces
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+#define LOG_AT(level, ...) do { if constexpr ((level) >= LOG_MIN_LEVEL) { Logger::Write((level), __VA_ARGS__); } } while (0)
+#define LOG_TRACE(...) LOG_AT(LOG_LEVEL_TRACE, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LOG_LEVEL_WARNING, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+// Asynchronous logger. Every thread that logs owns a single-producer ring; a message
+// is stored as its format string pointer and the raw argument values, so the calling
+// thread never formats, locks or touches the console. A background thread drains the
+// rings, replaces the "{}" placeholders and writes in batches (stdout, warnings and
+// errors to stderr, or everything to stderr after SetStderrOnly()).
+class Logger
+{
+public:
+	enum
+	{
+		// bytes per thread, a message that does not fit is dropped rather than blocking
+		RING_SIZE = 64 * 1024,
+		DRAIN_INTERVAL_MS = 2
+	};
+	// longer string arguments are truncated
+	static constexpr size_t MAX_STRING_ARG = 2048;
+
+	// starts the drain thread; messages logged before are kept until then
+	static void Start();
+	// stops the drain thread and writes what is left
+	static void Stop();
+	// drains and writes on the calling thread, e.g. right before exit()
+	static void Flush();
+	// every level to stderr, leaves stdout to the program's own output
+	static void SetStderrOnly(bool enabled);
+	static uint64_t GetDroppedCount();
+
+	// format must be a string literal, it is read later by the drain thread;
+	// arguments : integers, enums, floating point, bool, C strings, std::string
+	template <size_t N, typename... Args>
+	static void Write(LogLevel level, const char (&format)[N], const Args&... args)
+	{
+		static_assert(sizeof...(Args) <= 255, "too many log arguments");
+		size_t size = sizeof(RecordHeader) + (static_cast<size_t>(0) + ... + argSize(args));
+		uint8_t* record = beginRecord(size);
+		if (record == nullptr)
+		{
+			return;
+		}
+		RecordHeader header{};
+		header.level = static_cast<uint8_t>(level);
+		header.argCount = static_cast<uint8_t>(sizeof...(Args));
+		header.timestamp = now();
+		header.format = format;
+		memcpy(record, &header, sizeof(header));
+		uint8_t* cursor = record + sizeof(RecordHeader);
+		(writeArg(cursor, args), ...);
+		endRecord();
+	}
+
+private:
+	enum ArgType : uint8_t
+	{
+		ARG_INT,
+		ARG_UINT,
+		ARG_DOUBLE,
+		ARG_BOOL,
+		ARG_STRING
+	};
+
+	// followed by the arguments, each a type byte and its value
+	struct RecordHeader
+	{
+		// written by endRecord(), records are 8 byte aligned
+		uint32_t size;
+		uint8_t level;
+		uint8_t argCount;
+		uint16_t padding;
+		uint64_t timestamp;
+		const char* format;
+	};
+
+	template <typename T>
+	static size_t argSize(const T& value)
+	{
+		if constexpr (std::is_same_v<T, std::string>)
+		{
+			return 1 + sizeof(uint32_t) + clampLength(value.size());
+		}
+		else if constexpr (std::is_convertible_v<const T&, const char*>)
+		{
+			const char* text = value;
+			return 1 + sizeof(uint32_t) + (text != nullptr ? clampLength(strlen(text)) : 0);
+		}
+		else
+		{
+			static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "unsupported log argument type");
+			return 1 + sizeof(uint64_t);
+		}
+	}
+
+	template <typename T>
+	static void writeArg(uint8_t*& cursor, const T& value)
+	{
+		if constexpr (std::is_same_v<T, std::string>)
+		{
+			writeString(cursor, value.data(), value.size());
+		}
+		else if constexpr (std::is_convertible_v<const T&, const char*>)
+		{
+			const char* text = value;
+			writeString(cursor, text, text != nullptr ? strlen(text) : 0);
+		}
+		else if constexpr (std::is_same_v<T, bool>)
+		{
+			writeValue(cursor, ARG_BOOL, static_cast<uint64_t>(value));
+		}
+		else if constexpr (std::is_floating_point_v<T>)
+		{
+			writeValue(cursor, ARG_DOUBLE, static_cast<double>(value));
+		}
+		else if constexpr (std::is_enum_v<T>)
+		{
+			writeArg(cursor, static_cast<std::underlying_type_t<T>>(value));
+		}
+		else if constexpr (std::is_signed_v<T>)
+		{
+			writeValue(cursor, ARG_INT, static_cast<int64_t>(value));
+		}
+		else
+		{
+			writeValue(cursor, ARG_UINT, static_cast<uint64_t>(value));
+		}
+	}
+
+	template <typename T>
+	static void writeValue(uint8_t*& cursor, ArgType type, T value)
+	{
+		static_assert(sizeof(T) == sizeof(uint64_t), "log values are stored as 8 bytes");
+		*cursor++ = type;
+		memcpy(cursor, &value, sizeof(value));
+		cursor += sizeof(value);
+	}
+
+	static size_t clampLength(size_t length)
+	{
+		return length < MAX_STRING_ARG ? length : MAX_STRING_ARG;
+	}
+
+	static void writeString(uint8_t*& cursor, const char* text, size_t length);
+	static uint64_t now();
+	// nullptr when the calling thread's ring is full
+	static uint8_t* beginRecord(size_t size);
+	static void endRecord();
+
+	// consumer side, serialized between the drain thread and Flush()
+	static void drain();
+	static void formatRecord(const RecordHeader& header, const uint8_t* args, std::string& out);
+	static void appendArg(const uint8_t*& cursor, std::string& out);
+};
@@ -0,0 +1,131 @@
+#include "MappedFile.h"
+#include "Logger.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdint>
+#endif
+
+MappedFile::MappedFile()
+	:mData(nullptr)
+	,mSize(0)
+	,mFile(nullptr)
+	,mMapping(nullptr)
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Open(const char* path)
+{
+    Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        LOG_ERROR("Failed to open file: {}", path);
+        return false;
+    }
+
+    LARGE_INTEGER size{};
+    if (GetFileSizeEx(file, &size) == FALSE || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        LOG_ERROR("Failed to map empty file: {}", path);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        CloseHandle(file);
+        LOG_ERROR("Failed to map file: {}", path);
+        return false;
+    }
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        LOG_ERROR("Failed to map file: {}", path);
+        return false;
+    }
+
+    mFile = file;
+    mMapping = mapping;
+    mData = data;
+    mSize = static_cast<size_t>(size.QuadPart);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+    {
+        LOG_ERROR("Failed to open file: {}", path);
+        return false;
+    }
+
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        close(fd);
+        LOG_ERROR("Failed to map empty file: {}", path);
+        return false;
+    }
+
+    void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        LOG_ERROR("Failed to map file: {}", path);
+        return false;
+    }
+
+    mFile = reinterpret_cast<void*>(static_cast<intptr_t>(fd));
+    mData = data;
+    mSize = static_cast<size_t>(st.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData == nullptr)
+    {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(mData);
+    CloseHandle(static_cast<HANDLE>(mMapping));
+    CloseHandle(static_cast<HANDLE>(mFile));
+#else
+    munmap(const_cast<void*>(mData), mSize);
+    close(static_cast<int>(reinterpret_cast<intptr_t>(mFile)));
+#endif
+
+    mData = nullptr;
+    mSize = 0;
+    mFile = nullptr;
+    mMapping = nullptr;
+}
+
+const void* MappedFile::GetData() const
+{
+    return mData;
+}
+
+size_t MappedFile::GetSize() const
+{
+    return mSize;
+}
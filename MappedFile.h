@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+
+// read-only memory-mapped file, the mapping is page aligned
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	bool Open(const char* path);
+	void Close();
+
+	const void* GetData() const;
+	size_t GetSize() const;
+
+private:
+	const void* mData;
+	size_t mSize;
+
+	// HANDLE on Windows, file descriptor elsewhere
+	void* mFile;
+	void* mMapping;
+};
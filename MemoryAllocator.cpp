@@ -0,0 +1,730 @@
+#include "MemoryAllocator.h"
+#include "Logger.h"
+#include "VkUtil.h"
+#include <algorithm>
+#include <set>
+#include <memory>
+
+struct MemoryBlock
+{
+    MemoryPool* pool;
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint8_t* mapped;
+
+    // buddy : freeLists[order]에 비어 있는 (MIN_ALLOCATION_SIZE << order) 크기 구간의 오프셋
+    uint32_t maxOrder;
+    std::vector<std::set<VkDeviceSize>> freeLists;
+    // linear
+    VkDeviceSize linearOffset;
+
+    VkDeviceSize allocatedBytes;
+    std::vector<Allocation*> allocations;
+};
+
+struct MemoryPool
+{
+    MemoryPoolDesc desc;
+    bool isDefault;
+    std::vector<std::unique_ptr<MemoryBlock>> blocks;
+};
+
+namespace
+{
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return alignment > 1 ? (value + alignment - 1) / alignment * alignment : value;
+    }
+
+    VkDeviceSize orderSize(uint32_t order)
+    {
+        return static_cast<VkDeviceSize>(MemoryAllocator::MIN_ALLOCATION_SIZE) << order;
+    }
+
+    uint32_t orderFor(VkDeviceSize size)
+    {
+        uint32_t order = 0;
+        while (orderSize(order) < size)
+        {
+            ++order;
+        }
+        return order;
+    }
+
+    bool buddyAllocate(MemoryBlock& block, uint32_t order, VkDeviceSize& outOffset)
+    {
+        if (order > block.maxOrder)
+        {
+            return false;
+        }
+        uint32_t current = order;
+        while (current <= block.maxOrder && block.freeLists[current].empty())
+        {
+            ++current;
+        }
+        if (current > block.maxOrder)
+        {
+            return false;
+        }
+
+        VkDeviceSize offset = *block.freeLists[current].begin();
+        block.freeLists[current].erase(block.freeLists[current].begin());
+        // 큰 구간을 반으로 쪼개면서 뒤쪽 절반은 free list로
+        while (current > order)
+        {
+            --current;
+            block.freeLists[current].insert(offset + orderSize(current));
+        }
+        outOffset = offset;
+        return true;
+    }
+
+    void buddyFree(MemoryBlock& block, VkDeviceSize offset, uint32_t order)
+    {
+        while (order < block.maxOrder)
+        {
+            VkDeviceSize buddy = offset ^ orderSize(order);
+            auto it = block.freeLists[order].find(buddy);
+            if (it == block.freeLists[order].end())
+            {
+                break;
+            }
+            block.freeLists[order].erase(it);
+            offset = std::min(offset, buddy);
+            ++order;
+        }
+        block.freeLists[order].insert(offset);
+    }
+
+    VkDeviceSize largestFreeRange(const MemoryBlock& block)
+    {
+        if (block.pool->desc.strategy == MemoryStrategy::Linear)
+        {
+            return block.size - block.linearOffset;
+        }
+        for (uint32_t order = block.maxOrder + 1; order > 0; --order)
+        {
+            if (block.freeLists[order - 1].empty() == false)
+            {
+                return orderSize(order - 1);
+            }
+        }
+        return 0;
+    }
+
+    // 블록 안에서 할당을 시도하고 성공하면 allocation을 채움
+    bool subAllocate(MemoryBlock& block, const VkMemoryRequirements& requirements, Allocation& outAllocation)
+    {
+        VkDeviceSize offset = 0;
+        if (block.pool->desc.strategy == MemoryStrategy::Linear)
+        {
+            offset = alignUp(block.linearOffset, requirements.alignment);
+            if (offset + requirements.size > block.size)
+            {
+                return false;
+            }
+            outAllocation.allocatedSize = offset + requirements.size - block.linearOffset;
+            outAllocation.order = 0;
+            block.linearOffset = offset + requirements.size;
+        }
+        else
+        {
+            // 버디 구간은 자기 크기로 정렬되므로 alignment 이상으로 올리면 정렬이 보장됨
+            uint32_t order = orderFor(std::max(requirements.size, requirements.alignment));
+            if (buddyAllocate(block, order, offset) == false)
+            {
+                return false;
+            }
+            outAllocation.allocatedSize = orderSize(order);
+            outAllocation.order = order;
+        }
+
+        outAllocation.memory = block.memory;
+        outAllocation.offset = offset;
+        outAllocation.size = requirements.size;
+        outAllocation.mapped = block.mapped != nullptr ? block.mapped + offset : nullptr;
+        outAllocation.memoryTypeIndex = block.pool->desc.memoryTypeIndex;
+        outAllocation.block = &block;
+        block.allocatedBytes += outAllocation.allocatedSize;
+        return true;
+    }
+
+    void removeFromBlock(MemoryBlock& block, Allocation* allocation)
+    {
+        auto it = std::find(block.allocations.begin(), block.allocations.end(), allocation);
+        if (it != block.allocations.end())
+        {
+            *it = block.allocations.back();
+            block.allocations.pop_back();
+        }
+        block.allocatedBytes -= allocation->allocatedSize;
+        if (block.pool->desc.strategy == MemoryStrategy::Buddy)
+        {
+            buddyFree(block, allocation->offset, allocation->order);
+        }
+        else if (block.allocations.empty())
+        {
+            block.linearOffset = 0;
+        }
+    }
+}
+
+MemoryAllocator::MemoryAllocator()
+	:mPhysicalDevice(VK_NULL_HANDLE)
+	,mDevice(VK_NULL_HANDLE)
+	,mMemoryProperties()
+	,mBlockSize(0)
+	,mMaxAllocationCount(0)
+	,mDeviceAllocationCount(0)
+{
+}
+
+void MemoryAllocator::Create(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize)
+{
+    mPhysicalDevice = physicalDevice;
+    mDevice = device;
+    vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &mMemoryProperties);
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(mPhysicalDevice, &properties);
+    mMaxAllocationCount = properties.limits.maxMemoryAllocationCount;
+    mDeviceAllocationCount = 0;
+
+    // 버디 블록은 2의 거듭제곱 크기
+    mBlockSize = orderSize(orderFor(blockSize));
+
+    mDefaultPools.resize(mMemoryProperties.memoryTypeCount * 2);
+    for (uint32_t i = 0; i < mDefaultPools.size(); ++i)
+    {
+        mDefaultPools[i] = new MemoryPool();
+        mDefaultPools[i]->desc.memoryTypeIndex = i / 2;
+        mDefaultPools[i]->desc.blockSize = preferredBlockSize(i / 2);
+        mDefaultPools[i]->desc.maxBlockCount = 0;
+        mDefaultPools[i]->desc.strategy = MemoryStrategy::Buddy;
+        mDefaultPools[i]->isDefault = true;
+    }
+}
+
+void MemoryAllocator::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    MemoryStats stats = GetStats();
+    if (stats.allocationCount > 0)
+    {
+        LOG_WARNING("MemoryAllocator: {} allocations leaked", stats.allocationCount);
+    }
+
+    for (Allocation* allocation : mDedicated)
+    {
+        freeDeviceMemory(allocation->memory, allocation->mapped != nullptr);
+        delete allocation;
+    }
+    mDedicated.clear();
+    for (MemoryPool* pool : mCustomPools)
+    {
+        destroyPoolBlocks(*pool);
+        delete pool;
+    }
+    mCustomPools.clear();
+    for (MemoryPool* pool : mDefaultPools)
+    {
+        destroyPoolBlocks(*pool);
+        delete pool;
+    }
+    mDefaultPools.clear();
+    mDevice = VK_NULL_HANDLE;
+}
+
+Allocation* MemoryAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required,
+    VkMemoryPropertyFlags preferred, bool linearResource, bool dedicated, MemoryPool* pool)
+{
+    if (pool != nullptr)
+    {
+        VkUtil::ExitIfFalse((requirements.memoryTypeBits & (1u << pool->desc.memoryTypeIndex)) != 0, "memory pool type not allowed for resource");
+        Allocation* allocation = allocateFromPool(*pool, requirements);
+        VkUtil::ExitIfFalse(allocation != nullptr, "memory pool exhausted");
+        return allocation;
+    }
+
+    uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, required, preferred);
+    VkUtil::ExitIfFalse(memoryType != UINT32_MAX, "no memory type for allocation");
+
+    // 블록의 절반을 넘는 리소스는 블록을 낭비하므로 따로 할당
+    if (dedicated || requirements.size > preferredBlockSize(memoryType) / 2)
+    {
+        return allocateDedicated(memoryType, requirements, VK_NULL_HANDLE, VK_NULL_HANDLE);
+    }
+
+    Allocation* allocation = allocateFromPool(*mDefaultPools[memoryType * 2 + (linearResource ? 1 : 0)], requirements);
+    if (allocation == nullptr)
+    {
+        // 새 블록을 못 만들 정도로 메모리가 부족하면 딱 맞는 크기로 재시도
+        allocation = allocateDedicated(memoryType, requirements, VK_NULL_HANDLE, VK_NULL_HANDLE);
+    }
+    return allocation;
+}
+
+void MemoryAllocator::Free(Allocation* allocation)
+{
+    if (allocation == nullptr)
+    {
+        return;
+    }
+
+    if (allocation->block == nullptr)
+    {
+        mDedicated.erase(std::remove(mDedicated.begin(), mDedicated.end(), allocation), mDedicated.end());
+        freeDeviceMemory(allocation->memory, allocation->mapped != nullptr);
+    }
+    else
+    {
+        MemoryBlock& block = *allocation->block;
+        removeFromBlock(block, allocation);
+        if (block.allocations.empty() && block.pool->isDefault)
+        {
+            // 할당/해제가 반복될 때 블록을 계속 만들고 지우지 않도록 빈 블록 하나는 남김
+            releaseEmptyBlocks(*block.pool, true);
+        }
+    }
+    delete allocation;
+}
+
+Allocation* MemoryAllocator::AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, MemoryPool* pool)
+{
+    VkMemoryDedicatedRequirements dedicatedReq{};
+    dedicatedReq.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memReq{};
+    memReq.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memReq.pNext = &dedicatedReq;
+    VkBufferMemoryRequirementsInfo2 info{};
+    info.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+    info.buffer = buffer;
+    vkGetBufferMemoryRequirements2(mDevice, &info, &memReq);
+
+    Allocation* allocation = nullptr;
+    const VkMemoryRequirements& requirements = memReq.memoryRequirements;
+    if (pool == nullptr && (dedicatedReq.requiresDedicatedAllocation || dedicatedReq.prefersDedicatedAllocation))
+    {
+        uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, required, preferred);
+        VkUtil::ExitIfFalse(memoryType != UINT32_MAX, "no memory type for buffer");
+        allocation = allocateDedicated(memoryType, requirements, buffer, VK_NULL_HANDLE);
+    }
+    else
+    {
+        allocation = Allocate(requirements, required, preferred, true, false, pool);
+    }
+    VkUtil::ExitIfFalse(allocation != nullptr, "fail to allocate buffer memory");
+
+    VkResult result = vkBindBufferMemory(mDevice, buffer, allocation->memory, allocation->offset);
+    VkUtil::ExitIfFailed(result, "fail vkBindBufferMemory");
+    return allocation;
+}
+
+Allocation* MemoryAllocator::AllocateForImage(VkImage image, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, MemoryPool* pool)
+{
+    VkMemoryDedicatedRequirements dedicatedReq{};
+    dedicatedReq.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+    VkMemoryRequirements2 memReq{};
+    memReq.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+    memReq.pNext = &dedicatedReq;
+    VkImageMemoryRequirementsInfo2 info{};
+    info.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+    info.image = image;
+    vkGetImageMemoryRequirements2(mDevice, &info, &memReq);
+
+    Allocation* allocation = nullptr;
+    const VkMemoryRequirements& requirements = memReq.memoryRequirements;
+    // 렌더 타깃처럼 큰 이미지는 드라이버가 전용 할당을 선호하는 경우가 많음
+    if (pool == nullptr && (dedicatedReq.requiresDedicatedAllocation || dedicatedReq.prefersDedicatedAllocation))
+    {
+        uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, required, preferred);
+        VkUtil::ExitIfFalse(memoryType != UINT32_MAX, "no memory type for image");
+        allocation = allocateDedicated(memoryType, requirements, VK_NULL_HANDLE, image);
+    }
+    else
+    {
+        // optimal tiling 이미지로 가정
+        allocation = Allocate(requirements, required, preferred, false, false, pool);
+    }
+    VkUtil::ExitIfFalse(allocation != nullptr, "fail to allocate image memory");
+
+    VkResult result = vkBindImageMemory(mDevice, image, allocation->memory, allocation->offset);
+    VkUtil::ExitIfFailed(result, "fail vkBindImageMemory");
+    return allocation;
+}
+
+MemoryPool* MemoryAllocator::CreatePool(const MemoryPoolDesc& desc)
+{
+    VkUtil::ExitIfFalse(desc.memoryTypeIndex < mMemoryProperties.memoryTypeCount, "invalid memory pool type");
+
+    MemoryPool* pool = new MemoryPool();
+    pool->desc = desc;
+    pool->isDefault = false;
+    if (pool->desc.blockSize == 0)
+    {
+        pool->desc.blockSize = preferredBlockSize(desc.memoryTypeIndex);
+    }
+    mCustomPools.push_back(pool);
+    return pool;
+}
+
+void MemoryAllocator::DestroyPool(MemoryPool* pool)
+{
+    if (pool == nullptr)
+    {
+        return;
+    }
+    destroyPoolBlocks(*pool);
+    mCustomPools.erase(std::remove(mCustomPools.begin(), mCustomPools.end(), pool), mCustomPools.end());
+    delete pool;
+}
+
+void MemoryAllocator::ResetPool(MemoryPool* pool)
+{
+    VkUtil::ExitIfFalse(pool->desc.strategy == MemoryStrategy::Linear, "ResetPool on a non-linear pool");
+    for (auto& block : pool->blocks)
+    {
+        for (Allocation* allocation : block->allocations)
+        {
+            delete allocation;
+        }
+        block->allocations.clear();
+        block->allocatedBytes = 0;
+        block->linearOffset = 0;
+    }
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const
+{
+    uint32_t memoryType = VkUtil::FindMemoryType(mPhysicalDevice, typeBits, required | preferred);
+    if (memoryType == UINT32_MAX)
+    {
+        memoryType = VkUtil::FindMemoryType(mPhysicalDevice, typeBits, required);
+    }
+    return memoryType;
+}
+
+MemoryStats MemoryAllocator::GetStats() const
+{
+    MemoryStats stats{};
+    auto addPool = [&stats](const MemoryPool& pool)
+    {
+        for (const auto& block : pool.blocks)
+        {
+            VkDeviceSize freeBytes = block->size - block->allocatedBytes;
+            if (pool.desc.strategy == MemoryStrategy::Linear)
+            {
+                // linear은 중간에 해제된 공간을 재사용하지 못함
+                freeBytes = block->size - block->linearOffset;
+            }
+            ++stats.blockCount;
+            stats.blockBytes += block->size;
+            stats.freeBytes += freeBytes;
+            stats.fragmentedBytes += freeBytes - std::min(freeBytes, largestFreeRange(*block));
+            for (const Allocation* allocation : block->allocations)
+            {
+                ++stats.allocationCount;
+                stats.usedBytes += allocation->size;
+                stats.wastedBytes += allocation->allocatedSize - allocation->size;
+            }
+        }
+    };
+    for (const MemoryPool* pool : mDefaultPools)
+    {
+        addPool(*pool);
+    }
+    for (const MemoryPool* pool : mCustomPools)
+    {
+        addPool(*pool);
+    }
+    for (const Allocation* allocation : mDedicated)
+    {
+        ++stats.dedicatedCount;
+        ++stats.allocationCount;
+        stats.dedicatedBytes += allocation->allocatedSize;
+        stats.usedBytes += allocation->size;
+        stats.wastedBytes += allocation->allocatedSize - allocation->size;
+    }
+    return stats;
+}
+
+std::vector<DefragmentationMove> MemoryAllocator::PlanDefragmentation(uint32_t maxMoves)
+{
+    std::vector<DefragmentationMove> moves;
+    for (MemoryPool* pool : mDefaultPools)
+    {
+        if (pool->blocks.size() < 2)
+        {
+            continue;
+        }
+
+        // 가장 비어 있는 블록부터 비워서 가득 찬 블록 쪽으로 옮김
+        std::vector<MemoryBlock*> blocks;
+        for (auto& block : pool->blocks)
+        {
+            blocks.push_back(block.get());
+        }
+        std::sort(blocks.begin(), blocks.end(),
+            [](const MemoryBlock* a, const MemoryBlock* b) { return a->allocatedBytes < b->allocatedBytes; });
+
+        // 예약을 받은 블록은 이후 원본으로 쓰지 않음 - 옮겨 온 자리를 다시 비우게 됨
+        std::vector<bool> isDestination(blocks.size(), false);
+        for (size_t src = 0; src + 1 < blocks.size(); ++src)
+        {
+            if (isDestination[src])
+            {
+                continue;
+            }
+            for (Allocation* allocation : blocks[src]->allocations)
+            {
+                if (moves.size() >= maxMoves)
+                {
+                    return moves;
+                }
+                for (size_t dst = blocks.size() - 1; dst > src; --dst)
+                {
+                    VkDeviceSize offset = 0;
+                    if (buddyAllocate(*blocks[dst], allocation->order, offset))
+                    {
+                        // 옮겨갈 자리는 Apply 또는 Cancel 전까지 예약 상태
+                        blocks[dst]->allocatedBytes += allocation->allocatedSize;
+                        isDestination[dst] = true;
+
+                        DefragmentationMove move{};
+                        move.allocation = allocation;
+                        move.dstMemory = blocks[dst]->memory;
+                        move.dstOffset = offset;
+                        move.dstBlock = blocks[dst];
+                        move.dstAllocatedSize = allocation->allocatedSize;
+                        move.dstOrder = allocation->order;
+                        moves.push_back(move);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+    return moves;
+}
+
+void MemoryAllocator::ApplyDefragmentation(const std::vector<DefragmentationMove>& moves)
+{
+    for (const DefragmentationMove& move : moves)
+    {
+        Allocation* allocation = move.allocation;
+        removeFromBlock(*allocation->block, allocation);
+
+        MemoryBlock& dst = *move.dstBlock;
+        allocation->memory = dst.memory;
+        allocation->offset = move.dstOffset;
+        allocation->mapped = dst.mapped != nullptr ? dst.mapped + move.dstOffset : nullptr;
+        allocation->block = &dst;
+        allocation->allocatedSize = move.dstAllocatedSize;
+        allocation->order = move.dstOrder;
+        dst.allocations.push_back(allocation);
+    }
+    for (MemoryPool* pool : mDefaultPools)
+    {
+        releaseEmptyBlocks(*pool, false);
+    }
+}
+
+void MemoryAllocator::CancelDefragmentation(const std::vector<DefragmentationMove>& moves)
+{
+    for (const DefragmentationMove& move : moves)
+    {
+        MemoryBlock& dst = *move.dstBlock;
+        buddyFree(dst, move.dstOffset, move.dstOrder);
+        dst.allocatedBytes -= move.dstAllocatedSize;
+    }
+}
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, const void* pNext, void** outMapped)
+{
+    *outMapped = nullptr;
+    if (mDeviceAllocationCount >= mMaxAllocationCount)
+    {
+        LOG_ERROR("MemoryAllocator: maxMemoryAllocationCount reached");
+        return VK_NULL_HANDLE;
+    }
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = pNext;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    if (vkAllocateMemory(mDevice, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        return VK_NULL_HANDLE;
+    }
+    ++mDeviceAllocationCount;
+
+    // host visible 메모리는 블록 전체를 한 번만 매핑해 두고 계속 사용
+    if (mMemoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+    {
+        VkResult result = vkMapMemory(mDevice, memory, 0, VK_WHOLE_SIZE, 0, outMapped);
+        VkUtil::ExitIfFailed(result, "fail vkMapMemory");
+    }
+    return memory;
+}
+
+void MemoryAllocator::freeDeviceMemory(VkDeviceMemory memory, bool mapped)
+{
+    if (mapped)
+    {
+        vkUnmapMemory(mDevice, memory);
+    }
+    vkFreeMemory(mDevice, memory, nullptr);
+    --mDeviceAllocationCount;
+}
+
+VkDeviceSize MemoryAllocator::preferredBlockSize(uint32_t memoryType) const
+{
+    // 작은 힙(BAR 256MB 등)에서는 블록 하나가 힙을 다 차지하지 않도록 1/8로
+    VkDeviceSize heapSize = mMemoryProperties.memoryHeaps[mMemoryProperties.memoryTypes[memoryType].heapIndex].size;
+    VkDeviceSize blockSize = mBlockSize;
+    while (heapSize <= 1024ull * 1024 * 1024 && blockSize > heapSize / 8 && blockSize > MIN_ALLOCATION_SIZE)
+    {
+        blockSize /= 2;
+    }
+    return blockSize;
+}
+
+Allocation* MemoryAllocator::allocateDedicated(uint32_t memoryType, const VkMemoryRequirements& requirements, VkBuffer buffer, VkImage image)
+{
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = buffer;
+    dedicatedInfo.image = image;
+    bool hasResource = buffer != VK_NULL_HANDLE || image != VK_NULL_HANDLE;
+
+    void* mapped = nullptr;
+    VkDeviceMemory memory = allocateDeviceMemory(memoryType, requirements.size, hasResource ? &dedicatedInfo : nullptr, &mapped);
+    if (memory == VK_NULL_HANDLE)
+    {
+        return nullptr;
+    }
+
+    Allocation* allocation = new Allocation();
+    allocation->memory = memory;
+    allocation->offset = 0;
+    allocation->size = requirements.size;
+    allocation->mapped = mapped;
+    allocation->memoryTypeIndex = memoryType;
+    allocation->block = nullptr;
+    allocation->allocatedSize = requirements.size;
+    allocation->order = 0;
+    mDedicated.push_back(allocation);
+    return allocation;
+}
+
+Allocation* MemoryAllocator::allocateFromPool(MemoryPool& pool, const VkMemoryRequirements& requirements)
+{
+    Allocation allocation{};
+    for (auto& block : pool.blocks)
+    {
+        if (subAllocate(*block, requirements, allocation))
+        {
+            Allocation* result = new Allocation(allocation);
+            block->allocations.push_back(result);
+            return result;
+        }
+    }
+
+    if (pool.desc.maxBlockCount != 0 && pool.blocks.size() >= pool.desc.maxBlockCount)
+    {
+        return nullptr;
+    }
+    MemoryBlock* block = createBlock(pool, requirements.size + requirements.alignment);
+    if (block == nullptr || subAllocate(*block, requirements, allocation) == false)
+    {
+        return nullptr;
+    }
+    Allocation* result = new Allocation(allocation);
+    block->allocations.push_back(result);
+    return result;
+}
+
+MemoryBlock* MemoryAllocator::createBlock(MemoryPool& pool, VkDeviceSize minSize)
+{
+    bool buddy = pool.desc.strategy == MemoryStrategy::Buddy;
+    VkDeviceSize size = std::max(pool.desc.blockSize, minSize);
+    if (buddy)
+    {
+        size = orderSize(orderFor(size));
+    }
+
+    // 메모리가 부족하면 블록 크기를 절반씩 줄여가며 재시도
+    void* mapped = nullptr;
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    while (true)
+    {
+        memory = allocateDeviceMemory(pool.desc.memoryTypeIndex, size, nullptr, &mapped);
+        if (memory != VK_NULL_HANDLE || size / 2 < minSize)
+        {
+            break;
+        }
+        size /= 2;
+    }
+    if (memory == VK_NULL_HANDLE)
+    {
+        return nullptr;
+    }
+
+    MemoryBlock* block = new MemoryBlock();
+    block->pool = &pool;
+    block->memory = memory;
+    block->size = size;
+    block->mapped = static_cast<uint8_t*>(mapped);
+    block->maxOrder = buddy ? orderFor(size) : 0;
+    block->linearOffset = 0;
+    block->allocatedBytes = 0;
+    if (buddy)
+    {
+        block->freeLists.resize(block->maxOrder + 1);
+        block->freeLists[block->maxOrder].insert(0);
+    }
+    pool.blocks.emplace_back(block);
+    return block;
+}
+
+void MemoryAllocator::destroyBlock(MemoryBlock* block)
+{
+    for (Allocation* allocation : block->allocations)
+    {
+        delete allocation;
+    }
+    freeDeviceMemory(block->memory, block->mapped != nullptr);
+}
+
+void MemoryAllocator::destroyPoolBlocks(MemoryPool& pool)
+{
+    for (auto& block : pool.blocks)
+    {
+        destroyBlock(block.get());
+    }
+    pool.blocks.clear();
+}
+
+void MemoryAllocator::releaseEmptyBlocks(MemoryPool& pool, bool keepOne)
+{
+    bool kept = false;
+    for (size_t i = 0; i < pool.blocks.size();)
+    {
+        MemoryBlock* block = pool.blocks[i].get();
+        if (block->allocatedBytes != 0 || (keepOne && kept == false))
+        {
+            kept = kept || block->allocatedBytes == 0;
+            ++i;
+            continue;
+        }
+        destroyBlock(block);
+        pool.blocks.erase(pool.blocks.begin() + i);
+    }
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+struct MemoryBlock;
+struct MemoryPool;
+
+enum class MemoryStrategy
+{
+	// power-of-two buddy sub-allocation, individual frees
+	Buddy,
+	// bump allocation, memory comes back only through ResetPool()
+	Linear
+};
+
+struct Allocation
+{
+	VkDeviceMemory memory;
+	VkDeviceSize offset;
+	VkDeviceSize size;
+	// non-null for host visible memory, already offset
+	void* mapped;
+
+	uint32_t memoryTypeIndex;
+	// nullptr : dedicated VkDeviceMemory
+	MemoryBlock* block;
+	VkDeviceSize allocatedSize;
+	uint32_t order;
+};
+
+struct MemoryPoolDesc
+{
+	uint32_t memoryTypeIndex;
+	VkDeviceSize blockSize;
+	// 0 : unlimited
+	uint32_t maxBlockCount;
+	MemoryStrategy strategy;
+};
+
+struct MemoryStats
+{
+	uint32_t blockCount;
+	uint32_t dedicatedCount;
+	uint32_t allocationCount;
+	VkDeviceSize blockBytes;
+	VkDeviceSize dedicatedBytes;
+	// sizes the callers asked for
+	VkDeviceSize usedBytes;
+	// alignment and power-of-two rounding inside blocks
+	VkDeviceSize wastedBytes;
+	VkDeviceSize freeBytes;
+	// free bytes outside the largest free range of each block
+	VkDeviceSize fragmentedBytes;
+};
+
+// allocation moved by PlanDefragmentation, not applied yet
+struct DefragmentationMove
+{
+	Allocation* allocation;
+	VkDeviceMemory dstMemory;
+	VkDeviceSize dstOffset;
+
+	MemoryBlock* dstBlock;
+	VkDeviceSize dstAllocatedSize;
+	uint32_t dstOrder;
+};
+
+// sub-allocates resources out of large per-memory-type VkDeviceMemory blocks
+// instead of one vkAllocateMemory per resource
+class MemoryAllocator
+{
+public:
+	enum
+	{
+		MIN_ALLOCATION_SIZE = 256
+	};
+
+	MemoryAllocator();
+
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, VkDeviceSize blockSize = 64ull * 1024 * 1024);
+	void Destroy();
+
+	// preferred flags are dropped when no memory type has them, required never are
+	Allocation* Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags required,
+		VkMemoryPropertyFlags preferred, bool linearResource, bool dedicated = false, MemoryPool* pool = nullptr);
+	void Free(Allocation* allocation);
+
+	// allocate and bind, dedicated when the driver asks for it or the resource is large
+	Allocation* AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, MemoryPool* pool = nullptr);
+	Allocation* AllocateForImage(VkImage image, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred, MemoryPool* pool = nullptr);
+
+	MemoryPool* CreatePool(const MemoryPoolDesc& desc);
+	void DestroyPool(MemoryPool* pool);
+	// linear pools only. Deletes every Allocation of the pool: pointers the caller still
+	// holds dangle afterwards, so drop them (and the resources bound to them) first.
+	void ResetPool(MemoryPool* pool);
+
+	uint32_t FindMemoryType(uint32_t typeBits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) const;
+	MemoryStats GetStats() const;
+
+	// Moves allocations out of the emptiest buddy blocks of each default pool.
+	// The caller creates a resource at dstMemory/dstOffset, copies on the GPU,
+	// waits, then calls ApplyDefragmentation and destroys the old resource.
+	// The destinations stay reserved until the plan is applied or cancelled.
+	std::vector<DefragmentationMove> PlanDefragmentation(uint32_t maxMoves);
+	void ApplyDefragmentation(const std::vector<DefragmentationMove>& moves);
+	// releases the reserved destinations of a plan that will not be applied
+	void CancelDefragmentation(const std::vector<DefragmentationMove>& moves);
+
+private:
+	VkPhysicalDevice mPhysicalDevice;
+	VkDevice mDevice;
+	VkPhysicalDeviceMemoryProperties mMemoryProperties;
+	VkDeviceSize mBlockSize;
+	uint32_t mMaxAllocationCount;
+	uint32_t mDeviceAllocationCount;
+
+	// [memoryType * 2 + linear] : buffers and optimal images never share a block,
+	// so bufferImageGranularity can be ignored
+	std::vector<MemoryPool*> mDefaultPools;
+	std::vector<MemoryPool*> mCustomPools;
+	std::vector<Allocation*> mDedicated;
+
+	VkDeviceMemory allocateDeviceMemory(uint32_t memoryType, VkDeviceSize size, const void* pNext, void** outMapped);
+	void freeDeviceMemory(VkDeviceMemory memory, bool mapped);
+	VkDeviceSize preferredBlockSize(uint32_t memoryType) const;
+
+	Allocation* allocateDedicated(uint32_t memoryType, const VkMemoryRequirements& requirements, VkBuffer buffer, VkImage image);
+	Allocation* allocateFromPool(MemoryPool& pool, const VkMemoryRequirements& requirements);
+	MemoryBlock* createBlock(MemoryPool& pool, VkDeviceSize minSize);
+	void destroyBlock(MemoryBlock* block);
+	void destroyPoolBlocks(MemoryPool& pool);
+	void releaseEmptyBlocks(MemoryPool& pool, bool keepOne);
+};
@@ -0,0 +1,366 @@
+#include "Mesh.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "VkUtil.h"
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <cstddef>
+
+namespace
+{
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint16_t floatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t exponent = (bits >> 23) & 0xff;
+        uint32_t mantissa = bits & 0x7fffff;
+
+        if (exponent == 0xff)
+        {
+            return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+        }
+        int32_t halfExponent = static_cast<int32_t>(exponent) - 127 + 15;
+        if (halfExponent >= 31)
+        {
+            return static_cast<uint16_t>(sign | 0x7c00);
+        }
+        if (halfExponent <= 0)
+        {
+            // 비정규화 수
+            if (halfExponent < -10)
+            {
+                return static_cast<uint16_t>(sign);
+            }
+            mantissa |= 0x800000;
+            uint32_t shift = static_cast<uint32_t>(14 - halfExponent);
+            uint32_t half = mantissa >> shift;
+            if ((mantissa >> (shift - 1)) & 1)
+            {
+                ++half;
+            }
+            return static_cast<uint16_t>(sign | half);
+        }
+        // 반올림 올림수가 지수까지 넘어가도 그대로 맞는 값이 됨
+        uint32_t half = sign | (static_cast<uint32_t>(halfExponent) << 10) | (mantissa >> 13);
+        if (mantissa & 0x1000)
+        {
+            ++half;
+        }
+        return static_cast<uint16_t>(half);
+    }
+
+    int16_t toSnorm16(float value)
+    {
+        return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+    }
+
+    // 단위 벡터를 팔면체에 투영해서 2성분으로
+    void encodeOctahedral(const float* n, int16_t out[2])
+    {
+        float sum = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+        if (sum == 0.0f)
+        {
+            out[0] = 0;
+            out[1] = 0;
+            return;
+        }
+        float x = n[0] / sum;
+        float y = n[1] / sum;
+        if (n[2] < 0.0f)
+        {
+            float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+            float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+            x = foldedX;
+            y = foldedY;
+        }
+        out[0] = toSnorm16(x);
+        out[1] = toSnorm16(y);
+    }
+}
+
+Mesh::Mesh()
+	:mVertexBuffer(VK_NULL_HANDLE)
+	,mIndexBuffer(VK_NULL_HANDLE)
+	,mVertexAllocation(nullptr)
+	,mIndexAllocation(nullptr)
+	,mIndexType(VK_INDEX_TYPE_UINT32)
+	,mIndexCount(0)
+	,mDecode()
+{
+}
+
+std::vector<uint8_t> Mesh::Encode(const MeshSource& source)
+{
+    MeshFileHeader header{};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.vertexCount = source.vertexCount;
+    header.indexCount = source.indexCount;
+    header.indexSize = source.vertexCount <= 65536 ? 2 : 4;
+    header.vertexOffset = alignUp(sizeof(MeshFileHeader), 16);
+    header.indexOffset = alignUp(header.vertexOffset + sizeof(MeshVertex) * source.vertexCount, 16);
+
+    // 위치는 바운딩 박스 기준 unorm16
+    float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+    float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+    for (uint32_t i = 0; i < source.vertexCount; ++i)
+    {
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float p = source.positions[i * 3 + axis];
+            boundsMin[axis] = i == 0 ? p : std::min(boundsMin[axis], p);
+            boundsMax[axis] = i == 0 ? p : std::max(boundsMax[axis], p);
+        }
+    }
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        header.positionOffset[axis] = boundsMin[axis];
+        header.positionScale[axis] = boundsMax[axis] - boundsMin[axis];
+    }
+
+    std::vector<uint8_t> data(static_cast<size_t>(header.indexOffset + static_cast<uint64_t>(header.indexSize) * source.indexCount), 0);
+    memcpy(data.data(), &header, sizeof(header));
+
+    MeshVertex* vertices = reinterpret_cast<MeshVertex*>(data.data() + header.vertexOffset);
+    for (uint32_t i = 0; i < source.vertexCount; ++i)
+    {
+        MeshVertex& vertex = vertices[i];
+        for (uint32_t axis = 0; axis < 3; ++axis)
+        {
+            float scale = header.positionScale[axis];
+            float t = scale > 0.0f ? (source.positions[i * 3 + axis] - header.positionOffset[axis]) / scale : 0.0f;
+            vertex.position[axis] = static_cast<uint16_t>(std::lround(std::clamp(t, 0.0f, 1.0f) * 65535.0f));
+        }
+        vertex.position[3] = 0;
+
+        const float up[3] = { 0.0f, 0.0f, 1.0f };
+        encodeOctahedral(source.normals != nullptr ? &source.normals[i * 3] : up, vertex.normal);
+
+        vertex.uv[0] = floatToHalf(source.uvs != nullptr ? source.uvs[i * 2] : 0.0f);
+        vertex.uv[1] = floatToHalf(source.uvs != nullptr ? source.uvs[i * 2 + 1] : 0.0f);
+    }
+
+    uint8_t* indices = data.data() + header.indexOffset;
+    for (uint32_t i = 0; i < source.indexCount; ++i)
+    {
+        if (header.indexSize == 2)
+        {
+            uint16_t index = static_cast<uint16_t>(source.indices[i]);
+            memcpy(indices + i * 2, &index, sizeof(index));
+        }
+        else
+        {
+            memcpy(indices + i * 4, &source.indices[i], sizeof(uint32_t));
+        }
+    }
+    return data;
+}
+
+bool Mesh::Write(const char* path, const MeshSource& source)
+{
+    std::vector<uint8_t> data = Encode(source);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (file.is_open() == false)
+    {
+        LOG_ERROR("Failed to write mesh: {}", path);
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return file.good();
+}
+
+bool Mesh::Load(VkDevice device, MemoryAllocator& allocator, UploadEngine& uploader, const char* path)
+{
+    MappedFile file;
+    if (file.Open(path) == false)
+    {
+        return false;
+    }
+    // 스테이징 링으로 바로 복사되므로 함수가 끝나면 매핑을 닫아도 됨
+    if (Create(device, allocator, uploader, file.GetData(), file.GetSize()) == false)
+    {
+        LOG_ERROR("Invalid mesh file: {}", path);
+        return false;
+    }
+    return true;
+}
+
+bool Mesh::Create(VkDevice device, MemoryAllocator& allocator, UploadEngine& uploader, const void* fileData, size_t fileSize)
+{
+    if (isValid(fileData, fileSize) == false)
+    {
+        return false;
+    }
+
+    MeshFileHeader header;
+    memcpy(&header, fileData, sizeof(header));
+    const uint8_t* bytes = static_cast<const uint8_t*>(fileData);
+
+    VkDeviceSize vertexSize = sizeof(MeshVertex) * static_cast<VkDeviceSize>(header.vertexCount);
+    VkDeviceSize indexSize = static_cast<VkDeviceSize>(header.indexSize) * header.indexCount;
+    mVertexBuffer = createBuffer(device, allocator, vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, mVertexAllocation);
+    mIndexBuffer = createBuffer(device, allocator, indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, mIndexAllocation);
+    uploader.UploadBuffer(mVertexBuffer, 0, bytes + header.vertexOffset, vertexSize);
+    uploader.UploadBuffer(mIndexBuffer, 0, bytes + header.indexOffset, indexSize);
+
+    mIndexType = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    mIndexCount = header.indexCount;
+    memcpy(mDecode.positionOffset, header.positionOffset, sizeof(mDecode.positionOffset));
+    memcpy(mDecode.positionScale, header.positionScale, sizeof(mDecode.positionScale));
+    return true;
+}
+
+void Mesh::Destroy(VkDevice device, MemoryAllocator& allocator)
+{
+    if (mVertexBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(device, mVertexBuffer, nullptr);
+        allocator.Free(mVertexAllocation);
+    }
+    if (mIndexBuffer != VK_NULL_HANDLE)
+    {
+        vkDestroyBuffer(device, mIndexBuffer, nullptr);
+        allocator.Free(mIndexAllocation);
+    }
+    mVertexBuffer = VK_NULL_HANDLE;
+    mIndexBuffer = VK_NULL_HANDLE;
+    mVertexAllocation = nullptr;
+    mIndexAllocation = nullptr;
+    mIndexCount = 0;
+}
+
+void Mesh::Bind(VkCommandBuffer cmd) const
+{
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 0, 1, &mVertexBuffer, &offset);
+    vkCmdBindIndexBuffer(cmd, mIndexBuffer, 0, mIndexType);
+}
+
+uint32_t Mesh::GetIndexCount() const
+{
+    return mIndexCount;
+}
+
+VkBuffer Mesh::GetVertexBuffer() const
+{
+    return mVertexBuffer;
+}
+
+VkBuffer Mesh::GetIndexBuffer() const
+{
+    return mIndexBuffer;
+}
+
+VkIndexType Mesh::GetIndexType() const
+{
+    return mIndexType;
+}
+
+const MeshDecode& Mesh::GetDecode() const
+{
+    return mDecode;
+}
+
+void Mesh::GetBoundingSphere(float outSphere[4]) const
+{
+    float lengthSquared = 0.0f;
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        outSphere[i] = mDecode.positionOffset[i] + mDecode.positionScale[i] * 0.5f;
+        lengthSquared += mDecode.positionScale[i] * mDecode.positionScale[i];
+    }
+    outSphere[3] = std::sqrt(lengthSquared) * 0.5f;
+}
+
+const VkVertexInputBindingDescription& Mesh::GetBindingDescription()
+{
+    static const VkVertexInputBindingDescription binding = { 0, sizeof(MeshVertex), VK_VERTEX_INPUT_RATE_VERTEX };
+    return binding;
+}
+
+const std::vector<VkVertexInputAttributeDescription>& Mesh::GetAttributeDescriptions()
+{
+    // 셰이더에서 UNORM/SNORM/SFLOAT 포맷으로 바로 float로 읽힘
+    static const std::vector<VkVertexInputAttributeDescription> attributes =
+    {
+        { 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(MeshVertex, position) },
+        { 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(MeshVertex, normal) },
+        { 2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(MeshVertex, uv) },
+    };
+    return attributes;
+}
+
+bool Mesh::isValid(const void* fileData, size_t fileSize)
+{
+    if (fileData == nullptr || fileSize < sizeof(MeshFileHeader))
+    {
+        return false;
+    }
+    MeshFileHeader header;
+    memcpy(&header, fileData, sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION)
+    {
+        return false;
+    }
+    if ((header.indexSize != 2 && header.indexSize != 4) || header.vertexCount == 0 || header.indexCount == 0)
+    {
+        return false;
+    }
+    // 오프셋은 파일에서 온 값이므로 더하기 전에 확인 (넘침 방지)
+    uint64_t vertexSize = sizeof(MeshVertex) * static_cast<uint64_t>(header.vertexCount);
+    uint64_t indexSize = static_cast<uint64_t>(header.indexSize) * header.indexCount;
+    if (header.vertexOffset < sizeof(MeshFileHeader) || header.vertexOffset > fileSize || vertexSize > fileSize - header.vertexOffset)
+    {
+        return false;
+    }
+    if (header.indexOffset < header.vertexOffset + vertexSize || header.indexOffset > fileSize || indexSize > fileSize - header.indexOffset)
+    {
+        return false;
+    }
+
+    // 범위를 벗어난 인덱스는 GPU에서 버퍼 밖을 읽음
+    const uint8_t* indexData = static_cast<const uint8_t*>(fileData) + header.indexOffset;
+    for (uint32_t i = 0; i < header.indexCount; ++i)
+    {
+        // Create()에 넘어온 데이터는 정렬을 보장하지 않음
+        uint32_t index = 0;
+        if (header.indexSize == 2)
+        {
+            uint16_t index16;
+            memcpy(&index16, indexData + static_cast<size_t>(i) * 2, sizeof(index16));
+            index = index16;
+        }
+        else
+        {
+            memcpy(&index, indexData + static_cast<size_t>(i) * 4, sizeof(index));
+        }
+        if (index >= header.vertexCount)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+VkBuffer Mesh::createBuffer(VkDevice device, MemoryAllocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage, Allocation*& outAllocation)
+{
+    VkBufferCreateInfo bufferCI{};
+    bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCI.size = size;
+    bufferCI.usage = usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkResult result = vkCreateBuffer(device, &bufferCI, nullptr, &buffer);
+    VkUtil::ExitIfFailed(result, "fail vkCreateBuffer (mesh)");
+    outAllocation = allocator.AllocateForBuffer(buffer, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    return buffer;
+}
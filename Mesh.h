@@ -0,0 +1,95 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "MemoryAllocator.h"
+#include "UploadEngine.h"
+
+// 16 bytes per vertex instead of 32 for float position / normal / uv
+struct MeshVertex
+{
+	// unorm16, dequantized with MeshDecode, w unused
+	uint16_t position[4];
+	// octahedral, snorm16
+	int16_t normal[2];
+	// half float
+	uint16_t uv[2];
+};
+
+// file layout : MeshFileHeader, vertex stream, index stream (each 16-byte aligned)
+struct MeshFileHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t vertexCount;
+	uint32_t indexCount;
+	// 2 or 4
+	uint32_t indexSize;
+	uint32_t reserved;
+	float positionOffset[4];
+	float positionScale[4];
+	uint64_t vertexOffset;
+	uint64_t indexOffset;
+};
+
+// vertex shader push constant, position = offset + unorm * scale
+struct MeshDecode
+{
+	float positionOffset[4];
+	float positionScale[4];
+};
+
+// float streams fed to the encoder, normals and uvs are optional
+struct MeshSource
+{
+	const float* positions;
+	const float* normals;
+	const float* uvs;
+	uint32_t vertexCount;
+	const uint32_t* indices;
+	uint32_t indexCount;
+};
+
+class Mesh
+{
+public:
+	enum
+	{
+		MAGIC = 0x534D4B56, // "VKMS"
+		VERSION = 1
+	};
+
+	Mesh();
+
+	// quantize into the file layout, 16-bit indices when the vertex count allows it
+	static std::vector<uint8_t> Encode(const MeshSource& source);
+	static bool Write(const char* path, const MeshSource& source);
+
+	// memory-maps the file and streams it straight into the staging ring
+	bool Load(VkDevice device, MemoryAllocator& allocator, UploadEngine& uploader, const char* path);
+	bool Create(VkDevice device, MemoryAllocator& allocator, UploadEngine& uploader, const void* fileData, size_t fileSize);
+	void Destroy(VkDevice device, MemoryAllocator& allocator);
+
+	void Bind(VkCommandBuffer cmd) const;
+	uint32_t GetIndexCount() const;
+	VkBuffer GetVertexBuffer() const;
+	VkBuffer GetIndexBuffer() const;
+	VkIndexType GetIndexType() const;
+	const MeshDecode& GetDecode() const;
+	// sphere around the quantization box, xyz center, w radius
+	void GetBoundingSphere(float outSphere[4]) const;
+
+	static const VkVertexInputBindingDescription& GetBindingDescription();
+	static const std::vector<VkVertexInputAttributeDescription>& GetAttributeDescriptions();
+
+private:
+	VkBuffer mVertexBuffer;
+	VkBuffer mIndexBuffer;
+	Allocation* mVertexAllocation;
+	Allocation* mIndexAllocation;
+	VkIndexType mIndexType;
+	uint32_t mIndexCount;
+	MeshDecode mDecode;
+
+	static bool isValid(const void* fileData, size_t fileSize);
+	VkBuffer createBuffer(VkDevice device, MemoryAllocator& allocator, VkDeviceSize size, VkBufferUsageFlags usage, Allocation*& outAllocation);
+};
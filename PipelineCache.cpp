@@ -0,0 +1,177 @@
+#include "PipelineCache.h"
+#include "Logger.h"
+#include "VkUtil.h"
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include <cstring>
+
+PipelineCache::PipelineCache()
+	:mPhysicalDevice(VK_NULL_HANDLE)
+	,mDevice(VK_NULL_HANDLE)
+	,mCache(VK_NULL_HANDLE)
+	,mWarm(false)
+	,mLoadedBytes(0)
+	,mSaveIntervalSec(0.0)
+{
+}
+
+void PipelineCache::Create(VkPhysicalDevice physicalDevice, VkDevice device, const char* path, double saveIntervalSec)
+{
+    mPhysicalDevice = physicalDevice;
+    mDevice = device;
+    mPath = path != nullptr ? path : "";
+    mSaveIntervalSec = saveIntervalSec;
+    mLastSave = std::chrono::steady_clock::now();
+
+    std::vector<char> data;
+    std::error_code ec;
+    if (mPath.empty() == false && std::filesystem::exists(mPath, ec))
+    {
+        data = VkUtil::ReadFile(mPath.c_str());
+        if (isCompatible(data) == false)
+        {
+            // 다른 드라이버/GPU에서 만든 캐시는 버리고 새로 시작
+            LOG_WARNING("Pipeline cache ignored (incompatible header): {}", mPath);
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheCI{};
+    cacheCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheCI.initialDataSize = data.size();
+    cacheCI.pInitialData = data.empty() ? nullptr : data.data();
+
+    VkResult result = vkCreatePipelineCache(mDevice, &cacheCI, nullptr, &mCache);
+    if (result != VK_SUCCESS && data.empty() == false)
+    {
+        // 헤더는 맞아도 내용이 깨진 경우
+        cacheCI.initialDataSize = 0;
+        cacheCI.pInitialData = nullptr;
+        data.clear();
+        result = vkCreatePipelineCache(mDevice, &cacheCI, nullptr, &mCache);
+    }
+    VkUtil::ExitIfFailed(result, "fail vkCreatePipelineCache");
+
+    mWarm = data.empty() == false;
+    mLoadedBytes = data.size();
+}
+
+void PipelineCache::Destroy()
+{
+    if (mCache == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    Save();
+    vkDestroyPipelineCache(mDevice, mCache, nullptr);
+    mCache = VK_NULL_HANDLE;
+}
+
+VkPipelineCache PipelineCache::Get() const
+{
+    return mCache;
+}
+
+bool PipelineCache::IsWarm() const
+{
+    return mWarm;
+}
+
+size_t PipelineCache::GetLoadedBytes() const
+{
+    return mLoadedBytes;
+}
+
+void PipelineCache::Save()
+{
+    mLastSave = std::chrono::steady_clock::now();
+    if (mPath.empty())
+    {
+        return;
+    }
+
+    size_t size = 0;
+    VkResult result = vkGetPipelineCacheData(mDevice, mCache, &size, nullptr);
+    if (result != VK_SUCCESS || size == 0)
+    {
+        return;
+    }
+    std::vector<char> data(size);
+    result = vkGetPipelineCacheData(mDevice, mCache, &size, data.data());
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE)
+    {
+        return;
+    }
+
+    // 쓰는 도중 죽어도 기존 파일이 깨지지 않도록 임시 파일에 쓰고 rename
+    std::string tmpPath = mPath + ".tmp";
+    {
+        std::ofstream file(tmpPath, std::ios::binary | std::ios::trunc);
+        if (file.is_open() == false)
+        {
+            LOG_ERROR("Failed to open file: {}", tmpPath);
+            return;
+        }
+        file.write(data.data(), static_cast<std::streamsize>(size));
+        if (file.good() == false)
+        {
+            LOG_ERROR("Failed to write file: {}", tmpPath);
+            return;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath, mPath, ec);
+    if (ec)
+    {
+        LOG_ERROR("Failed to replace pipeline cache: {}", ec.message());
+        std::filesystem::remove(tmpPath, ec);
+    }
+}
+
+void PipelineCache::SaveIfDue()
+{
+    if (mSaveIntervalSec <= 0.0)
+    {
+        return;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - mLastSave).count();
+    if (elapsed >= mSaveIntervalSec)
+    {
+        Save();
+    }
+}
+
+bool PipelineCache::isCompatible(const std::vector<char>& data) const
+{
+    // VkPipelineCacheHeaderVersionOne
+    // uint32 headerSize, uint32 headerVersion, uint32 vendorID, uint32 deviceID, uint8 pipelineCacheUUID[16]
+    const size_t kHeaderSize = 16 + VK_UUID_SIZE;
+    if (data.size() < kHeaderSize)
+    {
+        return false;
+    }
+
+    uint32_t headerSize = 0;
+    uint32_t headerVersion = 0;
+    uint32_t vendorID = 0;
+    uint32_t deviceID = 0;
+    std::memcpy(&headerSize, data.data(), 4);
+    std::memcpy(&headerVersion, data.data() + 4, 4);
+    std::memcpy(&vendorID, data.data() + 8, 4);
+    std::memcpy(&deviceID, data.data() + 12, 4);
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(mPhysicalDevice, &props);
+
+    if (headerSize < kHeaderSize || headerSize > data.size())
+    {
+        return false;
+    }
+    if (headerVersion != 1 || vendorID != props.vendorID || deviceID != props.deviceID)
+    {
+        return false;
+    }
+    return std::memcmp(data.data() + 16, props.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// VkPipelineCache persisted to disk between runs
+class PipelineCache
+{
+public:
+	PipelineCache();
+
+	// empty path : in-memory only
+	void Create(VkPhysicalDevice physicalDevice, VkDevice device, const char* path, double saveIntervalSec);
+	void Destroy();
+
+	VkPipelineCache Get() const;
+	bool IsWarm() const;
+	size_t GetLoadedBytes() const;
+
+	// write to "<path>.tmp" and rename over the old file
+	void Save();
+	// periodic save, call once per frame
+	void SaveIfDue();
+
+private:
+	VkPhysicalDevice mPhysicalDevice;
+	VkDevice mDevice;
+	VkPipelineCache mCache;
+	std::string mPath;
+	bool mWarm;
+	size_t mLoadedBytes;
+
+	double mSaveIntervalSec;
+	std::chrono::steady_clock::time_point mLastSave;
+
+	bool isCompatible(const std::vector<char>& data) const;
+};
@@ -0,0 +1,183 @@
+#include "PipelineCompiler.h"
+#include <algorithm>
+
+PipelineCompiler::PipelineCompiler()
+	:mDevice(VK_NULL_HANDLE)
+	,mCache(VK_NULL_HANDLE)
+	,mPendingCount(0)
+	,mRunning(false)
+{
+}
+
+void PipelineCompiler::Create(VkDevice device, VkPipelineCache cache, uint32_t threadCount)
+{
+    mDevice = device;
+    mCache = cache;
+    mRunning = true;
+    threadCount = std::max(threadCount, 1u);
+    for (uint32_t i = 0; i < threadCount; ++i)
+    {
+        mThreads.emplace_back(&PipelineCompiler::workerLoop, this);
+    }
+}
+
+void PipelineCompiler::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRunning = false;
+        // 아직 시작 안 한 것은 버림
+        mPendingCount -= static_cast<uint32_t>(mQueue.size());
+        mQueue.clear();
+    }
+    mWake.notify_all();
+    for (std::thread& thread : mThreads)
+    {
+        thread.join();
+    }
+    mThreads.clear();
+
+    for (std::unique_ptr<Entry>& entry : mEntries)
+    {
+        if (entry->status.load() == STATUS_READY)
+        {
+            vkDestroyPipeline(mDevice, entry->pipeline, nullptr);
+        }
+    }
+    mEntries.clear();
+    mDevice = VK_NULL_HANDLE;
+}
+
+PipelineHandle PipelineCompiler::Request(const char* name, PipelineBuilder builder, PipelineHandle fallback)
+{
+    std::unique_ptr<Entry> entry(new Entry());
+    entry->builder = std::move(builder);
+    entry->fallback = fallback;
+    entry->status = STATUS_QUEUED;
+    entry->pipeline = VK_NULL_HANDLE;
+    entry->stats = {};
+    entry->stats.name = name;
+    entry->requestTime = std::chrono::steady_clock::now();
+
+    PipelineHandle handle;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        handle = static_cast<PipelineHandle>(mEntries.size());
+        mQueue.push_back(entry.get());
+        mEntries.push_back(std::move(entry));
+        ++mPendingCount;
+    }
+    mWake.notify_one();
+    return handle;
+}
+
+VkPipeline PipelineCompiler::Get(PipelineHandle handle) const
+{
+    // 대체 파이프라인도 아직이면 그 대체로, 끝까지 없으면 그리지 않음
+    // 대체끼리 순환해도 끝나도록 횟수 제한
+    for (size_t depth = 0; depth < mEntries.size() && handle < mEntries.size(); ++depth)
+    {
+        const Entry& entry = *mEntries[handle];
+        if (entry.status.load(std::memory_order_acquire) == STATUS_READY)
+        {
+            return entry.pipeline;
+        }
+        handle = entry.fallback;
+    }
+    return VK_NULL_HANDLE;
+}
+
+bool PipelineCompiler::IsReady(PipelineHandle handle) const
+{
+    return handle < mEntries.size() && mEntries[handle]->status.load(std::memory_order_acquire) == STATUS_READY;
+}
+
+uint32_t PipelineCompiler::GetPendingCount() const
+{
+    return mPendingCount.load();
+}
+
+void PipelineCompiler::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this]() { return mPendingCount.load() == 0; });
+}
+
+std::vector<PipelineCompileStats> PipelineCompiler::GetStats() const
+{
+    std::vector<PipelineCompileStats> stats;
+    std::lock_guard<std::mutex> lock(mMutex);
+    stats.reserve(mEntries.size());
+    for (const std::unique_ptr<Entry>& entry : mEntries)
+    {
+        uint32_t status = entry->status.load(std::memory_order_acquire);
+        if (status == STATUS_READY || status == STATUS_FAILED)
+        {
+            stats.push_back(entry->stats);
+        }
+        else
+        {
+            PipelineCompileStats pending{};
+            pending.name = entry->stats.name;
+            stats.push_back(pending);
+        }
+    }
+    return stats;
+}
+
+void PipelineCompiler::workerLoop()
+{
+    while (true)
+    {
+        Entry* entry = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWake.wait(lock, [this]() { return mQueue.empty() == false || mRunning == false; });
+            if (mRunning == false)
+            {
+                return;
+            }
+            entry = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        compile(*entry);
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            --mPendingCount;
+        }
+        mIdle.notify_all();
+    }
+}
+
+void PipelineCompiler::compile(Entry& entry)
+{
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point start = Clock::now();
+    entry.status.store(STATUS_COMPILING);
+
+    VkPipelineCreationFeedback feedback{};
+    VkPipelineCreationFeedbackCreateInfo feedbackCI{};
+    feedbackCI.sType = VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO;
+    feedbackCI.pPipelineCreationFeedback = &feedback;
+
+    // VkPipelineCache는 내부 동기화되므로 여러 스레드에서 같이 써도 됨
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = entry.builder(mCache, &feedbackCI, pipeline);
+    Clock::time_point end = Clock::now();
+
+    entry.stats.queuedMs = std::chrono::duration<double, std::milli>(start - entry.requestTime).count();
+    entry.stats.compileMs = std::chrono::duration<double, std::milli>(end - start).count();
+    entry.stats.cacheHit = (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) != 0
+        && (feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) != 0;
+    entry.stats.ready = result == VK_SUCCESS;
+    entry.stats.failed = result != VK_SUCCESS;
+    entry.pipeline = pipeline;
+    // 캡처한 상태는 더 필요 없음
+    entry.builder = nullptr;
+    entry.status.store(result == VK_SUCCESS ? STATUS_READY : STATUS_FAILED, std::memory_order_release);
+}
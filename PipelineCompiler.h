@@ -0,0 +1,92 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+
+typedef uint32_t PipelineHandle;
+const PipelineHandle INVALID_PIPELINE = UINT32_MAX;
+
+// Creates the pipeline with the given cache. feedback must be chained into the create
+// info's pNext (it may be ignored). Runs on a compile thread, so everything it uses has
+// to be captured by value or outlive the compile.
+typedef std::function<VkResult(VkPipelineCache cache, VkPipelineCreationFeedbackCreateInfo* feedback, VkPipeline& outPipeline)> PipelineBuilder;
+
+struct PipelineCompileStats
+{
+	std::string name;
+	// request to start of compile
+	double queuedMs;
+	double compileMs;
+	// the driver found the whole pipeline in the VkPipelineCache
+	bool cacheHit;
+	bool ready;
+	bool failed;
+};
+
+// Compiles pipelines on background threads against a shared VkPipelineCache.
+// Request*() returns immediately; Get() gives the pipeline once it is built,
+// the fallback's pipeline until then, or VK_NULL_HANDLE (skip the draw).
+class PipelineCompiler
+{
+public:
+	PipelineCompiler();
+
+	void Create(VkDevice device, VkPipelineCache cache, uint32_t threadCount);
+	// waits for compiles in progress, drops queued ones and destroys every pipeline
+	void Destroy();
+
+	// owning thread only, not while other threads are calling Get()
+	PipelineHandle Request(const char* name, PipelineBuilder builder, PipelineHandle fallback = INVALID_PIPELINE);
+
+	VkPipeline Get(PipelineHandle handle) const;
+	bool IsReady(PipelineHandle handle) const;
+	// requests not finished yet
+	uint32_t GetPendingCount() const;
+	void WaitIdle();
+
+	std::vector<PipelineCompileStats> GetStats() const;
+
+private:
+	enum Status
+	{
+		STATUS_QUEUED,
+		STATUS_COMPILING,
+		STATUS_READY,
+		STATUS_FAILED
+	};
+
+	struct Entry
+	{
+		PipelineBuilder builder;
+		PipelineHandle fallback;
+		std::atomic<uint32_t> status;
+		// written by the compile thread before status becomes READY / FAILED
+		VkPipeline pipeline;
+		PipelineCompileStats stats;
+		std::chrono::steady_clock::time_point requestTime;
+	};
+
+	VkDevice mDevice;
+	VkPipelineCache mCache;
+	std::vector<std::thread> mThreads;
+
+	// only the owning thread adds entries, references stay valid
+	std::deque<std::unique_ptr<Entry>> mEntries;
+	std::deque<Entry*> mQueue;
+	mutable std::mutex mMutex;
+	std::condition_variable mWake;
+	std::condition_variable mIdle;
+	std::atomic<uint32_t> mPendingCount;
+	bool mRunning;
+
+	void workerLoop();
+	void compile(Entry& entry);
+};
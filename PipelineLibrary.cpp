@@ -0,0 +1,345 @@
+#include "PipelineLibrary.h"
+#include "VkUtil.h"
+
+namespace
+{
+    // 필드 단위로 붙여서 구조체 패딩 값이 키에 섞이지 않게 함
+    template <typename T>
+    void appendField(std::string& key, const T& value)
+    {
+        key.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+}
+
+PipelineLibrary::PipelineLibrary()
+	:mDevice(VK_NULL_HANDLE)
+	,mCompiler(nullptr)
+	,mShaderRegistry(nullptr)
+	,mStats()
+{
+}
+
+void PipelineLibrary::Create(VkDevice device, PipelineCompiler& compiler, const ShaderRegistry& shaderRegistry)
+{
+    mDevice = device;
+    mCompiler = &compiler;
+    mShaderRegistry = &shaderRegistry;
+}
+
+void PipelineLibrary::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    for (auto& entry : mPipelineLayouts)
+    {
+        vkDestroyPipelineLayout(mDevice, entry.second, nullptr);
+    }
+    for (auto& entry : mSetLayouts)
+    {
+        vkDestroyDescriptorSetLayout(mDevice, entry.second, nullptr);
+    }
+    mPipelineLayouts.clear();
+    mSetLayouts.clear();
+    mPipelines.clear();
+    mDevice = VK_NULL_HANDLE;
+}
+
+VkDescriptorSetLayout PipelineLibrary::GetDescriptorSetLayout(const DescriptorSetLayoutDesc& desc)
+{
+    std::string key = makeKey(desc);
+    auto found = mSetLayouts.find(key);
+    if (found != mSetLayouts.end())
+    {
+        ++mStats.hits;
+        return found->second;
+    }
+    ++mStats.misses;
+
+    VkDescriptorSetLayoutCreateInfo layoutCI{};
+    layoutCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCI.flags = desc.flags;
+    layoutCI.bindingCount = desc.bindingCount;
+    layoutCI.pBindings = desc.bindings;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI{};
+    bindingFlagsCI.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsCI.bindingCount = desc.bindingCount;
+    bindingFlagsCI.pBindingFlags = desc.bindingFlags;
+    for (uint32_t i = 0; i < desc.bindingCount; ++i)
+    {
+        if (desc.bindingFlags[i] != 0)
+        {
+            layoutCI.pNext = &bindingFlagsCI;
+            break;
+        }
+    }
+
+    VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+    VkResult result = vkCreateDescriptorSetLayout(mDevice, &layoutCI, nullptr, &setLayout);
+    VkUtil::ExitIfFailed(result, "fail vkCreateDescriptorSetLayout");
+    mSetLayouts.emplace(std::move(key), setLayout);
+    return setLayout;
+}
+
+VkPipelineLayout PipelineLibrary::GetPipelineLayout(const PipelineLayoutDesc& desc)
+{
+    std::string key = makeKey(desc);
+    auto found = mPipelineLayouts.find(key);
+    if (found != mPipelineLayouts.end())
+    {
+        ++mStats.hits;
+        return found->second;
+    }
+    ++mStats.misses;
+
+    VkPipelineLayoutCreateInfo layoutCI{};
+    layoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutCI.setLayoutCount = desc.setLayoutCount;
+    layoutCI.pSetLayouts = desc.setLayouts;
+    layoutCI.pushConstantRangeCount = desc.pushConstantRangeCount;
+    layoutCI.pPushConstantRanges = desc.pushConstantRanges;
+
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkResult result = vkCreatePipelineLayout(mDevice, &layoutCI, nullptr, &pipelineLayout);
+    VkUtil::ExitIfFailed(result, "fail vkCreatePipelineLayout");
+    mPipelineLayouts.emplace(std::move(key), pipelineLayout);
+    return pipelineLayout;
+}
+
+PipelineHandle PipelineLibrary::GetGraphicsPipeline(const char* name, const GraphicsPipelineDesc& desc, PipelineHandle fallback)
+{
+    std::string key = makeKey(desc);
+    auto found = mPipelines.find(key);
+    if (found != mPipelines.end())
+    {
+        ++mStats.hits;
+        return found->second;
+    }
+    ++mStats.misses;
+
+    PipelineHandle handle = mCompiler->Request(name, makeBuilder(mDevice, desc), fallback);
+    mPipelines.emplace(std::move(key), handle);
+    return handle;
+}
+
+size_t PipelineLibrary::GetPipelineCount() const
+{
+    return mPipelines.size();
+}
+
+const PipelineLibraryStats& PipelineLibrary::GetStats() const
+{
+    return mStats;
+}
+
+std::string PipelineLibrary::makeKey(const DescriptorSetLayoutDesc& desc)
+{
+    std::string key;
+    appendField(key, desc.flags);
+    appendField(key, desc.bindingCount);
+    for (uint32_t i = 0; i < desc.bindingCount; ++i)
+    {
+        const VkDescriptorSetLayoutBinding& binding = desc.bindings[i];
+        appendField(key, binding.binding);
+        appendField(key, binding.descriptorType);
+        appendField(key, binding.descriptorCount);
+        appendField(key, binding.stageFlags);
+        appendField(key, desc.bindingFlags[i]);
+    }
+    return key;
+}
+
+std::string PipelineLibrary::makeKey(const PipelineLayoutDesc& desc)
+{
+    std::string key;
+    appendField(key, desc.setLayoutCount);
+    for (uint32_t i = 0; i < desc.setLayoutCount; ++i)
+    {
+        appendField(key, desc.setLayouts[i]);
+    }
+    appendField(key, desc.pushConstantRangeCount);
+    for (uint32_t i = 0; i < desc.pushConstantRangeCount; ++i)
+    {
+        const VkPushConstantRange& range = desc.pushConstantRanges[i];
+        appendField(key, range.stageFlags);
+        appendField(key, range.offset);
+        appendField(key, range.size);
+    }
+    return key;
+}
+
+std::string PipelineLibrary::makeKey(const GraphicsPipelineDesc& desc) const
+{
+    std::string key;
+    appendShader(key, desc.vertexShader);
+    appendShader(key, desc.fragmentShader);
+    appendField(key, desc.layout);
+    appendField(key, desc.vertexStride);
+    appendField(key, desc.vertexAttributeCount);
+    for (uint32_t i = 0; i < desc.vertexAttributeCount; ++i)
+    {
+        const VkVertexInputAttributeDescription& attribute = desc.vertexAttributes[i];
+        appendField(key, attribute.location);
+        appendField(key, attribute.binding);
+        appendField(key, attribute.format);
+        appendField(key, attribute.offset);
+    }
+    appendField(key, desc.topology);
+    appendField(key, desc.polygonMode);
+    appendField(key, desc.cullMode);
+    appendField(key, desc.frontFace);
+    appendField(key, desc.blendEnable);
+    // 블렌딩이 꺼져 있으면 팩터는 결과에 영향이 없으므로 키에서 뺌
+    if (desc.blendEnable)
+    {
+        appendField(key, desc.srcColorBlendFactor);
+        appendField(key, desc.dstColorBlendFactor);
+        appendField(key, desc.colorBlendOp);
+        appendField(key, desc.srcAlphaBlendFactor);
+        appendField(key, desc.dstAlphaBlendFactor);
+        appendField(key, desc.alphaBlendOp);
+    }
+    appendField(key, desc.depthTestEnable);
+    appendField(key, desc.depthWriteEnable);
+    appendField(key, desc.depthCompareOp);
+    appendField(key, desc.colorFormat);
+    appendField(key, desc.depthFormat);
+    appendField(key, desc.stencilFormat);
+    return key;
+}
+
+void PipelineLibrary::appendShader(std::string& key, VkShaderModule module) const
+{
+    uint64_t hash = 0;
+    uint64_t checkHash = 0;
+    if (module != VK_NULL_HANDLE)
+    {
+        mShaderRegistry->GetHash(module, hash, checkHash);
+    }
+    appendField(key, hash);
+    appendField(key, checkHash);
+}
+
+PipelineBuilder PipelineLibrary::makeBuilder(VkDevice device, const GraphicsPipelineDesc& desc)
+{
+    // 컴파일 스레드에서 실행되므로 desc는 값으로 캡처
+    return [device, desc](VkPipelineCache cache, VkPipelineCreationFeedbackCreateInfo* feedback, VkPipeline& outPipeline)
+    {
+        VkPipelineShaderStageCreateInfo shaders[2]{};
+        uint32_t stageCount = 0;
+        shaders[stageCount].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        shaders[stageCount].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaders[stageCount].module = desc.vertexShader;
+        shaders[stageCount].pName = "main";
+        ++stageCount;
+        if (desc.fragmentShader != VK_NULL_HANDLE)
+        {
+            shaders[stageCount].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            shaders[stageCount].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+            shaders[stageCount].module = desc.fragmentShader;
+            shaders[stageCount].pName = "main";
+            ++stageCount;
+        }
+
+        VkVertexInputBindingDescription vertexBinding{};
+        vertexBinding.binding = 0;
+        vertexBinding.stride = desc.vertexStride;
+        vertexBinding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        VkPipelineVertexInputStateCreateInfo vertexInputCI{};
+        vertexInputCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        if (desc.vertexStride > 0)
+        {
+            vertexInputCI.vertexBindingDescriptionCount = 1;
+            vertexInputCI.pVertexBindingDescriptions = &vertexBinding;
+            vertexInputCI.vertexAttributeDescriptionCount = desc.vertexAttributeCount;
+            vertexInputCI.pVertexAttributeDescriptions = desc.vertexAttributes;
+        }
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssemblyCI{};
+        inputAssemblyCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssemblyCI.topology = desc.topology;
+        inputAssemblyCI.primitiveRestartEnable = VK_FALSE;
+
+        // viewport/scissor는 동적 상태 - 리사이즈 때 파이프라인을 다시 만들지 않음
+        VkPipelineViewportStateCreateInfo viewportCI{};
+        viewportCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportCI.viewportCount = 1;
+        viewportCI.scissorCount = 1;
+
+        VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo dynamicCI{};
+        dynamicCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamicCI.dynamicStateCount = 2;
+        dynamicCI.pDynamicStates = dynamicStates;
+
+        VkPipelineRasterizationStateCreateInfo rasterizationCI{};
+        rasterizationCI.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizationCI.depthClampEnable = VK_FALSE;
+        rasterizationCI.rasterizerDiscardEnable = VK_FALSE;
+        rasterizationCI.polygonMode = desc.polygonMode;
+        rasterizationCI.lineWidth = 1.0f;
+        rasterizationCI.cullMode = desc.cullMode;
+        rasterizationCI.frontFace = desc.frontFace;
+
+        VkPipelineMultisampleStateCreateInfo multisampleCI{};
+        multisampleCI.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampleCI.sampleShadingEnable = VK_FALSE;
+        multisampleCI.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+        VkPipelineDepthStencilStateCreateInfo depthStencilCI{};
+        depthStencilCI.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencilCI.depthTestEnable = desc.depthTestEnable;
+        depthStencilCI.depthWriteEnable = desc.depthWriteEnable;
+        depthStencilCI.depthCompareOp = desc.depthCompareOp;
+
+        VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = desc.blendEnable;
+        colorBlendAttachment.srcColorBlendFactor = desc.srcColorBlendFactor;
+        colorBlendAttachment.dstColorBlendFactor = desc.dstColorBlendFactor;
+        colorBlendAttachment.colorBlendOp = desc.colorBlendOp;
+        colorBlendAttachment.srcAlphaBlendFactor = desc.srcAlphaBlendFactor;
+        colorBlendAttachment.dstAlphaBlendFactor = desc.dstAlphaBlendFactor;
+        colorBlendAttachment.alphaBlendOp = desc.alphaBlendOp;
+
+        uint32_t colorCount = desc.colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
+        VkPipelineColorBlendStateCreateInfo colorBlendCI{};
+        colorBlendCI.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlendCI.logicOpEnable = VK_FALSE;
+        colorBlendCI.logicOp = VK_LOGIC_OP_COPY;
+        colorBlendCI.attachmentCount = colorCount;
+        colorBlendCI.pAttachments = &colorBlendAttachment;
+
+        // dynamic rendering - 렌더패스 대신 어태치먼트 포맷만 지정
+        VkPipelineRenderingCreateInfo renderingCI{};
+        renderingCI.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        renderingCI.colorAttachmentCount = colorCount;
+        renderingCI.pColorAttachmentFormats = &desc.colorFormat;
+        renderingCI.depthAttachmentFormat = desc.depthFormat;
+        renderingCI.stencilAttachmentFormat = desc.stencilFormat;
+        feedback->pNext = &renderingCI;
+
+        VkGraphicsPipelineCreateInfo pipelineCI{};
+        pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineCI.pNext = feedback;
+        pipelineCI.stageCount = stageCount;
+        pipelineCI.pStages = shaders;
+        pipelineCI.pVertexInputState = &vertexInputCI;
+        pipelineCI.pInputAssemblyState = &inputAssemblyCI;
+        pipelineCI.pViewportState = &viewportCI;
+        pipelineCI.pRasterizationState = &rasterizationCI;
+        pipelineCI.pMultisampleState = &multisampleCI;
+        bool hasDepthStencil = desc.depthFormat != VK_FORMAT_UNDEFINED || desc.stencilFormat != VK_FORMAT_UNDEFINED;
+        pipelineCI.pDepthStencilState = hasDepthStencil ? &depthStencilCI : nullptr;
+        pipelineCI.pColorBlendState = &colorBlendCI;
+        pipelineCI.pDynamicState = &dynamicCI;
+        pipelineCI.layout = desc.layout;
+        pipelineCI.renderPass = VK_NULL_HANDLE;
+        pipelineCI.subpass = 0;
+        return vkCreateGraphicsPipelines(device, cache, 1, &pipelineCI, nullptr, &outPipeline);
+    };
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <unordered_map>
+#include "PipelineCompiler.h"
+#include "ShaderRegistry.h"
+
+struct DescriptorSetLayoutDesc
+{
+	enum
+	{
+		MAX_BINDINGS = 8
+	};
+
+	VkDescriptorSetLayoutCreateFlags flags = 0;
+	uint32_t bindingCount = 0;
+	// pImmutableSamplers is not supported
+	VkDescriptorSetLayoutBinding bindings[MAX_BINDINGS] = {};
+	// descriptor indexing flags per binding, all 0 : no VkDescriptorSetLayoutBindingFlagsCreateInfo
+	VkDescriptorBindingFlags bindingFlags[MAX_BINDINGS] = {};
+};
+
+struct PipelineLayoutDesc
+{
+	enum
+	{
+		MAX_SET_LAYOUTS = 4,
+		MAX_PUSH_CONSTANT_RANGES = 2
+	};
+
+	uint32_t setLayoutCount = 0;
+	VkDescriptorSetLayout setLayouts[MAX_SET_LAYOUTS] = {};
+	uint32_t pushConstantRangeCount = 0;
+	VkPushConstantRange pushConstantRanges[MAX_PUSH_CONSTANT_RANGES] = {};
+};
+
+// everything that goes into a graphics pipeline; viewport and scissor are always dynamic
+struct GraphicsPipelineDesc
+{
+	enum
+	{
+		MAX_VERTEX_ATTRIBUTES = 8
+	};
+
+	// created through the ShaderRegistry, keyed by content hash
+	VkShaderModule vertexShader = VK_NULL_HANDLE;
+	VkShaderModule fragmentShader = VK_NULL_HANDLE;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+
+	// one interleaved vertex binding, stride 0 : no vertex input
+	uint32_t vertexStride = 0;
+	uint32_t vertexAttributeCount = 0;
+	VkVertexInputAttributeDescription vertexAttributes[MAX_VERTEX_ATTRIBUTES] = {};
+	VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+	VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+	VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+	VkBool32 blendEnable = VK_FALSE;
+	VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp colorBlendOp = VK_BLEND_OP_ADD;
+	VkBlendFactor srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+	VkBlendFactor dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+	VkBlendOp alphaBlendOp = VK_BLEND_OP_ADD;
+
+	VkBool32 depthTestEnable = VK_FALSE;
+	VkBool32 depthWriteEnable = VK_FALSE;
+	VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+	// VK_FORMAT_UNDEFINED : no attachment of that kind
+	VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+	VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+	VkFormat stencilFormat = VK_FORMAT_UNDEFINED;
+};
+
+struct PipelineLibraryStats
+{
+	// requests answered with an object that already existed
+	uint64_t hits;
+	uint64_t misses;
+};
+
+// Descriptions are serialized field by field into a key (no struct padding involved)
+// and looked up in a hash map, so an identical description always gives back the
+// same object. Graphics pipelines are built through the PipelineCompiler.
+class PipelineLibrary
+{
+public:
+	PipelineLibrary();
+
+	void Create(VkDevice device, PipelineCompiler& compiler, const ShaderRegistry& shaderRegistry);
+	// destroys the set layouts and pipeline layouts, pipelines belong to the compiler
+	void Destroy();
+
+	VkDescriptorSetLayout GetDescriptorSetLayout(const DescriptorSetLayoutDesc& desc);
+	VkPipelineLayout GetPipelineLayout(const PipelineLayoutDesc& desc);
+	// name is only used for the compile metrics of the first request
+	PipelineHandle GetGraphicsPipeline(const char* name, const GraphicsPipelineDesc& desc, PipelineHandle fallback = INVALID_PIPELINE);
+
+	size_t GetPipelineCount() const;
+	const PipelineLibraryStats& GetStats() const;
+
+private:
+	VkDevice mDevice;
+	PipelineCompiler* mCompiler;
+	const ShaderRegistry* mShaderRegistry;
+
+	std::unordered_map<std::string, VkDescriptorSetLayout> mSetLayouts;
+	std::unordered_map<std::string, VkPipelineLayout> mPipelineLayouts;
+	std::unordered_map<std::string, PipelineHandle> mPipelines;
+	PipelineLibraryStats mStats;
+
+	static std::string makeKey(const DescriptorSetLayoutDesc& desc);
+	static std::string makeKey(const PipelineLayoutDesc& desc);
+	// shaders by content, module handles are reused once the registry destroys them
+	std::string makeKey(const GraphicsPipelineDesc& desc) const;
+	void appendShader(std::string& key, VkShaderModule module) const;
+	static PipelineBuilder makeBuilder(VkDevice device, const GraphicsPipelineDesc& desc);
+};
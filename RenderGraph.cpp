@@ -0,0 +1,676 @@
+#include "RenderGraph.h"
+#include "VkUtil.h"
+#include <algorithm>
+
+namespace
+{
+    struct AccessInfo
+    {
+        VkPipelineStageFlags2 stage;
+        VkAccessFlags2 access;
+        VkImageLayout layout;
+        VkImageUsageFlags usage;
+        bool write;
+    };
+
+    // RGAccess 순서대로
+    const AccessInfo kAccessInfos[] =
+    {
+        // ColorAttachmentWrite
+        { VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true },
+        // DepthAttachmentWrite
+        { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+            VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true },
+        // DepthAttachmentRead
+        { VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+            VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false },
+        // SampledRead
+        { VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false },
+        // StorageRead
+        { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false },
+        // StorageWrite
+        { VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true },
+        // VertexStorageRead
+        { VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+            VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false },
+        // IndirectRead, 버퍼 전용
+        { VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+            VK_IMAGE_LAYOUT_UNDEFINED, 0, false },
+        // TransferRead
+        { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false },
+        // TransferWrite
+        { VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true },
+        // Present, 이후 접근은 present 세마포어가 맡음
+        { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+            VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0, false },
+        // None
+        { VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE,
+            VK_IMAGE_LAYOUT_UNDEFINED, 0, false },
+    };
+    static_assert(sizeof(kAccessInfos) / sizeof(kAccessInfos[0]) == static_cast<size_t>(RGAccess::None) + 1, "kAccessInfos out of sync with RGAccess");
+
+    // 가용(flush)이 필요한 접근만
+    const VkAccessFlags2 kWriteAccessMask = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+    // 어태치먼트로만 쓰이면 타일 메모리에만 있어도 됨
+    const VkImageUsageFlags kAttachmentUsageMask = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+
+    const uint32_t NO_LEVEL = UINT32_MAX;
+
+    const AccessInfo& getAccessInfo(RGAccess access)
+    {
+        return kAccessInfos[static_cast<size_t>(access)];
+    }
+}
+
+RenderGraph::RenderGraph()
+	:mDevice(VK_NULL_HANDLE)
+	,mAllocator(nullptr)
+	,mStats()
+{
+}
+
+void RenderGraph::Create(VkDevice device, MemoryAllocator& allocator, DeferDestroyFunction deferDestroy)
+{
+    mDevice = device;
+    mAllocator = &allocator;
+    mDeferDestroy = std::move(deferDestroy);
+}
+
+void RenderGraph::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    // 장치가 idle인 상태에서 불림
+    destroyTransients(false);
+    Reset();
+    mDevice = VK_NULL_HANDLE;
+}
+
+void RenderGraph::Reset()
+{
+    mResources.clear();
+    mPasses.clear();
+    mOrder.clear();
+    mBatches.clear();
+    mImageBarriers.clear();
+}
+
+RGResource RenderGraph::ImportImage(const char* name, VkImage image, VkImageView view, VkImageAspectFlags aspect,
+    VkImageLayout initialLayout, VkPipelineStageFlags2 initialStage, RGAccess finalAccess)
+{
+    Resource resource{};
+    resource.name = name;
+    resource.isImage = true;
+    resource.imported = true;
+    resource.image = image;
+    resource.view = view;
+    resource.aspect = aspect;
+    resource.initialLayout = initialLayout;
+    resource.initialStage = initialStage;
+    resource.finalAccess = finalAccess;
+    mResources.push_back(resource);
+    return static_cast<RGResource>(mResources.size() - 1);
+}
+
+RGResource RenderGraph::ImportBuffer(const char* name, VkBuffer buffer)
+{
+    Resource resource{};
+    resource.name = name;
+    resource.imported = true;
+    resource.buffer = buffer;
+    resource.finalAccess = RGAccess::None;
+    mResources.push_back(resource);
+    return static_cast<RGResource>(mResources.size() - 1);
+}
+
+RGResource RenderGraph::CreateImage(const char* name, const RGImageDesc& desc)
+{
+    Resource resource{};
+    resource.name = name;
+    resource.isImage = true;
+    resource.aspect = desc.aspect;
+    resource.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.finalAccess = RGAccess::None;
+    resource.desc = desc;
+    mResources.push_back(resource);
+    return static_cast<RGResource>(mResources.size() - 1);
+}
+
+uint32_t RenderGraph::AddPass(const char* name, RGExecuteFunction execute)
+{
+    Pass pass{};
+    pass.name = name;
+    pass.execute = std::move(execute);
+    mPasses.push_back(std::move(pass));
+    return static_cast<uint32_t>(mPasses.size() - 1);
+}
+
+void RenderGraph::Use(uint32_t pass, RGResource resource, RGAccess access)
+{
+    VkUtil::ExitIfFalse(pass < mPasses.size() && resource < mResources.size(), "invalid render graph pass or resource");
+    VkUtil::ExitIfFalse(mResources[resource].isImage == false || getAccessInfo(access).layout != VK_IMAGE_LAYOUT_UNDEFINED,
+        "render graph access not valid for an image");
+    mPasses[pass].uses.push_back({ resource, access });
+}
+
+void RenderGraph::SetSideEffect(uint32_t pass)
+{
+    mPasses[pass].sideEffect = true;
+}
+
+void RenderGraph::Compile()
+{
+    mStats = {};
+    mStats.passCount = static_cast<uint32_t>(mPasses.size());
+
+    cullPasses();
+    assignLevels();
+    allocateTransients();
+    planBarriers();
+}
+
+void RenderGraph::Execute(VkCommandBuffer cmd)
+{
+    size_t next = 0;
+    for (uint32_t level = 0; level < mStats.levelCount; ++level)
+    {
+        emitBatch(cmd, mBatches[level]);
+        while (next < mOrder.size() && mPasses[mOrder[next]].level == level)
+        {
+            mPasses[mOrder[next]].execute(cmd);
+            ++next;
+        }
+    }
+    // 내보내는 이미지의 마지막 전환
+    emitBatch(cmd, mBatches.back());
+}
+
+VkImage RenderGraph::GetImage(RGResource resource) const
+{
+    return mResources[resource].image;
+}
+
+VkImageView RenderGraph::GetImageView(RGResource resource) const
+{
+    return mResources[resource].view;
+}
+
+VkBuffer RenderGraph::GetBuffer(RGResource resource) const
+{
+    return mResources[resource].buffer;
+}
+
+const RenderGraphStats& RenderGraph::GetStats() const
+{
+    return mStats;
+}
+
+void RenderGraph::cullPasses()
+{
+    // 내보내는 이미지에서 거꾸로, 살아 있는 패스가 읽는 자원을 쓰는 패스만 남김
+    std::vector<bool> needed(mResources.size(), false);
+    for (size_t i = 0; i < mResources.size(); ++i)
+    {
+        needed[i] = mResources[i].imported && mResources[i].finalAccess != RGAccess::None;
+    }
+
+    for (size_t i = mPasses.size(); i-- > 0;)
+    {
+        Pass& pass = mPasses[i];
+        pass.live = pass.sideEffect;
+        for (const PassUse& use : pass.uses)
+        {
+            if (getAccessInfo(use.access).write && needed[use.resource])
+            {
+                pass.live = true;
+            }
+        }
+        if (pass.live == false)
+        {
+            ++mStats.culledPassCount;
+            continue;
+        }
+        for (const PassUse& use : pass.uses)
+        {
+            if (getAccessInfo(use.access).write == false)
+            {
+                needed[use.resource] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::assignLevels()
+{
+    // 자원마다 마지막으로 쓴 레벨과 그 뒤 읽은 레벨
+    struct Tracker
+    {
+        uint32_t writeLevel;
+        uint32_t readLevel;
+        VkImageLayout readLayout;
+    };
+    std::vector<Tracker> trackers(mResources.size(), { NO_LEVEL, NO_LEVEL, VK_IMAGE_LAYOUT_UNDEFINED });
+    for (Resource& resource : mResources)
+    {
+        resource.firstLevel = NO_LEVEL;
+        resource.lastLevel = 0;
+        resource.usage = 0;
+        resource.transientIndex = UINT32_MAX;
+    }
+
+    auto after = [](uint32_t level) { return level == NO_LEVEL ? 0 : level + 1; };
+    uint32_t maxLevel = 0;
+    for (uint32_t i = 0; i < mPasses.size(); ++i)
+    {
+        Pass& pass = mPasses[i];
+        if (pass.live == false)
+        {
+            continue;
+        }
+
+        // 자원 선언이 없는 부수 효과 패스는 앞서 선언된 패스보다 먼저 돌지 않게
+        uint32_t level = pass.sideEffect ? maxLevel : 0;
+        for (const PassUse& use : pass.uses)
+        {
+            const AccessInfo& info = getAccessInfo(use.access);
+            const Tracker& tracker = trackers[use.resource];
+            level = std::max(level, after(tracker.writeLevel));
+            bool layoutChange = mResources[use.resource].isImage && tracker.readLevel != NO_LEVEL && tracker.readLayout != info.layout;
+            if (info.write || layoutChange)
+            {
+                level = std::max(level, after(tracker.readLevel));
+            }
+        }
+        pass.level = level;
+        maxLevel = std::max(maxLevel, level);
+
+        for (const PassUse& use : pass.uses)
+        {
+            const AccessInfo& info = getAccessInfo(use.access);
+            Tracker& tracker = trackers[use.resource];
+            if (info.write)
+            {
+                tracker.writeLevel = level;
+                tracker.readLevel = NO_LEVEL;
+            }
+            else
+            {
+                tracker.readLevel = tracker.readLevel == NO_LEVEL ? level : std::max(tracker.readLevel, level);
+                tracker.readLayout = info.layout;
+            }
+
+            Resource& resource = mResources[use.resource];
+            resource.firstLevel = std::min(resource.firstLevel, level);
+            resource.lastLevel = std::max(resource.lastLevel, level);
+            resource.usage |= info.usage;
+        }
+        mOrder.push_back(i);
+    }
+
+    std::stable_sort(mOrder.begin(), mOrder.end(), [this](uint32_t a, uint32_t b) { return mPasses[a].level < mPasses[b].level; });
+    mStats.levelCount = mOrder.empty() ? 0 : maxLevel + 1;
+}
+
+void RenderGraph::allocateTransients()
+{
+    // 모양(형식, 크기, 용도, 수명)이 같으면 지난 컴파일의 이미지를 그대로 씀
+    std::vector<uint32_t> signature;
+    mTransientResources.clear();
+    for (uint32_t i = 0; i < mResources.size(); ++i)
+    {
+        const Resource& resource = mResources[i];
+        if (resource.imported || resource.firstLevel == NO_LEVEL)
+        {
+            continue;
+        }
+        mTransientResources.push_back(i);
+        signature.insert(signature.end(), { static_cast<uint32_t>(resource.desc.format), resource.desc.extent.width, resource.desc.extent.height,
+            resource.desc.aspect, resource.usage, resource.firstLevel, resource.lastLevel });
+    }
+
+    if (signature != mTransientSignature || mTransients.size() != mTransientResources.size())
+    {
+        destroyTransients(true);
+        mTransientSignature = signature;
+
+        uint32_t count = static_cast<uint32_t>(mTransientResources.size());
+        std::vector<VkMemoryRequirements> requirements(count);
+        std::vector<bool> lazy(count);
+        mTransients.resize(count);
+        for (uint32_t t = 0; t < count; ++t)
+        {
+            const Resource& resource = mResources[mTransientResources[t]];
+            lazy[t] = (resource.usage & ~kAttachmentUsageMask) == 0;
+
+            VkImageCreateInfo imageCI{};
+            imageCI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageCI.imageType = VK_IMAGE_TYPE_2D;
+            imageCI.format = resource.desc.format;
+            imageCI.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+            imageCI.mipLevels = 1;
+            imageCI.arrayLayers = 1;
+            imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageCI.usage = resource.usage | (lazy[t] ? VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT : 0);
+            imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkResult result = vkCreateImage(mDevice, &imageCI, nullptr, &mTransients[t].image);
+            VkUtil::ExitIfFailed(result, "fail vkCreateImage (render graph)");
+            vkGetImageMemoryRequirements(mDevice, mTransients[t].image, &requirements[t]);
+            mTransients[t].size = requirements[t].size;
+        }
+
+        // 큰 것부터, 수명이 겹치지 않고 메모리 타입이 맞는 첫 슬롯에 넣음
+        std::vector<uint32_t> bySize(count);
+        for (uint32_t t = 0; t < count; ++t)
+        {
+            bySize[t] = t;
+        }
+        std::stable_sort(bySize.begin(), bySize.end(), [&requirements](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+
+        struct SlotPlan
+        {
+            VkMemoryRequirements requirements;
+            bool lazy;
+            std::vector<uint32_t> members;
+        };
+        std::vector<SlotPlan> plans;
+        for (uint32_t t : bySize)
+        {
+            const Resource& resource = mResources[mTransientResources[t]];
+            uint32_t slot = static_cast<uint32_t>(plans.size());
+            for (uint32_t s = 0; s < plans.size() && slot == plans.size(); ++s)
+            {
+                SlotPlan& plan = plans[s];
+                if (plan.lazy != lazy[t] || (plan.requirements.memoryTypeBits & requirements[t].memoryTypeBits) == 0)
+                {
+                    continue;
+                }
+                bool overlaps = false;
+                for (uint32_t member : plan.members)
+                {
+                    const Resource& other = mResources[mTransientResources[member]];
+                    overlaps |= resource.firstLevel <= other.lastLevel && other.firstLevel <= resource.lastLevel;
+                }
+                if (overlaps == false)
+                {
+                    slot = s;
+                }
+            }
+            if (slot == plans.size())
+            {
+                plans.push_back({ requirements[t], lazy[t], {} });
+            }
+            SlotPlan& plan = plans[slot];
+            plan.requirements.size = std::max(plan.requirements.size, requirements[t].size);
+            plan.requirements.alignment = std::max(plan.requirements.alignment, requirements[t].alignment);
+            plan.requirements.memoryTypeBits &= requirements[t].memoryTypeBits;
+            plan.members.push_back(t);
+            mTransients[t].memorySlot = slot;
+        }
+
+        mMemorySlots.resize(plans.size());
+        for (uint32_t s = 0; s < plans.size(); ++s)
+        {
+            const SlotPlan& plan = plans[s];
+            VkMemoryPropertyFlags preferred = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | (plan.lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0);
+            MemorySlot& slot = mMemorySlots[s];
+            slot.allocation = mAllocator->Allocate(plan.requirements, 0, preferred, false);
+            VkUtil::ExitIfFalse(slot.allocation != nullptr, "fail to allocate render graph memory");
+            slot.lastTransient = plan.members.front();
+            for (uint32_t member : plan.members)
+            {
+                VkResult result = vkBindImageMemory(mDevice, mTransients[member].image, slot.allocation->memory, slot.allocation->offset);
+                VkUtil::ExitIfFailed(result, "fail vkBindImageMemory (render graph)");
+                if (mResources[mTransientResources[member]].lastLevel > mResources[mTransientResources[slot.lastTransient]].lastLevel)
+                {
+                    slot.lastTransient = member;
+                }
+            }
+        }
+
+        for (uint32_t t = 0; t < count; ++t)
+        {
+            const Resource& resource = mResources[mTransientResources[t]];
+            mTransients[t].view = VkUtil::CreateImageView(mDevice, mTransients[t].image, resource.desc.format, resource.desc.aspect);
+        }
+    }
+
+    VkDeviceSize imageBytes = 0;
+    for (uint32_t t = 0; t < mTransientResources.size(); ++t)
+    {
+        Resource& resource = mResources[mTransientResources[t]];
+        resource.transientIndex = t;
+        resource.image = mTransients[t].image;
+        resource.view = mTransients[t].view;
+        imageBytes += mTransients[t].size;
+    }
+    for (const MemorySlot& slot : mMemorySlots)
+    {
+        mStats.transientBytes += slot.allocation->size;
+    }
+    mStats.transientImageCount = static_cast<uint32_t>(mTransients.size());
+    mStats.aliasedBytes = imageBytes - std::min(imageBytes, mStats.transientBytes);
+}
+
+void RenderGraph::destroyTransients(bool deferred)
+{
+    std::vector<TransientImage> transients;
+    transients.swap(mTransients);
+    std::vector<MemorySlot> slots;
+    slots.swap(mMemorySlots);
+    mTransientSignature.clear();
+    if (transients.empty() && slots.empty())
+    {
+        return;
+    }
+
+    VkDevice device = mDevice;
+    MemoryAllocator* allocator = mAllocator;
+    auto destroy = [device, allocator, transients, slots]()
+    {
+        for (const TransientImage& transient : transients)
+        {
+            vkDestroyImageView(device, transient.view, nullptr);
+            vkDestroyImage(device, transient.image, nullptr);
+        }
+        for (const MemorySlot& slot : slots)
+        {
+            allocator->Free(slot.allocation);
+        }
+    };
+    // 모양이 바뀐 프레임에는 이전 프레임이 아직 쓰고 있을 수 있음
+    if (deferred && mDeferDestroy)
+    {
+        mDeferDestroy(destroy);
+    }
+    else
+    {
+        destroy();
+    }
+}
+
+void RenderGraph::planBarriers()
+{
+    mStates.assign(mResources.size(), ResourceState{});
+    for (size_t i = 0; i < mResources.size(); ++i)
+    {
+        const Resource& resource = mResources[i];
+        if (resource.imported && resource.isImage)
+        {
+            // 세마포어 대기가 막는 단계부터 이어 받음
+            mStates[i].layout = resource.initialLayout;
+            mStates[i].writeStages = resource.initialStage;
+        }
+    }
+
+    VkMemoryBarrier2 emptyBarrier{};
+    emptyBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    mBatches.assign(mStats.levelCount + 1, { 0, 0, emptyBarrier });
+    mImageBarriers.clear();
+    mAliasWaits.clear();
+    std::vector<RGResource> slotOccupants(mMemorySlots.size(), INVALID_RG_RESOURCE);
+
+    size_t next = 0;
+    for (uint32_t level = 0; level < mStats.levelCount; ++level)
+    {
+        mBatches[level].firstImageBarrier = static_cast<uint32_t>(mImageBarriers.size());
+        while (next < mOrder.size() && mPasses[mOrder[next]].level == level)
+        {
+            for (const PassUse& use : mPasses[mOrder[next]].uses)
+            {
+                planUse(use.resource, use.access, level, slotOccupants);
+            }
+            ++next;
+        }
+    }
+
+    uint32_t finalBatch = mStats.levelCount;
+    mBatches[finalBatch].firstImageBarrier = static_cast<uint32_t>(mImageBarriers.size());
+    for (uint32_t i = 0; i < mResources.size(); ++i)
+    {
+        const Resource& resource = mResources[i];
+        if (resource.imported && resource.isImage && resource.finalAccess != RGAccess::None)
+        {
+            planUse(i, resource.finalAccess, finalBatch, slotOccupants);
+        }
+    }
+
+    // 같은 메모리를 앞서 쓴 이미지가 끝나야 덮어씀, 슬롯의 첫 이미지는 이전 프레임의 마지막 이미지를 기다림
+    for (const AliasWait& wait : mAliasWaits)
+    {
+        RGResource previous = wait.previous;
+        if (previous == INVALID_RG_RESOURCE)
+        {
+            previous = mTransientResources[mMemorySlots[wait.memorySlot].lastTransient];
+        }
+        const ResourceState& state = mStates[previous];
+        VkPipelineStageFlags2 srcStages = state.writeStages | state.readStages;
+        VkImageMemoryBarrier2& barrier = mImageBarriers[wait.imageBarrier];
+        barrier.srcStageMask |= srcStages;
+        barrier.srcAccessMask |= state.writeAccess;
+        if (mResources[previous].image != barrier.image && srcStages != 0)
+        {
+            VkMemoryBarrier2& memoryBarrier = mBatches[wait.batch].memoryBarrier;
+            memoryBarrier.srcStageMask |= srcStages;
+            memoryBarrier.srcAccessMask |= state.writeAccess;
+            memoryBarrier.dstStageMask |= barrier.dstStageMask;
+            memoryBarrier.dstAccessMask |= barrier.dstAccessMask;
+        }
+    }
+
+    for (const BarrierBatch& batch : mBatches)
+    {
+        if (batch.imageBarrierCount > 0 || batch.memoryBarrier.srcStageMask != 0)
+        {
+            ++mStats.barrierBatchCount;
+        }
+    }
+    mStats.imageBarrierCount = static_cast<uint32_t>(mImageBarriers.size());
+}
+
+void RenderGraph::planUse(RGResource resource, RGAccess access, uint32_t batch, std::vector<RGResource>& slotOccupants)
+{
+    const AccessInfo& info = getAccessInfo(access);
+    const Resource& r = mResources[resource];
+    ResourceState& state = mStates[resource];
+    BarrierBatch& barrierBatch = mBatches[batch];
+    bool firstTransientUse = r.imported == false && state.touched == false;
+    state.touched = true;
+
+    if (r.isImage && (info.layout != state.layout || firstTransientUse))
+    {
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = state.writeStages | state.readStages;
+        barrier.srcAccessMask = state.writeAccess;
+        barrier.dstStageMask = info.stage;
+        barrier.dstAccessMask = info.access;
+        // 임시 이미지는 매 프레임 내용을 버림
+        barrier.oldLayout = firstTransientUse ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+        barrier.newLayout = info.layout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = r.image;
+        barrier.subresourceRange = { r.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+
+        if (firstTransientUse)
+        {
+            uint32_t slot = mTransients[r.transientIndex].memorySlot;
+            mAliasWaits.push_back({ static_cast<uint32_t>(mImageBarriers.size()), batch, slot, slotOccupants[slot] });
+            slotOccupants[slot] = resource;
+        }
+        mImageBarriers.push_back(barrier);
+        ++barrierBatch.imageBarrierCount;
+
+        // 레이아웃 전환은 쓰기로 취급
+        state.layout = info.layout;
+        state.writeStages = info.stage;
+        state.writeAccess = info.access & kWriteAccessMask;
+        state.visibleStages = info.stage;
+        state.visibleAccess = info.access;
+        state.readStages = info.write ? 0 : info.stage;
+        return;
+    }
+
+    VkMemoryBarrier2& memoryBarrier = barrierBatch.memoryBarrier;
+    if (info.write)
+    {
+        // 앞선 쓰기(WAW)와 그 뒤의 읽기(WAR)를 모두 기다림
+        VkPipelineStageFlags2 srcStages = state.writeStages | state.readStages;
+        if (srcStages != 0)
+        {
+            memoryBarrier.srcStageMask |= srcStages;
+            memoryBarrier.srcAccessMask |= state.writeAccess;
+            memoryBarrier.dstStageMask |= info.stage;
+            memoryBarrier.dstAccessMask |= info.access;
+        }
+        state.writeStages = info.stage;
+        state.writeAccess = info.access & kWriteAccessMask;
+        state.visibleStages = info.stage;
+        state.visibleAccess = info.access;
+        state.readStages = 0;
+        return;
+    }
+
+    // 이미 보이게 된 단계와 접근이면 장벽 없이 읽음
+    bool visible = (info.stage & ~state.visibleStages) == 0 && (info.access & ~state.visibleAccess) == 0;
+    if (state.writeStages != 0 && visible == false)
+    {
+        memoryBarrier.srcStageMask |= state.writeStages;
+        memoryBarrier.srcAccessMask |= state.writeAccess;
+        memoryBarrier.dstStageMask |= info.stage;
+        memoryBarrier.dstAccessMask |= info.access;
+        state.visibleStages |= info.stage;
+        state.visibleAccess |= info.access;
+    }
+    state.readStages |= info.stage;
+}
+
+void RenderGraph::emitBatch(VkCommandBuffer cmd, const BarrierBatch& batch) const
+{
+    bool hasMemoryBarrier = batch.memoryBarrier.srcStageMask != 0;
+    if (batch.imageBarrierCount == 0 && hasMemoryBarrier == false)
+    {
+        return;
+    }
+
+    VkDependencyInfo dependency{};
+    dependency.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dependency.memoryBarrierCount = hasMemoryBarrier ? 1 : 0;
+    dependency.pMemoryBarriers = &batch.memoryBarrier;
+    dependency.imageMemoryBarrierCount = batch.imageBarrierCount;
+    dependency.pImageMemoryBarriers = batch.imageBarrierCount > 0 ? &mImageBarriers[batch.firstImageBarrier] : nullptr;
+    vkCmdPipelineBarrier2(cmd, &dependency);
+}
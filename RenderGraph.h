@@ -0,0 +1,206 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <functional>
+#include "MemoryAllocator.h"
+#include "DeletionQueue.h"
+
+typedef uint32_t RGResource;
+const RGResource INVALID_RG_RESOURCE = UINT32_MAX;
+
+// how a pass touches a resource, decides the stages, access and image layout
+enum class RGAccess
+{
+	ColorAttachmentWrite,
+	DepthAttachmentWrite,
+	DepthAttachmentRead,
+	// fragment or compute shader
+	SampledRead,
+	// compute shader
+	StorageRead,
+	StorageWrite,
+	VertexStorageRead,
+	IndirectRead,
+	TransferRead,
+	TransferWrite,
+	// final state of an imported image only
+	Present,
+	None
+};
+
+// transient image, usage is derived from how the passes use it
+struct RGImageDesc
+{
+	VkFormat format;
+	VkExtent2D extent;
+	VkImageAspectFlags aspect;
+};
+
+struct RenderGraphStats
+{
+	uint32_t passCount;
+	uint32_t culledPassCount;
+	// dependency levels, one barrier batch at most before each
+	uint32_t levelCount;
+	uint32_t barrierBatchCount;
+	uint32_t imageBarrierCount;
+	uint32_t transientImageCount;
+	// memory bound to transient images, and what aliasing saved on top of it
+	VkDeviceSize transientBytes;
+	VkDeviceSize aliasedBytes;
+};
+
+typedef std::function<void(VkCommandBuffer cmd)> RGExecuteFunction;
+
+// Per-frame graph of passes and the images / buffers they use. Compile() drops passes
+// whose results nobody reads, groups the rest into dependency levels (declaration
+// order decides which write a read sees), plans one vkCmdPipelineBarrier2 batch per
+// level with the layout transitions, and backs transient images whose level ranges
+// do not overlap with the same memory. Transient images are kept between frames
+// while the graph keeps the same shape.
+class RenderGraph
+{
+public:
+	RenderGraph();
+
+	void Create(VkDevice device, MemoryAllocator& allocator, DeferDestroyFunction deferDestroy);
+	void Destroy();
+
+	// clears the passes and resources of the previous frame
+	void Reset();
+	// initialStage : stage whose completion the first use waits for (e.g. the acquire semaphore wait),
+	// finalAccess other than None makes the image an output the graph transitions at the end
+	RGResource ImportImage(const char* name, VkImage image, VkImageView view, VkImageAspectFlags aspect,
+		VkImageLayout initialLayout, VkPipelineStageFlags2 initialStage, RGAccess finalAccess);
+	RGResource ImportBuffer(const char* name, VkBuffer buffer);
+	// contents are undefined at the first use in the frame
+	RGResource CreateImage(const char* name, const RGImageDesc& desc);
+
+	// execute runs inside Execute() with every declared use synchronized
+	uint32_t AddPass(const char* name, RGExecuteFunction execute);
+	void Use(uint32_t pass, RGResource resource, RGAccess access);
+	// kept even when nothing reads what it writes
+	void SetSideEffect(uint32_t pass);
+
+	void Compile();
+	void Execute(VkCommandBuffer cmd);
+
+	// valid after Compile()
+	VkImage GetImage(RGResource resource) const;
+	VkImageView GetImageView(RGResource resource) const;
+	VkBuffer GetBuffer(RGResource resource) const;
+	const RenderGraphStats& GetStats() const;
+
+private:
+	struct Resource
+	{
+		const char* name;
+		bool isImage;
+		bool imported;
+		VkImage image;
+		VkImageView view;
+		VkBuffer buffer;
+		VkImageAspectFlags aspect;
+		VkImageLayout initialLayout;
+		VkPipelineStageFlags2 initialStage;
+		RGAccess finalAccess;
+		// transient only
+		RGImageDesc desc;
+		VkImageUsageFlags usage;
+		uint32_t transientIndex;
+		uint32_t firstLevel;
+		uint32_t lastLevel;
+	};
+
+	struct PassUse
+	{
+		RGResource resource;
+		RGAccess access;
+	};
+
+	struct Pass
+	{
+		const char* name;
+		RGExecuteFunction execute;
+		std::vector<PassUse> uses;
+		bool sideEffect;
+		bool live;
+		uint32_t level;
+	};
+
+	// synchronization state of a resource while barriers are planned
+	struct ResourceState
+	{
+		VkImageLayout layout;
+		// last write or layout transition, and the scopes already synchronized with it
+		VkPipelineStageFlags2 writeStages;
+		VkAccessFlags2 writeAccess;
+		VkPipelineStageFlags2 visibleStages;
+		VkAccessFlags2 visibleAccess;
+		// reads since the last write, the next write waits for them
+		VkPipelineStageFlags2 readStages;
+		bool touched;
+	};
+
+	struct BarrierBatch
+	{
+		uint32_t firstImageBarrier;
+		uint32_t imageBarrierCount;
+		VkMemoryBarrier2 memoryBarrier;
+	};
+
+	struct TransientImage
+	{
+		VkImage image;
+		VkImageView view;
+		VkDeviceSize size;
+		uint32_t memorySlot;
+	};
+
+	// memory shared by transient images with disjoint level ranges
+	struct MemorySlot
+	{
+		Allocation* allocation;
+		// transient using the slot last in the frame, its end state wraps around to the first one
+		uint32_t lastTransient;
+	};
+
+	// first use of a transient image, its source scope is filled in once every state is known
+	struct AliasWait
+	{
+		uint32_t imageBarrier;
+		uint32_t batch;
+		uint32_t memorySlot;
+		RGResource previous;
+	};
+
+	VkDevice mDevice;
+	MemoryAllocator* mAllocator;
+	DeferDestroyFunction mDeferDestroy;
+
+	std::vector<Resource> mResources;
+	std::vector<Pass> mPasses;
+	// live passes sorted by (level, declaration)
+	std::vector<uint32_t> mOrder;
+	// batch i runs before level i, the last one after every pass
+	std::vector<BarrierBatch> mBatches;
+	std::vector<VkImageMemoryBarrier2> mImageBarriers;
+	std::vector<ResourceState> mStates;
+	std::vector<AliasWait> mAliasWaits;
+
+	// transient images and their memory, reused while the signature matches
+	std::vector<uint32_t> mTransientSignature;
+	std::vector<TransientImage> mTransients;
+	std::vector<MemorySlot> mMemorySlots;
+	// resource of each transient in the current graph
+	std::vector<RGResource> mTransientResources;
+	RenderGraphStats mStats;
+
+	void cullPasses();
+	void assignLevels();
+	void allocateTransients();
+	void destroyTransients(bool deferred);
+	void planBarriers();
+	void planUse(RGResource resource, RGAccess access, uint32_t batch, std::vector<RGResource>& slotOccupants);
+	void emitBatch(VkCommandBuffer cmd, const BarrierBatch& batch) const;
+};
@@ -1,32 +1,132 @@
 #include "Renderer.h"
 #include "VkUtil.h"
-#include <iostream>
+#include "Logger.h"
 #include <cassert>
 #include <unordered_set>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
 
-#define LOG(msg) std::cout << msg;
-#define LOG_ENDLINE(msg) std::cout << msg << std::endl;
+using Clock = std::chrono::steady_clock;
 
+static double elapsedMs(Clock::time_point& inOutStart)
+{
+    Clock::time_point now = Clock::now();
+    double ms = std::chrono::duration<double, std::milli>(now - inOutStart).count();
+    inOutStart = now;
+    return ms;
+}
 
-Renderer::Renderer()
-	:mCurrentFrame(0)
+
+Renderer::Renderer(const RendererConfig& config)
+	:mConfig(config)
+	,mWindow(nullptr)
+	,mSurface(VK_NULL_HANDLE)
+	,mSwapchain(VK_NULL_HANDLE)
+	,mDepthFormat(VK_FORMAT_UNDEFINED)
+	,mDepthAspect(0)
+	,mGraphicsPipeline(INVALID_PIPELINE)
+	,mDepthPrepassPipeline(INVALID_PIPELINE)
+	,mPrepassMainPipeline(INVALID_PIPELINE)
+	,mShaderModulesAlive(false)
+	,mStartupMetrics()
+	,mDrawStats()
+	,mFrameConstantsOffset(0)
+	,mDefaultTexture(VK_NULL_HANDLE)
+	,mDefaultTextureAllocation(nullptr)
+	,mDefaultTextureView(VK_NULL_HANDLE)
+	,mDefaultSampler(VK_NULL_HANDLE)
+	,mViewProjection{ 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f }
+	,mViewVersion(0)
+	,mCachedCommandPool(VK_NULL_HANDLE)
+	,mCommandReuseStats()
+	,mCurrentFrame(0)
+	,mNextOffscreenImage(0)
+	,mFrameNumber(0)
+	,mLastFrameTimings()
+	,mGraphicsTimeline(VK_NULL_HANDLE)
+	,mGraphicsTimelineValue(0)
+	,mFramebufferResized(false)
+	,mSwapchainDirty(false)
 {
-    createWindow();
+    if (mConfig.framesInFlight == 0)
+    {
+        mConfig.framesInFlight = 1;
+    }
+
+    if (mConfig.headless == false)
+    {
+        createWindow();
+    }
     createInstance();
 	mDebugMessenger = VkUtil::SetupDebugMessenger(mInstance);
-    createSurface();
+    if (mConfig.headless == false)
+    {
+        createSurface();
+    }
 
     uint32_t graphicsFamilyIndex;
     uint32_t presentFamilyIndex;
     pickPhysicalDevice(graphicsFamilyIndex, presentFamilyIndex);
+    mGraphicsFamilyIndex = graphicsFamilyIndex;
+    mPresentFamilyIndex = presentFamilyIndex;
+    mTransferFamilyIndex = findTransferQueueFamily(mPhysicalDevice, graphicsFamilyIndex);
 	createLogicalDevice(graphicsFamilyIndex, presentFamilyIndex);
-	createSwapchain(graphicsFamilyIndex, presentFamilyIndex);
-    createRenderPass();
-	createFramebuffers();
+    mMemoryAllocator.Create(mPhysicalDevice, mLogicalDevice);
+    // 크기가 바뀌어 교체된 자원은 모두 타임라인 값으로 파괴
+    DeferDestroyFunction deferDestroy = [this](std::function<void()> destroy) { DeferDestroy(std::move(destroy)); };
+    mRenderGraph.Create(mLogicalDevice, mMemoryAllocator, deferDestroy);
+    // 레이아웃/파이프라인은 같은 설명이면 하나를 같이 씀
+    mPipelineLibrary.Create(mLogicalDevice, mPipelineCompiler, mShaderRegistry);
+    mUploadEngine.Create(mLogicalDevice, mMemoryAllocator, mTransferQueue, mTransferFamilyIndex, graphicsFamilyIndex, mConfig.uploadRingSize);
+    mInstances.Create(mPhysicalDevice, mLogicalDevice, mMemoryAllocator, mPipelineLibrary, mConfig.framesInFlight, deferDestroy);
+    mBindless.Create(mPhysicalDevice, mLogicalDevice, mPipelineLibrary, deferDestroy);
+    mFrameAllocator.Create(mPhysicalDevice, mLogicalDevice, mMemoryAllocator, mPipelineLibrary, mConfig.framesInFlight, mConfig.frameConstantsSize);
+    if (mConfig.headless)
+    {
+        createOffscreenImages();
+    }
+    else
+    {
+        createSwapchain(graphicsFamilyIndex, presentFamilyIndex);
+    }
+    mPipelineCache.Create(mPhysicalDevice, mLogicalDevice, mConfig.pipelineCachePath, mConfig.pipelineCacheSaveIntervalSec);
+    mShaderRegistry.Create(mLogicalDevice);
+    VkShaderModule cullModule = loadShader(mConfig.cullShaderSource, mConfig.cullShaderPath);
+    if (cullModule == VK_NULL_HANDLE)
+    {
+        LOG_WARNING("Missing cull shader {} (needs glslc and spirv-val from the Vulkan SDK to build it).", mConfig.cullShaderPath);
+    }
+    mCulling.Create(mPhysicalDevice, mLogicalDevice, mMemoryAllocator, mPipelineLibrary, mPipelineCache.Get(), mInstances.GetSetLayout(),
+        cullModule, mConfig.framesInFlight, deferDestroy);
+    LOG_INFO("{}", mCulling.IsEnabled() ? "GPU culling enabled." : "GPU culling unavailable, drawing directly.");
+    mPipelineCompiler.Create(mLogicalDevice, mPipelineCache.Get(), mConfig.pipelineCompileThreads);
+    mDepthFormat = pickDepthFormat();
+    mDepthAspect = VK_IMAGE_ASPECT_DEPTH_BIT | (mConfig.depthStencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
 	createGraphicsPipeline();
-    createCommandPool(graphicsFamilyIndex);
+    // 셰이더 모듈은 백그라운드 컴파일이 끝나면 해제
+    mShaderModulesAlive = true;
+    createMesh();
+    createDefaultTexture();
+    // 메시 전체가 메시 테이블의 0번
+    MeshDraw meshDraw{};
+    meshDraw.indexCount = mMesh.GetIndexCount();
+    mMesh.GetBoundingSphere(meshDraw.boundingSphere);
+    mCulling.AddMesh(meshDraw);
+    // 인스턴스를 따로 추가하지 않으면 단위 변환 하나
+    InstanceData identity = { { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } };
+    mInstances.Add(identity);
+    // 메인 스레드 포함, 0이면 워커 없이 메인 스레드만
+    mJobSystem.Create(std::max(mConfig.recordThreads, 1u));
+    createCommandPools(graphicsFamilyIndex);
 	createCommandBuffers();
     createSyncObjects();
+
+    if (mConfig.gpuProfiling)
+    {
+        mGpuProfiler.Create(mPhysicalDevice, mLogicalDevice, graphicsFamilyIndex,
+            mConfig.framesInFlight, mConfig.pipelineStatistics);
+    }
 }
 
 void Renderer::Run()
@@ -35,12 +135,130 @@ void Renderer::Run()
     cleanup();
 }
 
+bool Renderer::ShouldClose() const
+{
+    if (mConfig.headless)
+    {
+        return false;
+    }
+    return glfwWindowShouldClose(mWindow);
+}
+
+void Renderer::RenderFrame()
+{
+    if (mConfig.headless == false)
+    {
+        glfwPollEvents();
+        // 최소화 중에는 이벤트가 올 때까지 잠들어서 CPU를 태우지 않음
+        if (isMinimized())
+        {
+            glfwWaitEvents();
+            return;
+        }
+    }
+    drawFrame();
+    if (mShaderModulesAlive && mPipelineCompiler.GetPendingCount() == 0)
+    {
+        onPipelinesCompiled();
+    }
+    mPipelineCache.SaveIfDue();
+}
+
+void Renderer::Shutdown()
+{
+    cleanup();
+}
+
+const FrameTimings& Renderer::GetLastFrameTimings() const
+{
+    return mLastFrameTimings;
+}
+
+const GpuProfiler& Renderer::GetGpuProfiler() const
+{
+    return mGpuProfiler;
+}
+
+const StartupMetrics& Renderer::GetStartupMetrics() const
+{
+    return mStartupMetrics;
+}
+
+std::vector<PipelineCompileStats> Renderer::GetPipelineStats() const
+{
+    return mPipelineCompiler.GetStats();
+}
+
+PipelineLibraryStats Renderer::GetPipelineLibraryStats() const
+{
+    return mPipelineLibrary.GetStats();
+}
+
+const CommandReuseStats& Renderer::GetCommandReuseStats() const
+{
+    return mCommandReuseStats;
+}
+
+MemoryStats Renderer::GetMemoryStats() const
+{
+    return mMemoryAllocator.GetStats();
+}
+
+const RenderGraphStats& Renderer::GetRenderGraphStats() const
+{
+    return mRenderGraph.GetStats();
+}
+
+const DrawListStats& Renderer::GetDrawStats() const
+{
+    return mDrawStats;
+}
+
+UploadEngine& Renderer::GetUploadEngine()
+{
+    return mUploadEngine;
+}
+
+InstanceBuffer& Renderer::GetInstances()
+{
+    return mInstances;
+}
+
+BindlessHeap& Renderer::GetBindless()
+{
+    return mBindless;
+}
+
+void Renderer::SetViewProjection(const float viewProjection[16])
+{
+    memcpy(mViewProjection, viewProjection, sizeof(mViewProjection));
+    mCulling.SetViewProjection(viewProjection);
+    // 컬링 평면은 푸시 상수로 기록되므로 재사용하던 커맨드 버퍼는 다시 기록
+    ++mViewVersion;
+}
+
 void Renderer::createWindow()
 {
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    mWindow = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
+    mWindow = glfwCreateWindow(mConfig.width, mConfig.height, "Vulkan", nullptr, nullptr);
+    glfwSetWindowUserPointer(mWindow, this);
+    glfwSetFramebufferSizeCallback(mWindow, framebufferResizeCallback);
+
+}
+
+void Renderer::framebufferResizeCallback(GLFWwindow* window, int, int)
+{
+    Renderer* renderer = static_cast<Renderer*>(glfwGetWindowUserPointer(window));
+    renderer->mFramebufferResized = true;
+}
 
+bool Renderer::isMinimized() const
+{
+    int width = 0;
+    int height = 0;
+    glfwGetFramebufferSize(mWindow, &width, &height);
+    return width == 0 || height == 0;
 }
 
 void Renderer::createInstance()
@@ -64,20 +282,24 @@ void Renderer::createInstance()
     createInfo.pApplicationInfo = &appInfo;
 
 
-    uint32_t glfwExtensionCount = 0;
-    const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    // headless는 GLFW를 초기화하지 않으므로 surface 확장이 필요 없음
+    std::vector<const char*> extensions;
+    if (mConfig.headless == false)
+    {
+        uint32_t glfwExtensionCount = 0;
+        const char** glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+        extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+    }
 
-    createInfo.enabledExtensionCount = glfwExtensionCount;
-    createInfo.ppEnabledExtensionNames = glfwExtensions;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
     createInfo.enabledLayerCount = 0;
     createInfo.ppEnabledLayerNames = nullptr;
     createInfo.pNext = nullptr;
 
 #ifndef NDEBUG
-    std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
-
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
-    createInfo.enabledExtensionCount = extensions.size();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     createInfo.ppEnabledExtensionNames = extensions.data();
 
     VkDebugUtilsMessengerCreateInfoEXT debugCi{};
@@ -112,6 +334,7 @@ void Renderer::pickPhysicalDevice(uint32_t& outGraphicsFamilyIndex, uint32_t& ou
     vkEnumeratePhysicalDevices(mInstance, &deviceCount, devices.data());
 
 	VkPhysicalDevice selectedDevice = VK_NULL_HANDLE;
+    uint32_t bestScore = 0;
     for (const auto& device : devices)
     {
         // 그래픽 지원 하는지, 표현 되는지 확인
@@ -122,16 +345,20 @@ void Renderer::pickPhysicalDevice(uint32_t& outGraphicsFamilyIndex, uint32_t& ou
             continue;
 		}
 
-        VkPhysicalDeviceProperties deviceProperties{};
-		vkGetPhysicalDeviceProperties(device, &deviceProperties);
-        
-        // GPU 고르기
-        if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+        // dynamic rendering(1.3) 필수
+        if (supportsRequiredFeatures(device) == false)
+        {
+            continue;
+        }
+
+        // GPU 고르기 - discrete만 받지 않고 점수가 가장 높은 장치 (CPU/lavapipe 포함)
+        uint32_t score = rateDevice(device);
+        if (score > bestScore)
         {
+            bestScore = score;
             selectedDevice = device;
             outGraphicsFamilyIndex = graphicsFamilyIndex;
             outPresentFamilyIndex = presentFamilyIndex;
-            break;
 	    }
     }
 
@@ -141,6 +368,74 @@ void Renderer::pickPhysicalDevice(uint32_t& outGraphicsFamilyIndex, uint32_t& ou
     }
 
 	mPhysicalDevice = selectedDevice;
+
+    VkPhysicalDeviceProperties deviceProperties{};
+    vkGetPhysicalDeviceProperties(mPhysicalDevice, &deviceProperties);
+    LOG_INFO("Selected device : {}", deviceProperties.deviceName);
+}
+
+bool Renderer::supportsRequiredFeatures(VkPhysicalDevice device) const
+{
+    VkPhysicalDeviceProperties deviceProperties{};
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_3)
+    {
+        return false;
+    }
+
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    VkPhysicalDeviceFeatures2 features{};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &vulkan13Features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    if (vulkan13Features.dynamicRendering == VK_FALSE || vulkan13Features.synchronization2 == VK_FALSE)
+    {
+        return false;
+    }
+
+    // 타임라인 세마포어, 바인드리스 디스크립터 세트
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features.pNext = &vulkan12Features;
+    vkGetPhysicalDeviceFeatures2(device, &features);
+    return vulkan12Features.timelineSemaphore == VK_TRUE
+        && vulkan12Features.runtimeDescriptorArray == VK_TRUE
+        && vulkan12Features.descriptorBindingPartiallyBound == VK_TRUE
+        && vulkan12Features.descriptorBindingUpdateUnusedWhilePending == VK_TRUE
+        && vulkan12Features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE
+        && vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE
+        && vulkan12Features.shaderSampledImageArrayNonUniformIndexing == VK_TRUE;
+}
+
+uint32_t Renderer::rateDevice(VkPhysicalDevice device) const
+{
+    VkPhysicalDeviceProperties deviceProperties{};
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+
+    uint32_t score = 0;
+    switch (deviceProperties.deviceType)
+    {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        score = 10000;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        score = 5000;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        score = 2500;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_CPU:
+        score = 1000;
+        break;
+    default:
+        score = 100;
+        break;
+    }
+
+    // 같은 타입끼리는 지원 해상도가 큰 쪽
+    score += deviceProperties.limits.maxImageDimension2D / 1024;
+    return score;
 }
 
 
@@ -161,6 +456,17 @@ bool Renderer::findQueueFamilies(VkPhysicalDevice device, uint32_t& outGraphicsF
             outGraphicsFamilyIndex = i;
         }
 
+        // headless : present 큐가 필요 없으므로 그래픽 큐로 대체
+        if (mConfig.headless)
+        {
+            if (outGraphicsFamilyIndex != -1)
+            {
+                outPresentFamilyIndex = outGraphicsFamilyIndex;
+                return true;
+            }
+            continue;
+        }
+
         VkBool32 presentSupport = VK_FALSE;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, mSurface, &presentSupport);
         if (props[i].queueCount > 0 && presentSupport == VK_TRUE) 
@@ -176,11 +482,40 @@ bool Renderer::findQueueFamilies(VkPhysicalDevice device, uint32_t& outGraphicsF
     return false;
 }
 
+uint32_t Renderer::findTransferQueueFamily(VkPhysicalDevice device, uint32_t graphicsFamilyIndex) const
+{
+    uint32_t count = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, nullptr);
+
+    std::vector<VkQueueFamilyProperties> props(count);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &count, props.data());
+
+    // 전용 DMA 큐 > 그래픽이 아닌 transfer 가능 큐 > 그래픽 큐
+    uint32_t asyncFamily = UINT32_MAX;
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (props[i].queueCount == 0 || (props[i].queueFlags & VK_QUEUE_TRANSFER_BIT) == 0 || (props[i].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+        {
+            continue;
+        }
+        if ((props[i].queueFlags & VK_QUEUE_COMPUTE_BIT) == 0)
+        {
+            return i;
+        }
+        if (asyncFamily == UINT32_MAX)
+        {
+            asyncFamily = i;
+        }
+    }
+    return asyncFamily != UINT32_MAX ? asyncFamily : graphicsFamilyIndex;
+}
+
 void Renderer::createLogicalDevice(const uint32_t graphicsFamilyIndex, const uint32_t presentFamilyIndex)
 {
     std::unordered_set<uint32_t> uniqueQueueFamilies;
 	uniqueQueueFamilies.insert(graphicsFamilyIndex);
 	uniqueQueueFamilies.insert(presentFamilyIndex);
+    uniqueQueueFamilies.insert(mTransferFamilyIndex);
 
     std::vector<VkDeviceQueueCreateInfo> queueCIs;
     queueCIs.reserve(uniqueQueueFamilies.size());
@@ -197,17 +532,55 @@ void Renderer::createLogicalDevice(const uint32_t graphicsFamilyIndex, const uin
 	}
 
 	VkPhysicalDeviceFeatures deviceFeatures{};
+    if (mConfig.gpuProfiling && mConfig.pipelineStatistics)
+    {
+        VkPhysicalDeviceFeatures supported{};
+        vkGetPhysicalDeviceFeatures(mPhysicalDevice, &supported);
+        deviceFeatures.pipelineStatisticsQuery = supported.pipelineStatisticsQuery;
+    }
+
+    // GPU 컬링용, 없으면 GpuCulling이 알아서 대체 경로를 씀
+    VkPhysicalDeviceVulkan12Features supported12{};
+    supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 supportedFeatures{};
+    supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    supportedFeatures.pNext = &supported12;
+    vkGetPhysicalDeviceFeatures2(mPhysicalDevice, &supportedFeatures);
+    deviceFeatures.drawIndirectFirstInstance = supportedFeatures.features.drawIndirectFirstInstance;
+    deviceFeatures.multiDrawIndirect = supportedFeatures.features.multiDrawIndirect;
+
+    VkPhysicalDeviceVulkan12Features vulkan12Features{};
+    vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    vulkan12Features.drawIndirectCount = supported12.drawIndirectCount;
+    // supportsRequiredFeatures에서 확인됨
+    vulkan12Features.timelineSemaphore = VK_TRUE;
+    vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+    vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan13Features.pNext = &vulkan12Features;
+    vulkan13Features.dynamicRendering = VK_TRUE;
+    // 렌더 그래프가 vkCmdPipelineBarrier2로 장벽을 넣음
+    vulkan13Features.synchronization2 = VK_TRUE;
 
     VkDeviceCreateInfo createInfo{};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &vulkan13Features;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCIs.size());
 	createInfo.pQueueCreateInfos = queueCIs.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
 
-    const std::vector<const char*> deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
+    std::vector<const char*> deviceExtensions;
+    if (mConfig.headless == false)
+    {
+        deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+    }
 
 	createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
 	createInfo.ppEnabledExtensionNames = deviceExtensions.data();
@@ -218,8 +591,9 @@ void Renderer::createLogicalDevice(const uint32_t graphicsFamilyIndex, const uin
 	mPresentQueue = VK_NULL_HANDLE;
     vkGetDeviceQueue(mLogicalDevice, graphicsFamilyIndex, 0, &mGraphicsQueue);
 	vkGetDeviceQueue(mLogicalDevice, presentFamilyIndex, 0, &mPresentQueue);
+    vkGetDeviceQueue(mLogicalDevice, mTransferFamilyIndex, 0, &mTransferQueue);
 
-    if (mGraphicsQueue == VK_NULL_HANDLE || mPresentQueue == VK_NULL_HANDLE)
+    if (mGraphicsQueue == VK_NULL_HANDLE || mPresentQueue == VK_NULL_HANDLE || mTransferQueue == VK_NULL_HANDLE)
     {
         VkUtil::ExitIfFalse(false, "failed to get queue handles!");
     }
@@ -229,7 +603,7 @@ void Renderer::createSwapchain(const uint32_t graphicsFamilyIndex, const uint32_
 {
     VkSurfaceCapabilitiesKHR surfaceCapabilities{};
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(mPhysicalDevice, mSurface, &surfaceCapabilities);
-    mSwapchainExtent = surfaceCapabilities.currentExtent;
+    mSwapchainExtent = chooseSwapExtent(surfaceCapabilities);
 
     VkSurfaceFormatKHR bestFormat = pickBestFormat();
 	VkPresentModeKHR bestPresentMode = pickBestPresentMode();
@@ -237,12 +611,15 @@ void Renderer::createSwapchain(const uint32_t graphicsFamilyIndex, const uint32_
 	VkSwapchainCreateInfoKHR swapchainCI{};
 	swapchainCI.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
 	swapchainCI.surface = mSurface;
-    swapchainCI.imageExtent = surfaceCapabilities.currentExtent;
+    swapchainCI.imageExtent = mSwapchainExtent;
 	swapchainCI.minImageCount = surfaceCapabilities.minImageCount + 1;
+    if (surfaceCapabilities.maxImageCount > 0 && swapchainCI.minImageCount > surfaceCapabilities.maxImageCount)
+    {
+        swapchainCI.minImageCount = surfaceCapabilities.maxImageCount;
+    }
     swapchainCI.preTransform = surfaceCapabilities.currentTransform;
 
-    LOG("minImageCount : ");
-	LOG_ENDLINE(swapchainCI.minImageCount);
+    LOG_INFO("minImageCount : {}", swapchainCI.minImageCount);
 
 
 
@@ -268,15 +645,101 @@ void Renderer::createSwapchain(const uint32_t graphicsFamilyIndex, const uint32_
     swapchainCI.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     swapchainCI.clipped = VK_TRUE;
 
-    // 리사이즈 필요한 경우
-	swapchainCI.oldSwapchain = VK_NULL_HANDLE;
+    // 리사이즈 필요한 경우 - 이전 스왑체인을 넘겨서 드라이버가 자원을 재사용할 수 있게 함
+	swapchainCI.oldSwapchain = mSwapchain;
 
-	VkResult result = vkCreateSwapchainKHR(mLogicalDevice, &swapchainCI, nullptr, &mSwapchain);
+    VkSwapchainKHR newSwapchain = VK_NULL_HANDLE;
+	VkResult result = vkCreateSwapchainKHR(mLogicalDevice, &swapchainCI, nullptr, &newSwapchain);
 	VkUtil::ExitIfFailed(result, "fail vkCreateSwapchainKHR");
+    mSwapchain = newSwapchain;
 
+	mColorFormat = bestFormat.format;
 	createImageViews(bestFormat);
 }
 
+VkExtent2D Renderer::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) const
+{
+    if (capabilities.currentExtent.width != UINT32_MAX)
+    {
+        return capabilities.currentExtent;
+    }
+
+    // currentExtent를 surface가 정하지 않는 플랫폼은 프레임버퍼 크기 사용
+    int width = 0;
+    int height = 0;
+    glfwGetFramebufferSize(mWindow, &width, &height);
+
+    VkExtent2D extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+    extent.width = std::clamp(extent.width, capabilities.minImageExtent.width, capabilities.maxImageExtent.width);
+    extent.height = std::clamp(extent.height, capabilities.minImageExtent.height, capabilities.maxImageExtent.height);
+    return extent;
+}
+
+bool Renderer::recreateSwapchain()
+{
+    if (isMinimized())
+    {
+        return false;
+    }
+
+    Clock::time_point start = Clock::now();
+
+    // 이전 자원은 지금까지 제출된 프레임이 끝나면 파괴 (vkDeviceWaitIdle 없음)
+    VkDevice device = mLogicalDevice;
+    VkSwapchainKHR oldSwapchain = mSwapchain;
+    std::vector<VkImageView> oldImageViews;
+    std::vector<VkSemaphore> oldSemaphores;
+    oldImageViews.swap(mImageViews);
+    oldSemaphores.swap(renderFinishedSemaphores);
+
+    createSwapchain(mGraphicsFamilyIndex, mPresentFamilyIndex);
+    createRenderFinishedSemaphores();
+    mImageTimelineValues.assign(mImages.size(), 0);
+
+    DeferDestroy([device, oldSwapchain, oldImageViews, oldSemaphores]()
+    {
+        for (VkImageView imageView : oldImageViews)
+        {
+            vkDestroyImageView(device, imageView, nullptr);
+        }
+        for (VkSemaphore semaphore : oldSemaphores)
+        {
+            vkDestroySemaphore(device, semaphore, nullptr);
+        }
+        vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+    });
+    // 예전 이미지 뷰와 크기로 기록돼 있음
+    invalidateCachedCommands();
+
+    mSwapchainDirty = false;
+    mFramebufferResized = false;
+
+    LOG_INFO("Swapchain recreated (ms): {}", elapsedMs(start));
+    return true;
+}
+
+void Renderer::DeferDestroy(std::function<void()> destroy)
+{
+    // 지금까지 제출된 마지막 프레임이 끝나면 아무도 쓰지 않음
+    mDeletionQueue.Push(mGraphicsTimelineValue, std::move(destroy));
+}
+
+uint64_t Renderer::getCompletedTimelineValue() const
+{
+    uint64_t value = 0;
+    VkResult result = vkGetSemaphoreCounterValue(mLogicalDevice, mGraphicsTimeline, &value);
+    VkUtil::ExitIfFailed(result, "fail vkGetSemaphoreCounterValue");
+    return value;
+}
+
+void Renderer::waitFrameSlot()
+{
+    // 제출한 값과 끝난 값의 차이가 그대로 GPU가 뒤처진 프레임 수
+    mLastFrameTimings.gpuFramesBehind = mGraphicsTimelineValue - getCompletedTimelineValue();
+    VkUtil::WaitTimeline(mLogicalDevice, mGraphicsTimeline, mFrameSlotValues[mCurrentFrame]);
+    mDeletionQueue.Collect(getCompletedTimelineValue());
+}
+
 VkSurfaceFormatKHR Renderer::pickBestFormat() const
 {
     uint32_t formatCount = 0;
@@ -308,7 +771,7 @@ VkPresentModeKHR Renderer::pickBestPresentMode() const
 
     if (modeCount == 0)
     {
-        LOG_ENDLINE("No present modes found! default VK_PRESENT_MODE_IMMEDIATE_KHR");
+        LOG_WARNING("No present modes found! default VK_PRESENT_MODE_IMMEDIATE_KHR");
 	}
 
     std::vector<VkPresentModeKHR> modes(modeCount);
@@ -379,247 +842,367 @@ void Renderer::createImageViews(VkSurfaceFormatKHR format)
     }
 }
 
-void Renderer::createRenderPass()
+void Renderer::createOffscreenImages()
 {
-	VkAttachmentDescription colorAttachment{};
-	colorAttachment.format = pickBestFormat().format;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    mSwapchainExtent = { mConfig.width, mConfig.height };
+    mColorFormat = pickOffscreenFormat();
 
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-    VkAttachmentReference colorAttachmentRef{};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass{};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentRef;
-
-	VkRenderPassCreateInfo renderPassCI{};
-    renderPassCI.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassCI.subpassCount = 1;
-	renderPassCI.pSubpasses = &subpass;
-    renderPassCI.attachmentCount = 1;
-	renderPassCI.pAttachments = &colorAttachment;
+    uint32_t imageCount = mConfig.offscreenImageCount;
+    mImages.resize(imageCount);
+    mOffscreenAllocations.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; ++i)
+    {
+        VkImageCreateInfo imageCI{};
+        imageCI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageCI.imageType = VK_IMAGE_TYPE_2D;
+        imageCI.format = mColorFormat;
+        imageCI.extent = { mSwapchainExtent.width, mSwapchainExtent.height, 1 };
+        imageCI.mipLevels = 1;
+        imageCI.arrayLayers = 1;
+        imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+        // 결과를 읽어갈 수 있도록 TRANSFER_SRC
+        imageCI.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        VkResult result = vkCreateImage(mLogicalDevice, &imageCI, nullptr, &mImages[i]);
+        VkUtil::ExitIfFailed(result, "fail vkCreateImage");
+
+        // CPU 장치는 DEVICE_LOCAL이 없을 수도 있으므로 preferred로만 요청
+        mOffscreenAllocations[i] = mMemoryAllocator.AllocateForImage(mImages[i], 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        mImageViews.push_back(VkUtil::CreateImageView(mLogicalDevice, mImages[i], mColorFormat, VK_IMAGE_ASPECT_COLOR_BIT));
+    }
 
-	VkResult result = vkCreateRenderPass(mLogicalDevice, &renderPassCI, nullptr, &mRenderPass);
-    VkUtil::ExitIfFailed(result, "fail vkCreateRenderPass");
+    LOG_INFO("Offscreen images created: {}", imageCount);
 }
 
-void Renderer::createFramebuffers()
+VkFormat Renderer::pickOffscreenFormat() const
 {
-    mFramebuffers.resize(mImages.size());
-    for (uint32_t i = 0; i < mImages.size(); ++i)
+    const VkFormat candidates[] = { VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB, VK_FORMAT_R8G8B8A8_UNORM };
+    for (VkFormat format : candidates)
     {
-        VkImageView attachments[] = { mImageViews[i] };
+        VkFormatProperties props{};
+        vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, format, &props);
+        if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)
+        {
+            return format;
+        }
+    }
+    VkUtil::ExitIfFalse(false, "no color attachment format for offscreen rendering");
+    return VK_FORMAT_UNDEFINED;
+}
 
-		VkFramebufferCreateInfo framebufferCI{};
-        framebufferCI.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferCI.renderPass = mRenderPass;
-        framebufferCI.attachmentCount = 1;
-		framebufferCI.pAttachments = attachments;
-		framebufferCI.width = mSwapchainExtent.width;
-		framebufferCI.height = mSwapchainExtent.height;
-		framebufferCI.layers = 1;
+VkFormat Renderer::pickDepthFormat() const
+{
+    // 스텐실이 필요 없으면 depth 전용 포맷, D16은 항상 지원됨
+    std::vector<VkFormat> candidates = mConfig.depthStencil
+        ? std::vector<VkFormat>{ VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D16_UNORM_S8_UINT }
+        : std::vector<VkFormat>{ VK_FORMAT_D32_SFLOAT, VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D16_UNORM };
+    for (VkFormat format : candidates)
+    {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, format, &props);
+        if (props.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+        {
+            return format;
+        }
+    }
+    VkUtil::ExitIfFalse(false, "no depth attachment format");
+    return VK_FORMAT_UNDEFINED;
+}
 
-        VkResult result = vkCreateFramebuffer(mLogicalDevice, &framebufferCI, nullptr, &mFramebuffers[i]);
-		VkUtil::ExitIfFailed(result, "fail vkCreateFramebuffer");
+VkShaderModule Renderer::loadShader(const char* sourcePath, const char* spirvPath)
+{
+    // 소스보다 오래된 .spv는 파이프라인 레이아웃과 어긋날 수 있으므로 쓰지 않음
+    if (sourcePath != nullptr && ShaderRegistry::Build(sourcePath, spirvPath) == false)
+    {
+        return VK_NULL_HANDLE;
     }
-    LOG("Framebuffers created: ");
-    LOG_ENDLINE(mFramebuffers.size());
+    return mShaderRegistry.Load(spirvPath);
 }
 
 void Renderer::createGraphicsPipeline()
 {
-	std::vector<char> vsCode = VkUtil::ReadFile("vert.spv"); // 커맨드라인 인자로 받기? 
-    VkShaderModule vertShaderModule = createShaderModule(vsCode);
-    std::vector<char> fsCode = VkUtil::ReadFile("frag.spv");
-    VkShaderModule fragShaderModule = createShaderModule(fsCode);
-
-    LOG_ENDLINE("Shader modules created.");
-
-
-    VkPipelineShaderStageCreateInfo vertexShaderCI{};
-	vertexShaderCI.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertexShaderCI.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertexShaderCI.module = vertShaderModule;
-    vertexShaderCI.pName = "main";
-
-    VkPipelineShaderStageCreateInfo fragmentShaderCI{};
-	fragmentShaderCI.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragmentShaderCI.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragmentShaderCI.module = fragShaderModule;
-    fragmentShaderCI.pName = "main";
-
-    VkPipelineShaderStageCreateInfo shaders[] = { vertexShaderCI, fragmentShaderCI };
-
-    VkPipelineVertexInputStateCreateInfo vertexInputCI{};
-    vertexInputCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-
-    VkPipelineInputAssemblyStateCreateInfo inputAssemblyCI{};
-	inputAssemblyCI.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssemblyCI.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssemblyCI.primitiveRestartEnable = VK_FALSE;
-
-
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(mSwapchainExtent.width);
-    viewport.height = static_cast<float>(mSwapchainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = mSwapchainExtent;
-
-    VkViewport viewports[] = { viewport };
-    VkRect2D scissors[] = { scissor };
-
-    VkPipelineViewportStateCreateInfo viewportCI{};
-    viewportCI.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportCI.viewportCount = 1;
-    viewportCI.scissorCount = 1;
-    viewportCI.pViewports = viewports;
-    viewportCI.pScissors = scissors;
-
-    VkPipelineRasterizationStateCreateInfo rasterizationCI{};
-	rasterizationCI.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizationCI.depthClampEnable = VK_FALSE;
-    rasterizationCI.rasterizerDiscardEnable = VK_FALSE;
-    rasterizationCI.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizationCI.lineWidth = 1.0f;
-    rasterizationCI.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizationCI.frontFace = VK_FRONT_FACE_CLOCKWISE;
-
-    VkPipelineMultisampleStateCreateInfo multisampleCI{};
-	multisampleCI.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampleCI.sampleShadingEnable = VK_FALSE;
-    multisampleCI.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
-        VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-
-    VkPipelineColorBlendStateCreateInfo colorBlendCI{};
-	colorBlendCI.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlendCI.logicOpEnable = VK_FALSE;
-    colorBlendCI.logicOp = VK_LOGIC_OP_COPY;
-    colorBlendCI.attachmentCount = 1;
-    colorBlendCI.pAttachments = &colorBlendAttachment;
-
-    VkPipelineLayoutCreateInfo layoutCI{};
-    layoutCI.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    layoutCI.setLayoutCount = 0;         // ��ũ���ͼ� ����
-    layoutCI.pushConstantRangeCount = 0; // Ǫ���ܽ�źƮ ����
-
-    VkResult result = vkCreatePipelineLayout(mLogicalDevice, &layoutCI, nullptr, &mPipelineLayout);
-    VkUtil::ExitIfFailed(result, "fail layout");
-	
-    VkGraphicsPipelineCreateInfo pipelineCI{};
+    VkShaderModule vertShaderModule = loadShader(mConfig.vertexShaderSource, mConfig.vertexShaderPath);
+    VkShaderModule fragShaderModule = loadShader(mConfig.fragmentShaderSource, mConfig.fragmentShaderPath);
+    VkUtil::ExitIfFalse(vertShaderModule != VK_NULL_HANDLE && fragShaderModule != VK_NULL_HANDLE, "failed to load shaders! (needs glslc and spirv-val from the Vulkan SDK to build the .spv files)");
+
+    LOG_INFO("Shader modules created.");
+
+    // set 0 : 인스턴스, set 1 : 컬링 결과, set 2 : 바인드리스 리소스, set 3 : 프레임 상수
+    // 푸시 상수는 드로우마다 바뀌는 양자화된 위치를 복원할 오프셋/스케일
+    PipelineLayoutDesc layoutDesc;
+    layoutDesc.setLayoutCount = 4;
+    layoutDesc.setLayouts[0] = mInstances.GetSetLayout();
+    layoutDesc.setLayouts[1] = mCulling.GetSetLayout();
+    layoutDesc.setLayouts[2] = mBindless.GetSetLayout();
+    layoutDesc.setLayouts[3] = mFrameAllocator.GetSetLayout();
+    layoutDesc.pushConstantRangeCount = 1;
+    layoutDesc.pushConstantRanges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    layoutDesc.pushConstantRanges[0].offset = 0;
+    layoutDesc.pushConstantRanges[0].size = sizeof(DrawConstants);
+    mPipelineLayout = mPipelineLibrary.GetPipelineLayout(layoutDesc);
+
+    mStartupMetrics.pipelineCacheWarm = mPipelineCache.IsWarm();
+    mStartupMetrics.pipelineCacheLoadedBytes = mPipelineCache.GetLoadedBytes();
+
+    const std::vector<VkVertexInputAttributeDescription>& attributes = Mesh::GetAttributeDescriptions();
+    VkUtil::ExitIfFalse(attributes.size() <= GraphicsPipelineDesc::MAX_VERTEX_ATTRIBUTES, "too many vertex attributes");
+
+    GraphicsPipelineDesc desc;
+    desc.vertexShader = vertShaderModule;
+    desc.fragmentShader = fragShaderModule;
+    desc.layout = mPipelineLayout;
+    desc.vertexStride = Mesh::GetBindingDescription().stride;
+    desc.vertexAttributeCount = static_cast<uint32_t>(attributes.size());
+    std::copy(attributes.begin(), attributes.end(), desc.vertexAttributes);
+    desc.colorFormat = mColorFormat;
+    desc.depthFormat = mDepthFormat;
+    desc.stencilFormat = mConfig.depthStencil ? mDepthFormat : VK_FORMAT_UNDEFINED;
+    desc.depthTestEnable = VK_TRUE;
+    desc.depthWriteEnable = VK_TRUE;
+    desc.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+
+    // 컴파일이 끝날 때까지 드로우는 건너뜀, 그동안 메시 로딩 등이 진행됨
+    mGraphicsPipeline = mPipelineLibrary.GetGraphicsPipeline("Main", desc);
+
+    if (mConfig.depthPrepass)
+    {
+        // 프리패스가 가장 가까운 깊이를 써 두면 메인 패스는 같은 깊이만 셰이딩
+        GraphicsPipelineDesc prepassDesc = desc;
+        prepassDesc.fragmentShader = VK_NULL_HANDLE;
+        prepassDesc.colorFormat = VK_FORMAT_UNDEFINED;
+        mDepthPrepassPipeline = mPipelineLibrary.GetGraphicsPipeline("DepthPrepass", prepassDesc);
+
+        desc.depthWriteEnable = VK_FALSE;
+        desc.depthCompareOp = VK_COMPARE_OP_EQUAL;
+        mPrepassMainPipeline = mPipelineLibrary.GetGraphicsPipeline("MainAfterPrepass", desc);
+    }
+	LOG_INFO("Graphics pipeline requested.");
+}
 
-	pipelineCI.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineCI.stageCount = 2;
-    pipelineCI.pStages = shaders;
-    pipelineCI.pVertexInputState = &vertexInputCI;
-    pipelineCI.pInputAssemblyState = &inputAssemblyCI;
-    pipelineCI.pViewportState = &viewportCI;
-    pipelineCI.pRasterizationState = &rasterizationCI;
-    pipelineCI.pMultisampleState = &multisampleCI;
-    pipelineCI.pColorBlendState = &colorBlendCI;
-    pipelineCI.layout = mPipelineLayout;
-	pipelineCI.renderPass = mRenderPass;
-	pipelineCI.subpass = 0;
+void Renderer::onPipelinesCompiled()
+{
+    mStartupMetrics.pipelineCreationMs = 0.0;
+    for (const PipelineCompileStats& stats : mPipelineCompiler.GetStats())
+    {
+        VkUtil::ExitIfFalse(stats.failed == false, "fail vkCreateGraphicsPipelines");
+        mStartupMetrics.pipelineCreationMs += stats.compileMs;
+    }
+    LOG_INFO("Pipeline creation ({} cache, ms): {}", mStartupMetrics.pipelineCacheWarm ? "warm" : "cold", mStartupMetrics.pipelineCreationMs);
 
-    VkResult r = vkCreateGraphicsPipelines(mLogicalDevice, nullptr, 1, &pipelineCI, nullptr, &mGraphicsPipeline);
-	VkUtil::ExitIfFailed(r, "fail vkCreateGraphicsPipelines");
+    // 파이프라인이 만들어졌으므로 모듈은 더 필요 없음
+    mShaderRegistry.DestroyModules();
+    mShaderModulesAlive = false;
+}
 
+void Renderer::createMesh()
+{
+    if (mConfig.meshPath != nullptr)
+    {
+        bool loaded = mMesh.Load(mLogicalDevice, mMemoryAllocator, mUploadEngine, mConfig.meshPath);
+        VkUtil::ExitIfFalse(loaded, "failed to load mesh!");
+        LOG_INFO("Mesh loaded, indices: {}", mMesh.GetIndexCount());
+        return;
+    }
 
-	LOG_ENDLINE("Graphics pipeline created.");
+    // 메시 파일이 없으면 예전 셰이더에 하드코딩돼 있던 삼각형
+    const float positions[] = { 0.0f, -0.5f, 0.0f,  0.5f, 0.5f, 0.0f,  -0.5f, 0.5f, 0.0f };
+    const float normals[] = { 0.0f, 0.0f, -1.0f,  0.0f, 0.0f, -1.0f,  0.0f, 0.0f, -1.0f };
+    const float uvs[] = { 0.5f, 0.0f,  1.0f, 1.0f,  0.0f, 1.0f };
+    const uint32_t indices[] = { 0, 1, 2 };
+
+    MeshSource source{};
+    source.positions = positions;
+    source.normals = normals;
+    source.uvs = uvs;
+    source.vertexCount = 3;
+    source.indices = indices;
+    source.indexCount = 3;
+    std::vector<uint8_t> data = Mesh::Encode(source);
+    mMesh.Create(mLogicalDevice, mMemoryAllocator, mUploadEngine, data.data(), data.size());
 }
 
-VkShaderModule Renderer::createShaderModule(const std::vector<char>& code) const
+void Renderer::createDefaultTexture()
 {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-
-    VkShaderModule shaderModule;
-    VkResult result = vkCreateShaderModule(mLogicalDevice, &createInfo, nullptr, &shaderModule);
-	VkUtil::ExitIfFailed(result, "fail vkCreateShaderModule");
-    return shaderModule;
+    // 1x1 흰색 : 텍스처를 지정하지 않은 인스턴스는 색만 적용됨
+    VkImageCreateInfo imageCI{};
+    imageCI.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageCI.imageType = VK_IMAGE_TYPE_2D;
+    imageCI.format = VK_FORMAT_R8G8B8A8_UNORM;
+    imageCI.extent = { 1, 1, 1 };
+    imageCI.mipLevels = 1;
+    imageCI.arrayLayers = 1;
+    imageCI.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageCI.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageCI.usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    imageCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkResult result = vkCreateImage(mLogicalDevice, &imageCI, nullptr, &mDefaultTexture);
+    VkUtil::ExitIfFailed(result, "fail vkCreateImage (default texture)");
+    mDefaultTextureAllocation = mMemoryAllocator.AllocateForImage(mDefaultTexture, 0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    const uint8_t white[4] = { 255, 255, 255, 255 };
+    mUploadEngine.UploadImage(mDefaultTexture, imageCI.extent, VK_IMAGE_ASPECT_COLOR_BIT, white, sizeof(white),
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    mDefaultTextureView = VkUtil::CreateImageView(mLogicalDevice, mDefaultTexture, imageCI.format, VK_IMAGE_ASPECT_COLOR_BIT);
+
+    VkSamplerCreateInfo samplerCI{};
+    samplerCI.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerCI.magFilter = VK_FILTER_LINEAR;
+    samplerCI.minFilter = VK_FILTER_LINEAR;
+    samplerCI.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerCI.maxLod = VK_LOD_CLAMP_NONE;
+    result = vkCreateSampler(mLogicalDevice, &samplerCI, nullptr, &mDefaultSampler);
+    VkUtil::ExitIfFailed(result, "fail vkCreateSampler");
+
+    // InstanceData의 0번 슬롯
+    BindlessIndex texture = mBindless.AddTexture(mDefaultTextureView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    BindlessIndex sampler = mBindless.AddSampler(mDefaultSampler);
+    VkUtil::ExitIfFalse(texture == 0 && sampler == 0, "default texture must take bindless slot 0");
 }
 
-void Renderer::createCommandPool(const uint32_t graphicsFamilyIndex)
+void Renderer::createCommandPools(const uint32_t graphicsFamilyIndex)
 {
-	VkCommandPoolCreateInfo poolCI{};
-	poolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-	poolCI.queueFamilyIndex = graphicsFamilyIndex;
-    poolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-	VkResult result = vkCreateCommandPool(mLogicalDevice, &poolCI, nullptr, &mCommandPool);
-    VkUtil::ExitIfFailed(result, "fail createCommandPool");
+    // 프레임마다 풀 하나, 커맨드 버퍼를 개별 리셋하지 않고 vkResetCommandPool로 통째로 리셋
+    mCommandPools.resize(mConfig.framesInFlight);
+    for (uint32_t i = 0; i < mCommandPools.size(); ++i)
+    {
+        VkCommandPoolCreateInfo poolCI{};
+        poolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCI.queueFamilyIndex = graphicsFamilyIndex;
+        poolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        VkResult result = vkCreateCommandPool(mLogicalDevice, &poolCI, nullptr, &mCommandPools[i]);
+        VkUtil::ExitIfFailed(result, "fail createCommandPool");
+    }
 
+    // 재사용하는 버퍼는 개별로 다시 기록하므로 RESET 플래그
+    if (mConfig.reuseCommandBuffers)
+    {
+        VkCommandPoolCreateInfo poolCI{};
+        poolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCI.queueFamilyIndex = graphicsFamilyIndex;
+        poolCI.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        VkResult result = vkCreateCommandPool(mLogicalDevice, &poolCI, nullptr, &mCachedCommandPool);
+        VkUtil::ExitIfFailed(result, "fail createCommandPool (cached)");
+        mCachedCommands.resize(mConfig.framesInFlight);
+    }
+
+    // 풀은 외부 동기화가 필요하므로 세컨더리용 풀은 프레임 x 스레드
+    if (mJobSystem.GetThreadCount() <= 1)
+    {
+        return;
+    }
+    mThreadCommands.resize(mConfig.framesInFlight);
+    for (uint32_t i = 0; i < mThreadCommands.size(); ++i)
+    {
+        mThreadCommands[i].resize(mJobSystem.GetThreadCount());
+        for (ThreadCommands& commands : mThreadCommands[i])
+        {
+            VkCommandPoolCreateInfo poolCI{};
+            poolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolCI.queueFamilyIndex = graphicsFamilyIndex;
+            poolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+            VkResult result = vkCreateCommandPool(mLogicalDevice, &poolCI, nullptr, &commands.pool);
+            VkUtil::ExitIfFailed(result, "fail createCommandPool (thread)");
+            commands.used = 0;
+        }
+    }
 }
 
 void Renderer::createCommandBuffers()
 {
-	mCommandBuffers.resize(mImages.size());
-    
-    VkCommandBufferAllocateInfo allocCI{};
-    allocCI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocCI.commandPool = mCommandPool;
-    allocCI.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocCI.commandBufferCount = mCommandBuffers.size();
-
-    VkResult result = vkAllocateCommandBuffers(mLogicalDevice, &allocCI, mCommandBuffers.data());
-    VkUtil::ExitIfFailed(result, "fail createCommandBuffers");
+	mCommandBuffers.resize(mCommandPools.size());
 
+    for (uint32_t i = 0; i < mCommandBuffers.size(); ++i)
+    {
+        VkCommandBufferAllocateInfo allocCI{};
+        allocCI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocCI.commandPool = mCommandPools[i];
+        allocCI.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocCI.commandBufferCount = 1;
+
+        VkResult result = vkAllocateCommandBuffers(mLogicalDevice, &allocCI, &mCommandBuffers[i]);
+        VkUtil::ExitIfFailed(result, "fail createCommandBuffers");
+    }
 }
 
 void Renderer::createSyncObjects() 
 {
-    mImagesInFlight.assign(mFramebuffers.size(), VK_NULL_HANDLE);
-    mFences.resize(mFramebuffers.size());
-	imageAvailableSemaphores.resize(mFramebuffers.size());
-	renderFinishedSemaphores.resize(mFramebuffers.size());
+    // 펜스 대신 그래픽스 타임라인 하나, 프레임 슬롯/이미지는 마지막으로 제출된 값만 기억
+    // imageAvailable/renderFinished는 WSI가 바이너리만 받으므로 그대로 둠
+    // renderFinished는 present가 끝날 때까지 이미지에 묶이므로 스왑체인 이미지 수만큼
+    mGraphicsTimeline = VkUtil::CreateTimelineSemaphore(mLogicalDevice, 0);
+    mGraphicsTimelineValue = 0;
+    mFrameSlotValues.assign(mConfig.framesInFlight, 0);
+    mImageTimelineValues.assign(mImages.size(), 0);
+	imageAvailableSemaphores.resize(mConfig.framesInFlight);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-    for (uint32_t i = 0; i < mFences.size(); i++)
+    for (uint32_t i = 0; i < imageAvailableSemaphores.size(); i++)
     {
-        vkCreateFence(mLogicalDevice, &fenceInfo, nullptr, &mFences[i]);
 		vkCreateSemaphore(mLogicalDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]);
+    }
+    createRenderFinishedSemaphores();
+}
+
+void Renderer::createRenderFinishedSemaphores()
+{
+	renderFinishedSemaphores.resize(mImages.size());
+
+	VkSemaphoreCreateInfo semaphoreInfo{};
+	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    for (uint32_t i = 0; i < renderFinishedSemaphores.size(); i++)
+    {
 		vkCreateSemaphore(mLogicalDevice, &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]);
     }
 }
 
 void Renderer::mainLoop()
 {
+    if (mConfig.headless)
+    {
+        for (uint32_t i = 0; i < mConfig.headlessFrameCount; ++i)
+        {
+            RenderFrame();
+        }
+        return;
+    }
+
     while (!glfwWindowShouldClose(mWindow))
     {
-        glfwPollEvents();
-        drawFrame();
+        RenderFrame();
     }
 }
 
 void Renderer::drawFrame()
 {
-	LOG("Drawing frame start");
-    vkWaitForFences(mLogicalDevice, 1, &mFences[mCurrentFrame], VK_TRUE, UINT64_MAX);
+    // 기본 빌드에서는 컴파일되지 않음 (LOG_MIN_LEVEL)
+    LOG_TRACE("Drawing frame start");
+    mLastFrameTimings = {};
+    Clock::time_point t = Clock::now();
+
+    waitFrameSlot();
+    mLastFrameTimings.waitGpuMs = elapsedMs(t);
+
+    if (mConfig.headless)
+    {
+        drawOffscreenFrame(t);
+        return;
+    }
+
+    if (mSwapchainDirty && recreateSwapchain() == false)
+    {
+        return;
+    }
+    t = Clock::now();
 
     uint32_t imageIndex;
     VkResult acquireResult = vkAcquireNextImageKHR(
@@ -629,41 +1212,60 @@ void Renderer::drawFrame()
         imageAvailableSemaphores[mCurrentFrame],
         VK_NULL_HANDLE,
         &imageIndex);
-    if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR || acquireResult == VK_SUBOPTIMAL_KHR)
+    mLastFrameTimings.acquireMs = elapsedMs(t);
+    if (acquireResult == VK_ERROR_OUT_OF_DATE_KHR)
     {
+        // 이미지를 못 얻었으므로 세마포어도 signal 되지 않음, 다음 프레임에 재생성
+        mSwapchainDirty = true;
         return;
     }
-    VkUtil::ExitIfFailed(acquireResult, "vkAcquireNextImageKHR");
-	
-    if (mImagesInFlight[imageIndex] != VK_NULL_HANDLE) 
+    if (acquireResult == VK_SUBOPTIMAL_KHR)
     {
-        vkWaitForFences(mLogicalDevice, 1, &mImagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        // 세마포어는 signal 되므로 이번 프레임은 그리고 present 후 재생성
+        mSwapchainDirty = true;
     }
-
-    vkResetFences(mLogicalDevice, 1, &mFences[mCurrentFrame]);
-    mImagesInFlight[imageIndex] = mFences[mCurrentFrame];
-    VkResult reulst = vkResetCommandBuffer(mCommandBuffers[imageIndex], 0);
-	VkUtil::ExitIfFailed(reulst, "fail vkResetCommandBuffer");
-
-    recordCommandBuffer(mCommandBuffers[imageIndex], imageIndex);
-
-    VkSemaphore signalSem[] = { renderFinishedSemaphores[imageIndex] };
-    VkSemaphore waitSem[] = { imageAvailableSemaphores[mCurrentFrame] };
-    VkPipelineStageFlags waitStage[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    else
+    {
+        VkUtil::ExitIfFailed(acquireResult, "vkAcquireNextImageKHR");
+    }
+	
+    // 슬롯이 다른 이전 프레임이 같은 이미지를 아직 쓰고 있을 수 있음
+    VkUtil::WaitTimeline(mLogicalDevice, mGraphicsTimeline, mImageTimelineValues[imageIndex]);
+    mLastFrameTimings.waitGpuMs += elapsedMs(t);
+
+    // 바이너리 세마포어의 대기 값은 무시됨
+    mFrameWaitSemaphores.assign(1, imageAvailableSemaphores[mCurrentFrame]);
+    mFrameWaitStages.assign(1, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    mFrameWaitValues.assign(1, 0);
+    VkCommandBuffer frameCommands = buildFrameCommands(imageIndex);
+    mLastFrameTimings.recordMs = elapsedMs(t);
+
+    uint64_t frameValue = nextFrameValue(imageIndex);
+    VkSemaphore signalSem[] = { renderFinishedSemaphores[imageIndex], mGraphicsTimeline };
+    uint64_t signalValues[] = { 0, frameValue };
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(mFrameWaitValues.size());
+    timelineInfo.pWaitSemaphoreValues = mFrameWaitValues.data();
+    timelineInfo.signalSemaphoreValueCount = 2;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
 
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
     submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &mCommandBuffers[imageIndex];
+    submitInfo.pCommandBuffers = &frameCommands;
 
-    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.signalSemaphoreCount = 2;
     submitInfo.pSignalSemaphores = signalSem;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSem;
-    submitInfo.pWaitDstStageMask = waitStage;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(mFrameWaitSemaphores.size());
+    submitInfo.pWaitSemaphores = mFrameWaitSemaphores.data();
+    submitInfo.pWaitDstStageMask = mFrameWaitStages.data();
 
-    VkResult result1 = vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, mFences[mCurrentFrame]);
+    VkResult result1 = vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
     VkUtil::ExitIfFailed(result1, "fail vkQueueSubmit");
+    mLastFrameTimings.submitMs = elapsedMs(t);
 
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -671,17 +1273,171 @@ void Renderer::drawFrame()
     presentInfo.pSwapchains = &mSwapchain;
     presentInfo.pImageIndices = &imageIndex;
 
+    // 타임라인은 빼고 renderFinished만
     presentInfo.waitSemaphoreCount = 1;
     presentInfo.pWaitSemaphores = signalSem;
 
     VkResult rP = vkQueuePresentKHR(mPresentQueue, &presentInfo);
-    if (rP == VK_ERROR_OUT_OF_DATE_KHR || rP == VK_SUBOPTIMAL_KHR)
+    mLastFrameTimings.presentMs = elapsedMs(t);
+    if (rP == VK_ERROR_OUT_OF_DATE_KHR || rP == VK_SUBOPTIMAL_KHR || mFramebufferResized)
     {
-        return;
+        mSwapchainDirty = true;
+        mFramebufferResized = false;
+    }
+    else
+    {
+        VkUtil::ExitIfFailed(rP, "vkQueuePresentKHR");
+    }
+
+	mCurrentFrame = (mCurrentFrame + 1) % mConfig.framesInFlight;
+    ++mFrameNumber;
+}
+
+void Renderer::drawOffscreenFrame(Clock::time_point& t)
+{
+    // 스왑체인이 없으므로 이미지를 순서대로 돌려 씀, 세마포어 대기 없이 제출
+    uint32_t imageIndex = mNextOffscreenImage;
+    mNextOffscreenImage = (mNextOffscreenImage + 1) % static_cast<uint32_t>(mImages.size());
+
+    VkUtil::WaitTimeline(mLogicalDevice, mGraphicsTimeline, mImageTimelineValues[imageIndex]);
+    mLastFrameTimings.waitGpuMs += elapsedMs(t);
+
+    mFrameWaitSemaphores.clear();
+    mFrameWaitStages.clear();
+    mFrameWaitValues.clear();
+    VkCommandBuffer frameCommands = buildFrameCommands(imageIndex);
+    mLastFrameTimings.recordMs = elapsedMs(t);
+
+    uint64_t frameValue = nextFrameValue(imageIndex);
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(mFrameWaitValues.size());
+    timelineInfo.pWaitSemaphoreValues = mFrameWaitValues.data();
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &frameValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frameCommands;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(mFrameWaitSemaphores.size());
+    submitInfo.pWaitSemaphores = mFrameWaitSemaphores.data();
+    submitInfo.pWaitDstStageMask = mFrameWaitStages.data();
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &mGraphicsTimeline;
+
+    VkResult result = vkQueueSubmit(mGraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    VkUtil::ExitIfFailed(result, "fail vkQueueSubmit");
+    mLastFrameTimings.submitMs = elapsedMs(t);
+
+    mCurrentFrame = (mCurrentFrame + 1) % mConfig.framesInFlight;
+    ++mFrameNumber;
+}
+
+uint64_t Renderer::nextFrameValue(uint32_t imageIndex)
+{
+    uint64_t value = ++mGraphicsTimelineValue;
+    mFrameSlotValues[mCurrentFrame] = value;
+    mImageTimelineValues[imageIndex] = value;
+    return value;
+}
+
+VkCommandBuffer Renderer::buildFrameCommands(uint32_t imageIndex)
+{
+    // 이번 프레임 전에 쌓인 업로드를 제출
+    mUploadEngine.Flush();
+    bool hasAcquires = mUploadEngine.HasPendingAcquires();
+    // 바뀐 인스턴스 범위만 이 프레임 영역에 씀
+    mInstances.Prepare(mCurrentFrame);
+    mBindless.Prepare();
+    // 이 프레임의 상수 영역을 비우고 프레임 상수를 한 번 씀
+    mFrameAllocator.Begin(mCurrentFrame);
+    FrameConstants frameConstants{};
+    memcpy(frameConstants.viewProjection, mViewProjection, sizeof(frameConstants.viewProjection));
+    mFrameConstantsOffset = mFrameAllocator.Push(frameConstants);
+    mCulling.Prepare(mCurrentFrame, mInstances.GetCount(), mInstances.GetMeshCounts());
+
+    if (mConfig.reuseCommandBuffers == false)
+    {
+        VkResult result = vkResetCommandPool(mLogicalDevice, mCommandPools[mCurrentFrame], 0);
+        VkUtil::ExitIfFailed(result, "fail vkResetCommandPool");
+        recordCommandBuffer(mCommandBuffers[mCurrentFrame], imageIndex);
+        ++mCommandReuseStats.recordedFrames;
+        return mCommandBuffers[mCurrentFrame];
+    }
+
+    // 이미지 수는 스왑체인 재생성 때 바뀔 수 있으므로 필요할 때 늘림
+    std::vector<CachedCommands>& frameCommands = mCachedCommands[mCurrentFrame];
+    while (frameCommands.size() <= imageIndex)
+    {
+        CachedCommands cached{};
+        VkCommandBufferAllocateInfo allocCI{};
+        allocCI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocCI.commandPool = mCachedCommandPool;
+        allocCI.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocCI.commandBufferCount = 1;
+        VkResult result = vkAllocateCommandBuffers(mLogicalDevice, &allocCI, &cached.buffer);
+        VkUtil::ExitIfFailed(result, "fail vkAllocateCommandBuffers (cached)");
+        frameCommands.push_back(cached);
+    }
+
+    CachedCommands& cached = frameCommands[imageIndex];
+    RecordState state = captureRecordState();
+    if (cached.reusable && hasAcquires == false && isSameRecordState(cached.state, state))
+    {
+        // 기록할 배리어가 없으므로 대기할 세마포어만 받음
+        mUploadEngine.RecordAcquires(VK_NULL_HANDLE, mFrameWaitSemaphores, mFrameWaitStages, mFrameWaitValues);
+        mGpuProfiler.ReplayFrame(mCurrentFrame);
+        ++mCommandReuseStats.reusedFrames;
+        return cached.buffer;
     }
-    VkUtil::ExitIfFailed(rP, "vkQueuePresentKHR");
 
-	mCurrentFrame = (mCurrentFrame + 1) % mFramebuffers.size();
+    // 이 슬롯의 펜스를 기다렸으므로 다시 기록해도 됨, vkBeginCommandBuffer가 암묵적으로 리셋
+    recordCommandBuffer(cached.buffer, imageIndex);
+    cached.state = state;
+    // 소유권 획득은 한 번만 실행돼야 함
+    cached.reusable = hasAcquires == false;
+    ++mCommandReuseStats.recordedFrames;
+    return cached.buffer;
+}
+
+Renderer::RecordState Renderer::captureRecordState() const
+{
+    RecordState state{};
+    bool prepass = useDepthPrepass();
+    state.pipeline = mPipelineCompiler.Get(prepass ? mPrepassMainPipeline : mGraphicsPipeline);
+    state.prepassPipeline = prepass ? mPipelineCompiler.Get(mDepthPrepassPipeline) : VK_NULL_HANDLE;
+    state.instanceCount = mInstances.GetCount();
+    state.meshCount = mCulling.GetMeshCount();
+    state.instanceGeneration = mInstances.GetGeneration();
+    state.cullingGeneration = mCulling.GetGeneration();
+    state.viewVersion = mViewVersion;
+    state.frameConstantsOffset = mFrameConstantsOffset;
+    return state;
+}
+
+bool Renderer::isSameRecordState(const RecordState& a, const RecordState& b)
+{
+    return a.pipeline == b.pipeline
+        && a.prepassPipeline == b.prepassPipeline
+        && a.instanceCount == b.instanceCount
+        && a.meshCount == b.meshCount
+        && a.instanceGeneration == b.instanceGeneration
+        && a.cullingGeneration == b.cullingGeneration
+        && a.viewVersion == b.viewVersion
+        && a.frameConstantsOffset == b.frameConstantsOffset;
+}
+
+void Renderer::invalidateCachedCommands()
+{
+    for (std::vector<CachedCommands>& frameCommands : mCachedCommands)
+    {
+        for (CachedCommands& cached : frameCommands)
+        {
+            cached.reusable = false;
+        }
+    }
 }
 
 void Renderer::recordCommandBuffer(VkCommandBuffer currentBuffer, uint32_t imageIndex)
@@ -691,57 +1447,472 @@ void Renderer::recordCommandBuffer(VkCommandBuffer currentBuffer, uint32_t image
     VkResult result = vkBeginCommandBuffer(currentBuffer, &beginInfo);
 	VkUtil::ExitIfFailed(result, "fail vkBeginCommandBuffer");
 
-    LOG("Recording command buffer for image index: ");
-	LOG_ENDLINE(imageIndex);
+    LOG_TRACE("Recording command buffer for image index: {}", imageIndex);
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = mRenderPass;
-    renderPassInfo.framebuffer = mFramebuffers[imageIndex];
-    renderPassInfo.renderArea.extent = mSwapchainExtent;
-    renderPassInfo.renderArea.offset = { 0, 0 };
+    // 그래픽 큐 쪽 소유권을 가져옴
+    mUploadEngine.RecordAcquires(currentBuffer, mFrameWaitSemaphores, mFrameWaitStages, mFrameWaitValues);
 
-    VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+    // 이 프레임 슬롯의 펜스는 이미 대기했으므로 쿼리 풀 재사용 가능
+    mGpuProfiler.BeginFrame(currentBuffer, mCurrentFrame);
+    mGpuProfiler.BeginStatistics(currentBuffer);
+    // vkBeginCommandBuffer가 바인딩을 모두 초기화
+    mBindState.Reset();
 
-    vkCmdBeginRenderPass(currentBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-	vkCmdBindPipeline(currentBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, mGraphicsPipeline);
+    // 장벽과 레이아웃 전환은 그래프가 패스별 선언을 보고 넣음
+    mRenderGraph.Reset();
+    // acquire 세마포어 대기가 COLOR_ATTACHMENT_OUTPUT 단계를 막음, headless는 present 대신 복사해서 읽어감
+    RGResource backbuffer = mRenderGraph.ImportImage("Backbuffer", mImages[imageIndex], mImageViews[imageIndex], VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, mConfig.headless ? RGAccess::TransferRead : RGAccess::Present);
 
-    vkCmdDraw(currentBuffer, 3, 1, 0, 0);
+    // 오브젝트 수와 상관없이 커맨드 수는 일정
+    RGResource visible = INVALID_RG_RESOURCE;
+    RGResource indirect = INVALID_RG_RESOURCE;
+    RGResource counter = INVALID_RG_RESOURCE;
+    if (useGpuCulling())
+    {
+        visible = mRenderGraph.ImportBuffer("Visible", mCulling.GetVisibleBuffer(mCurrentFrame));
+        indirect = mRenderGraph.ImportBuffer("Indirect", mCulling.GetIndirectBuffer(mCurrentFrame));
+        counter = mRenderGraph.ImportBuffer("Counter", mCulling.GetCounterBuffer(mCurrentFrame));
+
+        uint32_t cullPass = mRenderGraph.AddPass("Culling", [this](VkCommandBuffer cmd)
+        {
+            uint32_t cullRegion = mGpuProfiler.BeginRegion(cmd, "Culling");
+            mCulling.RecordCull(cmd, mCurrentFrame, mInstances.GetSet(mCurrentFrame));
+            mGpuProfiler.EndRegion(cmd, cullRegion);
+        });
+        mRenderGraph.Use(cullPass, visible, RGAccess::StorageWrite);
+        mRenderGraph.Use(cullPass, indirect, RGAccess::StorageWrite);
+        mRenderGraph.Use(cullPass, counter, RGAccess::StorageWrite);
+    }
+
+    // 어태치먼트로만 쓰이므로 그래프가 TRANSIENT_ATTACHMENT + LAZILY_ALLOCATED로 만듦
+    RGImageDesc depthDesc{ mDepthFormat, mSwapchainExtent, mDepthAspect };
+    RGResource depth = mRenderGraph.CreateImage("Depth", depthDesc);
+
+    bool prepass = useDepthPrepass();
+    buildDrawList(prepass);
+    uint32_t sliceCount = getDrawSliceCount();
+    std::vector<uint32_t> drawPasses;
+    if (prepass)
+    {
+        uint32_t prepassPass = mRenderGraph.AddPass("DepthPrepass", [this, depth](VkCommandBuffer cmd) { recordDepthPrepass(cmd, mRenderGraph.GetImageView(depth)); });
+        mRenderGraph.Use(prepassPass, depth, RGAccess::DepthAttachmentWrite);
+        drawPasses.push_back(prepassPass);
+    }
+
+    uint32_t mainPass = mRenderGraph.AddPass("MainPass", [this, backbuffer, depth, prepass, sliceCount](VkCommandBuffer cmd)
+    {
+        recordMainPass(cmd, mRenderGraph.GetImageView(backbuffer), mRenderGraph.GetImageView(depth), prepass, sliceCount);
+    });
+    mRenderGraph.Use(mainPass, backbuffer, RGAccess::ColorAttachmentWrite);
+    mRenderGraph.Use(mainPass, depth, prepass ? RGAccess::DepthAttachmentRead : RGAccess::DepthAttachmentWrite);
+    drawPasses.push_back(mainPass);
+
+    if (useGpuCulling())
+    {
+        for (uint32_t pass : drawPasses)
+        {
+            mRenderGraph.Use(pass, visible, RGAccess::VertexStorageRead);
+            mRenderGraph.Use(pass, indirect, RGAccess::IndirectRead);
+            mRenderGraph.Use(pass, counter, RGAccess::IndirectRead);
+        }
+    }
+
+    mRenderGraph.Compile();
+    mRenderGraph.Execute(currentBuffer);
+
+    mGpuProfiler.EndStatistics(currentBuffer);
 
-    vkCmdEndRenderPass(currentBuffer);
     VkResult endResult = vkEndCommandBuffer(currentBuffer);
     VkUtil::ExitIfFailed(endResult, "vkEndCommandBuffer");
 }
 
+bool Renderer::useGpuCulling() const
+{
+    return mCulling.IsEnabled() && mConfig.perInstanceDraws == false;
+}
+
+bool Renderer::useDepthPrepass() const
+{
+    // 프리패스 파이프라인이 준비되기 전에는 일반 depth 테스트로 그림
+    return mConfig.depthPrepass
+        && mPipelineCompiler.Get(mDepthPrepassPipeline) != VK_NULL_HANDLE
+        && mPipelineCompiler.Get(mPrepassMainPipeline) != VK_NULL_HANDLE;
+}
+
+void Renderer::recordDepthPrepass(VkCommandBuffer currentBuffer, VkImageView depthView)
+{
+    uint32_t prepassRegion = mGpuProfiler.BeginRegion(currentBuffer, "DepthPrepass");
+
+    // 메인 패스가 읽으므로 저장
+    VkRenderingAttachmentInfo depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.imageView = depthView;
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+    VkRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.renderArea.extent = mSwapchainExtent;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.layerCount = 1;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+    renderingInfo.pStencilAttachment = mConfig.depthStencil ? &depthAttachment : nullptr;
+
+    // 정점 셰이더만 돌아서 기록 비용이 작으므로 인라인으로
+    size_t begin;
+    size_t end;
+    mDrawList.GetPassRange(DRAW_PASS_DEPTH_PREPASS, begin, end);
+    vkCmdBeginRendering(currentBuffer, &renderingInfo);
+    recordDraws(currentBuffer, begin, end, mBindState, mDrawStats);
+    vkCmdEndRendering(currentBuffer);
+
+    mGpuProfiler.EndRegion(currentBuffer, prepassRegion);
+}
+
+void Renderer::recordMainPass(VkCommandBuffer currentBuffer, VkImageView colorView, VkImageView depthView, bool afterPrepass, uint32_t sliceCount)
+{
+    uint32_t mainPassRegion = mGpuProfiler.BeginRegion(currentBuffer, "MainPass");
+
+    VkRenderingAttachmentInfo colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView = colorView;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+
+    // 프레임이 끝나면 아무도 읽지 않으므로 저장하지 않음 - 타일 메모리 밖으로 나가지 않음
+    // 프리패스 뒤에는 읽기 전용이라 DONT_CARE로 내용을 버리면 안 되므로 NONE(쓰기 없음)
+    VkRenderingAttachmentInfo depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.imageView = depthView;
+    depthAttachment.imageLayout = afterPrepass ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = afterPrepass ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = afterPrepass ? VK_ATTACHMENT_STORE_OP_NONE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+    VkRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.renderArea.extent = mSwapchainExtent;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+    renderingInfo.pStencilAttachment = mConfig.depthStencil ? &depthAttachment : nullptr;
+
+    // 나눌 만큼 많으면 워커들이 세컨더리 버퍼에 나눠서 기록
+    size_t begin;
+    size_t end;
+    mDrawList.GetPassRange(DRAW_PASS_MAIN, begin, end);
+    bool sliced = sliceCount > 0 && end - begin >= sliceCount;
+    if (sliced)
+    {
+        renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    }
+    mLastFrameTimings.recordSlices = sliced ? sliceCount : 0;
+
+    vkCmdBeginRendering(currentBuffer, &renderingInfo);
+    if (sliced)
+    {
+        recordDrawSlices(currentBuffer, begin, end, sliceCount);
+    }
+    else
+    {
+        recordDraws(currentBuffer, begin, end, mBindState, mDrawStats);
+    }
+    vkCmdEndRendering(currentBuffer);
+
+    mGpuProfiler.EndRegion(currentBuffer, mainPassRegion);
+}
+
+void Renderer::buildDrawList(bool prepass)
+{
+    mDrawList.Clear();
+    uint32_t instanceCount = mInstances.GetCount();
+    if (instanceCount == 0)
+    {
+        return;
+    }
+
+    DrawConstants constants{};
+    constants.decode = mMesh.GetDecode();
+    constants.culled = useGpuCulling() ? 1 : 0;
+
+    // set 0 : 인스턴스, set 1 : 컬링 결과, set 2 : 바인드리스 리소스, set 3 : 프레임 상수
+    DrawPacket packet{};
+    packet.layout = mPipelineLayout;
+    packet.setCount = 4;
+    packet.sets[0].set = mInstances.GetSet(mCurrentFrame);
+    packet.sets[1].set = mCulling.GetSet(mCurrentFrame);
+    packet.sets[2].set = mBindless.GetSet();
+    packet.sets[3].set = mFrameAllocator.GetSet();
+    packet.sets[3].dynamicOffsetCount = 2;
+    packet.sets[3].dynamicOffsets[0] = mFrameConstantsOffset;
+    packet.sets[3].dynamicOffsets[1] = 0;
+    packet.vertexBuffer = mMesh.GetVertexBuffer();
+    packet.indexBuffer = mMesh.GetIndexBuffer();
+    packet.indexType = mMesh.GetIndexType();
+    packet.pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT;
+    packet.pushConstantOffset = mDrawList.AddPushConstants(&constants, sizeof(constants));
+    packet.pushConstantSize = sizeof(DrawConstants);
+
+    // 재질은 인스턴스마다 바인드리스 인덱스로, 메시는 버퍼 하나를 나눠 쓰므로 키에서는 둘 다 0
+    const PipelineHandle passPipelines[] =
+    {
+        prepass ? mDepthPrepassPipeline : INVALID_PIPELINE,
+        prepass ? mPrepassMainPipeline : mGraphicsPipeline
+    };
+    for (uint32_t pass = DRAW_PASS_DEPTH_PREPASS; pass <= DRAW_PASS_MAIN; ++pass)
+    {
+        // 아직 컴파일 중이면 (대체 파이프라인도 없으면) 그리지 않음
+        packet.pipeline = passPipelines[pass] != INVALID_PIPELINE ? mPipelineCompiler.Get(passPipelines[pass]) : VK_NULL_HANDLE;
+        if (packet.pipeline == VK_NULL_HANDLE)
+        {
+            continue;
+        }
+        uint64_t key = DrawList::MakeKey(pass, passPipelines[pass], 0, 0, 0);
+
+        if (useGpuCulling())
+        {
+            packet.command = mCulling.GetDrawCommand(mCurrentFrame);
+            mDrawList.Add(key, packet);
+        }
+        else if (mConfig.perInstanceDraws)
+        {
+            // 인스턴스마다 드로우 하나, 셰이더는 firstInstance로 자기 인스턴스를 찾음
+            packet.command = DrawCommand{};
+            packet.command.indexCount = mMesh.GetIndexCount();
+            packet.command.instanceCount = 1;
+            for (uint32_t instance = 0; instance < instanceCount; ++instance)
+            {
+                packet.command.firstInstance = instance;
+                mDrawList.Add(key, packet);
+            }
+        }
+        else
+        {
+            packet.command = DrawCommand{};
+            packet.command.indexCount = mMesh.GetIndexCount();
+            packet.command.instanceCount = instanceCount;
+            mDrawList.Add(key, packet);
+        }
+    }
+    mDrawList.Sort();
+}
+
+void Renderer::recordDraws(VkCommandBuffer cmd, size_t begin, size_t end, DrawList::BindState& state, DrawListStats& stats)
+{
+    if (begin == end)
+    {
+        return;
+    }
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(mSwapchainExtent.width);
+    viewport.height = static_cast<float>(mSwapchainExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = mSwapchainExtent;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+    // 정렬된 순서로 걸으면서 앞 드로우와 다른 것만 바인딩
+    mDrawList.Record(cmd, begin, end, state, stats);
+}
+
+uint32_t Renderer::getDrawSliceCount() const
+{
+    // 파이프라인 통계 쿼리는 세컨더리로 상속하려면 inheritedQueries가 필요해서 제외
+    // 재사용하는 프라이머리가 가리키는 세컨더리는 매 프레임 리셋되므로 인라인으로 기록
+    if (mJobSystem.GetThreadCount() <= 1 || (mConfig.gpuProfiling && mConfig.pipelineStatistics) || mConfig.reuseCommandBuffers)
+    {
+        return 0;
+    }
+    // 드로우를 나누기만 하고 쪼개지는 않음 - 인스턴스 드로우 하나는 인라인으로
+    size_t begin;
+    size_t end;
+    mDrawList.GetPassRange(DRAW_PASS_MAIN, begin, end);
+    uint32_t perJob = std::max(mConfig.drawsPerRecordJob, 1u);
+    uint32_t sliceCount = static_cast<uint32_t>((end - begin + perJob - 1) / perJob);
+    if (sliceCount <= 1)
+    {
+        return 0;
+    }
+    // 스레드보다 조금 많이 나눠야 훔쳐가면서 균형이 맞음
+    return std::min(sliceCount, mJobSystem.GetThreadCount() * 4);
+}
+
+void Renderer::recordDrawSlices(VkCommandBuffer primary, size_t begin, size_t end, uint32_t sliceCount)
+{
+    // 이 프레임 슬롯의 펜스는 이미 대기했으므로 스레드별 풀을 통째로 리셋
+    for (ThreadCommands& commands : mThreadCommands[mCurrentFrame])
+    {
+        VkResult result = vkResetCommandPool(mLogicalDevice, commands.pool, 0);
+        VkUtil::ExitIfFailed(result, "fail vkResetCommandPool (thread)");
+        commands.used = 0;
+    }
+
+    VkCommandBufferInheritanceRenderingInfo inheritanceRendering{};
+    inheritanceRendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    inheritanceRendering.colorAttachmentCount = 1;
+    inheritanceRendering.pColorAttachmentFormats = &mColorFormat;
+    inheritanceRendering.depthAttachmentFormat = mDepthFormat;
+    inheritanceRendering.stencilAttachmentFormat = mConfig.depthStencil ? mDepthFormat : VK_FORMAT_UNDEFINED;
+    inheritanceRendering.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.pNext = &inheritanceRendering;
+
+    // 세컨더리는 바인딩을 물려받지 않으므로 슬라이스마다 처음부터
+    size_t drawCount = end - begin;
+    mSecondaryBuffers.assign(sliceCount, VK_NULL_HANDLE);
+    mSliceDrawStats.assign(sliceCount, DrawListStats{});
+    JobFunction job = [&](uint32_t slice, uint32_t threadIndex)
+    {
+        VkCommandBuffer cmd = acquireSecondaryBuffer(threadIndex);
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritance;
+        VkResult result = vkBeginCommandBuffer(cmd, &beginInfo);
+        VkUtil::ExitIfFailed(result, "fail vkBeginCommandBuffer (secondary)");
+
+        DrawList::BindState state;
+        state.Reset();
+        size_t sliceBegin = begin + drawCount * slice / sliceCount;
+        size_t sliceEnd = begin + drawCount * (slice + 1) / sliceCount;
+        recordDraws(cmd, sliceBegin, sliceEnd, state, mSliceDrawStats[slice]);
+
+        result = vkEndCommandBuffer(cmd);
+        VkUtil::ExitIfFailed(result, "fail vkEndCommandBuffer (secondary)");
+        mSecondaryBuffers[slice] = cmd;
+    };
+
+    JobCounter counter;
+    mJobSystem.Dispatch(sliceCount, job, counter);
+    mJobSystem.Wait(counter);
+
+    for (const DrawListStats& stats : mSliceDrawStats)
+    {
+        DrawList::AddStats(mDrawStats, stats);
+    }
+
+    // 기록이 끝난 순서와 상관없이 슬라이스 순서대로 실행
+    vkCmdExecuteCommands(primary, sliceCount, mSecondaryBuffers.data());
+    // 세컨더리 실행 뒤 프라이머리의 바인딩은 정의되지 않음
+    mBindState.Reset();
+}
+
+VkCommandBuffer Renderer::acquireSecondaryBuffer(uint32_t threadIndex)
+{
+    // 자기 스레드의 풀만 건드리므로 잠금 없음
+    ThreadCommands& commands = mThreadCommands[mCurrentFrame][threadIndex];
+    if (commands.used == commands.buffers.size())
+    {
+        VkCommandBufferAllocateInfo allocCI{};
+        allocCI.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocCI.commandPool = commands.pool;
+        allocCI.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocCI.commandBufferCount = 1;
+
+        VkCommandBuffer buffer = VK_NULL_HANDLE;
+        VkResult result = vkAllocateCommandBuffers(mLogicalDevice, &allocCI, &buffer);
+        VkUtil::ExitIfFailed(result, "fail vkAllocateCommandBuffers (secondary)");
+        commands.buffers.push_back(buffer);
+    }
+    return commands.buffers[commands.used++];
+}
+
 void Renderer::cleanup()
 {
-    for (uint32_t i = 0; i < mFences.size(); i++)
+    vkDeviceWaitIdle(mLogicalDevice);
+
+    mGpuProfiler.Destroy();
+    // 장치가 idle이므로 남은 값과 상관없이 모두 파괴
+    mDeletionQueue.Flush();
+    mRenderGraph.Destroy();
+    // 캐시보다 먼저 - 컴파일 중인 스레드가 캐시를 쓰고 있을 수 있음
+    mPipelineCompiler.Destroy();
+    mPipelineCache.Destroy();
+    mShaderRegistry.Destroy();
+
+    vkDestroySemaphore(mLogicalDevice, mGraphicsTimeline, nullptr);
+    for (uint32_t i = 0; i < imageAvailableSemaphores.size(); i++)
     {
-        vkDestroyFence(mLogicalDevice, mFences[i], nullptr);
 		vkDestroySemaphore(mLogicalDevice, imageAvailableSemaphores[i], nullptr);
+    }
+    for (uint32_t i = 0; i < renderFinishedSemaphores.size(); i++)
+    {
 		vkDestroySemaphore(mLogicalDevice, renderFinishedSemaphores[i], nullptr);
     }
-	vkFreeCommandBuffers(mLogicalDevice, mCommandPool, static_cast<uint32_t>(mCommandBuffers.size()), mCommandBuffers.data());
-	vkDestroyCommandPool(mLogicalDevice, mCommandPool, nullptr);
-	vkDestroyPipeline(mLogicalDevice, mGraphicsPipeline, nullptr);
-    vkDestroyPipelineLayout(mLogicalDevice, mPipelineLayout, nullptr);
-    for (uint32_t i = 0; i < mFramebuffers.size(); ++i)
+    // 풀을 파괴하면 할당된 커맨드 버퍼도 같이 해제됨
+    for (uint32_t i = 0; i < mCommandPools.size(); i++)
     {
-        vkDestroyFramebuffer(mLogicalDevice, mFramebuffers[i], nullptr);
+        vkDestroyCommandPool(mLogicalDevice, mCommandPools[i], nullptr);
+    }
+    for (std::vector<ThreadCommands>& frameCommands : mThreadCommands)
+    {
+        for (ThreadCommands& commands : frameCommands)
+        {
+            vkDestroyCommandPool(mLogicalDevice, commands.pool, nullptr);
+        }
     }
-	vkDestroyRenderPass(mLogicalDevice, mRenderPass, nullptr);
+    mThreadCommands.clear();
+    if (mCachedCommandPool != VK_NULL_HANDLE)
+    {
+        vkDestroyCommandPool(mLogicalDevice, mCachedCommandPool, nullptr);
+    }
+    mCachedCommands.clear();
+    mJobSystem.Destroy();
     for (uint32_t i = 0; i < mImageViews.size(); ++i)
     {
         vkDestroyImageView(mLogicalDevice, mImageViews[i], nullptr);
 	}
-	vkDestroySwapchainKHR(mLogicalDevice, mSwapchain, nullptr);
+    if (mConfig.headless)
+    {
+        for (uint32_t i = 0; i < mImages.size(); ++i)
+        {
+            vkDestroyImage(mLogicalDevice, mImages[i], nullptr);
+            mMemoryAllocator.Free(mOffscreenAllocations[i]);
+        }
+    }
+    else
+    {
+        vkDestroySwapchainKHR(mLogicalDevice, mSwapchain, nullptr);
+    }
+    mMesh.Destroy(mLogicalDevice, mMemoryAllocator);
+    vkDestroySampler(mLogicalDevice, mDefaultSampler, nullptr);
+    vkDestroyImageView(mLogicalDevice, mDefaultTextureView, nullptr);
+    vkDestroyImage(mLogicalDevice, mDefaultTexture, nullptr);
+    mMemoryAllocator.Free(mDefaultTextureAllocation);
+    mFrameAllocator.Destroy();
+    mBindless.Destroy();
+    mCulling.Destroy();
+    mInstances.Destroy();
+    mPipelineLibrary.Destroy();
+    mUploadEngine.Destroy();
+    mMemoryAllocator.Destroy();
     vkDestroyDevice(mLogicalDevice, nullptr);
-    vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+    if (mConfig.headless == false)
+    {
+        vkDestroySurfaceKHR(mInstance, mSurface, nullptr);
+    }
 	VkUtil::DestroyDebugUtilsMessengerEXT(mInstance, mDebugMessenger, nullptr);
 	vkDestroyInstance(mInstance, nullptr);
-    glfwDestroyWindow(mWindow);
-    glfwTerminate();
+    if (mConfig.headless == false)
+    {
+        glfwDestroyWindow(mWindow);
+        glfwTerminate();
+    }
 }
 
@@ -5,6 +5,24 @@
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
 #include <vector>
+#include <chrono>
+#include <functional>
+#include "GpuProfiler.h"
+#include "MemoryAllocator.h"
+#include "PipelineCache.h"
+#include "PipelineCompiler.h"
+#include "PipelineLibrary.h"
+#include "ShaderRegistry.h"
+#include "UploadEngine.h"
+#include "Mesh.h"
+#include "InstanceBuffer.h"
+#include "GpuCulling.h"
+#include "BindlessHeap.h"
+#include "FrameAllocator.h"
+#include "JobSystem.h"
+#include "DeletionQueue.h"
+#include "RenderGraph.h"
+#include "DrawList.h"
 
 
 enum 
@@ -13,69 +31,327 @@ enum
 	HEIGHT = 600
 };
 
+struct RendererConfig
+{
+	// render into offscreen images without GLFW / swapchain (render farm, CI)
+	bool headless = false;
+	uint32_t width = WIDTH;
+	uint32_t height = HEIGHT;
+	uint32_t offscreenImageCount = 3;
+	uint32_t headlessFrameCount = 1000;
+	// CPU run-ahead bound, independent of the swapchain image count
+	uint32_t framesInFlight = 2;
+	// GPU timestamps around the main pass, pipeline statistics are opt-in
+	bool gpuProfiling = true;
+	bool pipelineStatistics = false;
+	// nullptr : in-memory cache only, interval 0 : save only at shutdown
+	const char* pipelineCachePath = "pipeline_cache.bin";
+	double pipelineCacheSaveIntervalSec = 0.0;
+	// background pipeline compile threads, draws are skipped until their pipeline is ready
+	uint32_t pipelineCompileThreads = 2;
+	const char* vertexShaderPath = "vert.spv";
+	const char* fragmentShaderPath = "frag.spv";
+	// missing : no GPU culling, objects are drawn with a plain instanced draw
+	const char* cullShaderPath = "cull.spv";
+	// GLSL sources the .spv files are rebuilt from at startup when older (ShaderRegistry::Build),
+	// nullptr : load the .spv as is
+	const char* vertexShaderSource = "shader.vert";
+	const char* fragmentShaderSource = "shader.frag";
+	const char* cullShaderSource = "cull.comp";
+	// FrameAllocator region per frame in flight, for per-frame and per-draw constants
+	VkDeviceSize frameConstantsSize = 1024 * 1024;
+	// staging ring for buffer / image uploads
+	VkDeviceSize uploadRingSize = 32 * 1024 * 1024;
+	// nullptr : built-in triangle
+	const char* meshPath = nullptr;
+	// threads recording secondary command buffers (main thread included), 0 / 1 : main thread only
+	uint32_t recordThreads = 0;
+	// main pass draws are split into slices of at least this many draws, one job each
+	uint32_t drawsPerRecordJob = 64;
+	// one direct draw per instance instead of one instanced / indirect draw for all of them, no
+	// GPU culling; gives recordThreads a draw list long enough to split (CPU recording benchmark)
+	bool perInstanceDraws = false;
+	// record each (frame in flight, image) command buffer once and resubmit it until
+	// something it recorded changes; draws are then recorded inline
+	bool reuseCommandBuffers = false;
+	// depth-only pass before the main pass, which then shades each visible pixel once
+	bool depthPrepass = false;
+	// depth format with a stencil aspect
+	bool depthStencil = false;
+};
+
+// std140 uniform in the FrameAllocator, layout shared with shader.vert
+struct FrameConstants
+{
+	// column-major
+	float viewProjection[16];
+};
+
+// graphics push constants, layout shared with shader.vert
+struct DrawConstants
+{
+	MeshDecode decode;
+	// 1 : instance index goes through the culling visible list
+	uint32_t culled;
+};
+// maxPushConstantsSize is only guaranteed to be 128
+static_assert(sizeof(DrawConstants) <= 128, "DrawConstants exceeds the guaranteed push constant size");
+
+// CPU time spent in each drawFrame() stage, in milliseconds
+struct FrameTimings
+{
+	// blocked on the graphics timeline (frame slot, then image)
+	double waitGpuMs;
+	double acquireMs;
+	double recordMs;
+	double submitMs;
+	double presentMs;
+	// frames submitted but not finished on the GPU when the frame started
+	uint64_t gpuFramesBehind;
+	// secondary command buffers the main pass was recorded into, 0 : recorded inline
+	uint32_t recordSlices;
+};
+
+struct CommandReuseStats
+{
+	// frames that resubmitted an earlier recording
+	uint64_t reusedFrames;
+	uint64_t recordedFrames;
+};
+
+struct StartupMetrics
+{
+	double pipelineCreationMs;
+	bool pipelineCacheWarm;
+	size_t pipelineCacheLoadedBytes;
+};
+
 class Renderer
 {
 
 public:
-	Renderer();
+	Renderer(const RendererConfig& config = RendererConfig());
 	void Run();
 
+	// for driving frames from outside (benchmark)
+	bool ShouldClose() const;
+	void RenderFrame();
+	void Shutdown();
+	const FrameTimings& GetLastFrameTimings() const;
+	const GpuProfiler& GetGpuProfiler() const;
+	const StartupMetrics& GetStartupMetrics() const;
+	std::vector<PipelineCompileStats> GetPipelineStats() const;
+	PipelineLibraryStats GetPipelineLibraryStats() const;
+	const CommandReuseStats& GetCommandReuseStats() const;
+	MemoryStats GetMemoryStats() const;
+	// of the last recorded frame
+	const RenderGraphStats& GetRenderGraphStats() const;
+	// binds issued and skipped over every recorded frame
+	const DrawListStats& GetDrawStats() const;
+	UploadEngine& GetUploadEngine();
+	// objects, frustum culled on the GPU and drawn indirectly
+	InstanceBuffer& GetInstances();
+	// textures, samplers and storage buffers referenced by slot from InstanceData
+	BindlessHeap& GetBindless();
+	// column-major, used by both the culling pass and the vertex shader
+	void SetViewProjection(const float viewProjection[16]);
+	// runs destroy once every frame submitted so far has finished on the GPU
+	void DeferDestroy(std::function<void()> destroy);
+
 private:
 
+	RendererConfig mConfig;
+
 	VkInstance mInstance;
 	GLFWwindow* mWindow;
 	VkDebugUtilsMessengerEXT mDebugMessenger;
 	VkSurfaceKHR mSurface;
 	VkPhysicalDevice mPhysicalDevice;
+	uint32_t mGraphicsFamilyIndex;
+	uint32_t mPresentFamilyIndex;
+	uint32_t mTransferFamilyIndex;
 	VkDevice mLogicalDevice;
 	VkQueue mGraphicsQueue;
 	VkQueue mPresentQueue;
+	VkQueue mTransferQueue;
+	MemoryAllocator mMemoryAllocator;
+	UploadEngine mUploadEngine;
 	VkSwapchainKHR mSwapchain;
 	VkExtent2D mSwapchainExtent;
+	VkFormat mColorFormat;
+	// transient render graph image, never stored past the frame
+	VkFormat mDepthFormat;
+	VkImageAspectFlags mDepthAspect;
 
 	std::vector<VkImage> mImages;
 	std::vector<VkImageView> mImageViews;
-	
-	VkRenderPass mRenderPass;
-	std::vector<VkFramebuffer> mFramebuffers;
+	std::vector<Allocation*> mOffscreenAllocations;
 
-	VkPipeline mGraphicsPipeline;
+	PipelineHandle mGraphicsPipeline;
+	// depthPrepass only : depth writes without a fragment shader, and the main pipeline testing EQUAL against it
+	PipelineHandle mDepthPrepassPipeline;
+	PipelineHandle mPrepassMainPipeline;
 	VkPipelineLayout mPipelineLayout;
+	PipelineCache mPipelineCache;
+	PipelineCompiler mPipelineCompiler;
+	PipelineLibrary mPipelineLibrary;
+	ShaderRegistry mShaderRegistry;
+	// until every requested pipeline has compiled
+	bool mShaderModulesAlive;
+	StartupMetrics mStartupMetrics;
+	Mesh mMesh;
+	InstanceBuffer mInstances;
+	GpuCulling mCulling;
+	BindlessHeap mBindless;
+	FrameAllocator mFrameAllocator;
+	// rebuilt every recorded frame, owns the transient attachments
+	RenderGraph mRenderGraph;
+	// top field of the draw keys, in execution order
+	enum DrawPass
+	{
+		DRAW_PASS_DEPTH_PREPASS,
+		DRAW_PASS_MAIN
+	};
+	// sorted draws of the frame being recorded, and what the primary command buffer has bound
+	DrawList mDrawList;
+	DrawList::BindState mBindState;
+	DrawListStats mDrawStats;
+	std::vector<DrawListStats> mSliceDrawStats;
+	// dynamic offset of this frame's FrameConstants
+	uint32_t mFrameConstantsOffset;
+	VkImage mDefaultTexture;
+	Allocation* mDefaultTextureAllocation;
+	VkImageView mDefaultTextureView;
+	VkSampler mDefaultSampler;
+	float mViewProjection[16];
+	// bumped by SetViewProjection()
+	uint64_t mViewVersion;
 	
-	VkCommandPool mCommandPool;
+	// one transient pool and primary buffer per frame in flight
+	std::vector<VkCommandPool> mCommandPools;
 	std::vector<VkCommandBuffer> mCommandBuffers;
+	JobSystem mJobSystem;
+	// secondary buffers, only touched by the owning thread
+	struct ThreadCommands
+	{
+		VkCommandPool pool;
+		std::vector<VkCommandBuffer> buffers;
+		uint32_t used;
+	};
+	// [frame in flight][thread]
+	std::vector<std::vector<ThreadCommands>> mThreadCommands;
+	// executed in slice order
+	std::vector<VkCommandBuffer> mSecondaryBuffers;
+
+	// what a recording depends on besides its frame slot and image
+	struct RecordState
+	{
+		VkPipeline pipeline;
+		VkPipeline prepassPipeline;
+		uint32_t instanceCount;
+		uint32_t meshCount;
+		uint32_t instanceGeneration;
+		uint32_t cullingGeneration;
+		uint64_t viewVersion;
+		uint32_t frameConstantsOffset;
+	};
+	struct CachedCommands
+	{
+		VkCommandBuffer buffer;
+		RecordState state;
+		// false : not recorded yet, outdated, or holding one-shot upload acquires
+		bool reusable;
+	};
+	VkCommandPool mCachedCommandPool;
+	// [frame in flight][image], a buffer is only submitted from its own frame slot
+	std::vector<std::vector<CachedCommands>> mCachedCommands;
+	CommandReuseStats mCommandReuseStats;
 	uint32_t mCurrentFrame;
+	uint32_t mNextOffscreenImage;
+	uint64_t mFrameNumber;
+	FrameTimings mLastFrameTimings;
+	GpuProfiler mGpuProfiler;
+	// semaphores the next graphics submit waits on besides image acquire, values are 0 for binary ones
+	std::vector<VkSemaphore> mFrameWaitSemaphores;
+	std::vector<VkPipelineStageFlags> mFrameWaitStages;
+	std::vector<uint64_t> mFrameWaitValues;
 
-	std::vector<VkFence> mFences;
-	std::vector<VkFence> mImagesInFlight;
+	// every graphics submit (culling included) signals the next value
+	VkSemaphore mGraphicsTimeline;
+	uint64_t mGraphicsTimelineValue;
+	// value of the last submit from each frame slot / to each image, 0 : none yet
+	std::vector<uint64_t> mFrameSlotValues;
+	std::vector<uint64_t> mImageTimelineValues;
+	// binary, presentation cannot use timeline semaphores
 	std::vector<VkSemaphore> imageAvailableSemaphores;
 	std::vector<VkSemaphore> renderFinishedSemaphores;
+	// old swapchains and anything passed to DeferDestroy()
+	DeletionQueue mDeletionQueue;
+	bool mFramebufferResized;
+	bool mSwapchainDirty;
 
 
 	void createWindow();
+	static void framebufferResizeCallback(GLFWwindow* window, int width, int height);
+	bool isMinimized() const;
 
 	void createInstance();
 	void createSurface();
 	void pickPhysicalDevice(uint32_t& outGraphicsFamilyIndex, uint32_t& outPresentFamilyIndex);
 	bool findQueueFamilies(VkPhysicalDevice device, uint32_t& outGraphicsFamilyIndex, uint32_t& outPresentFamilyIndex) const;
+	uint32_t findTransferQueueFamily(VkPhysicalDevice device, uint32_t graphicsFamilyIndex) const;
+	bool supportsRequiredFeatures(VkPhysicalDevice device) const;
+	uint32_t rateDevice(VkPhysicalDevice device) const;
 	void createLogicalDevice(const uint32_t graphicsFamilyIndex, const uint32_t presentFamilyIndex);
 	void createSwapchain(const uint32_t graphicsFamilyIndex, const uint32_t presentFamilyIndex);
+	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) const;
+	bool recreateSwapchain();
 	VkSurfaceFormatKHR pickBestFormat() const;
 	VkPresentModeKHR pickBestPresentMode() const;
 	void createImageViews(VkSurfaceFormatKHR format);
-	void createRenderPass();
-	void createFramebuffers();
+	void createOffscreenImages();
+	VkFormat pickOffscreenFormat() const;
+	VkFormat pickDepthFormat() const;
 	void createGraphicsPipeline();
-	VkShaderModule createShaderModule(const std::vector<char>& code) const;
-	void createCommandPool(const uint32_t graphicsFamilyIndex);
+	// rebuilds the .spv from sourcePath first when set, VK_NULL_HANDLE if that fails
+	VkShaderModule loadShader(const char* sourcePath, const char* spirvPath);
+	void onPipelinesCompiled();
+	void createMesh();
+	void createDefaultTexture();
+	void createCommandPools(const uint32_t graphicsFamilyIndex);
 	void createCommandBuffers();
 
 	// createPipeline
 	//  OpenGL CreateProgram  ٷ 
 
 	void createSyncObjects();
+	void createRenderFinishedSemaphores();
+	uint64_t getCompletedTimelineValue() const;
+	// waits for the current frame slot, records gpuFramesBehind and runs due deletions
+	void waitFrameSlot();
+	// the graphics timeline value this frame's submit signals
+	uint64_t nextFrameValue(uint32_t imageIndex);
 	void drawFrame();
+	void drawOffscreenFrame(std::chrono::steady_clock::time_point& t);
+	// per-frame uploads and constants, then records or picks the cached recording to submit
+	VkCommandBuffer buildFrameCommands(uint32_t imageIndex);
+	RecordState captureRecordState() const;
+	static bool isSameRecordState(const RecordState& a, const RecordState& b);
+	void invalidateCachedCommands();
 	void recordCommandBuffer(VkCommandBuffer currentBuffer, uint32_t imageIndex);
+	// false while the prepass pipelines are still compiling
+	bool useDepthPrepass() const;
+	// false without a cull pipeline or with perInstanceDraws
+	bool useGpuCulling() const;
+	void recordDepthPrepass(VkCommandBuffer currentBuffer, VkImageView depthView);
+	void recordMainPass(VkCommandBuffer currentBuffer, VkImageView colorView, VkImageView depthView, bool afterPrepass, uint32_t sliceCount);
+	// sliceCount > 0 : main pass draws split over that many secondary command buffers
+	void buildDrawList(bool prepass);
+	void recordDraws(VkCommandBuffer cmd, size_t begin, size_t end, DrawList::BindState& state, DrawListStats& stats);
+	// from the built draw list, 0 : record inline in the primary
+	uint32_t getDrawSliceCount() const;
+	void recordDrawSlices(VkCommandBuffer primary, size_t begin, size_t end, uint32_t sliceCount);
+	VkCommandBuffer acquireSecondaryBuffer(uint32_t threadIndex);
 
 
 	void mainLoop();
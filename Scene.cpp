@@ -0,0 +1,437 @@
+#include "Scene.h"
+#include "VkUtil.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SCENE_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    const float IDENTITY[12] = { 1.0f, 0.0f, 0.0f, 0.0f,  0.0f, 1.0f, 0.0f, 0.0f,  0.0f, 0.0f, 1.0f, 0.0f };
+
+    // lanes : position xyz, rotation xyzw, scale xyz, 4 nodes each
+    // out : 4 local transforms, 12 floats each
+#ifdef SCENE_SSE
+    void computeLocal4(const float* const lanes[10], float* out)
+    {
+        __m128 px = _mm_loadu_ps(lanes[0]);
+        __m128 py = _mm_loadu_ps(lanes[1]);
+        __m128 pz = _mm_loadu_ps(lanes[2]);
+        __m128 qx = _mm_loadu_ps(lanes[3]);
+        __m128 qy = _mm_loadu_ps(lanes[4]);
+        __m128 qz = _mm_loadu_ps(lanes[5]);
+        __m128 qw = _mm_loadu_ps(lanes[6]);
+        __m128 sx = _mm_loadu_ps(lanes[7]);
+        __m128 sy = _mm_loadu_ps(lanes[8]);
+        __m128 sz = _mm_loadu_ps(lanes[9]);
+
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 two = _mm_set1_ps(2.0f);
+        __m128 xx = _mm_mul_ps(qx, qx);
+        __m128 yy = _mm_mul_ps(qy, qy);
+        __m128 zz = _mm_mul_ps(qz, qz);
+        __m128 xy = _mm_mul_ps(qx, qy);
+        __m128 xz = _mm_mul_ps(qx, qz);
+        __m128 yz = _mm_mul_ps(qy, qz);
+        __m128 wx = _mm_mul_ps(qw, qx);
+        __m128 wy = _mm_mul_ps(qw, qy);
+        __m128 wz = _mm_mul_ps(qw, qz);
+
+        // 행 r, 열 c : 회전 * 스케일, 마지막 열은 위치
+        __m128 m[12];
+        m[0] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx);
+        m[1] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy);
+        m[2] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz);
+        m[3] = px;
+        m[4] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx);
+        m[5] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy);
+        m[6] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz);
+        m[7] = py;
+        m[8] = _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx);
+        m[9] = _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy);
+        m[10] = _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz);
+        m[11] = pz;
+
+        // 노드별 성분을 노드별 행으로 전치
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            __m128 c0 = m[row * 4 + 0];
+            __m128 c1 = m[row * 4 + 1];
+            __m128 c2 = m[row * 4 + 2];
+            __m128 c3 = m[row * 4 + 3];
+            _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+            _mm_storeu_ps(out + 0 * 12 + row * 4, c0);
+            _mm_storeu_ps(out + 1 * 12 + row * 4, c1);
+            _mm_storeu_ps(out + 2 * 12 + row * 4, c2);
+            _mm_storeu_ps(out + 3 * 12 + row * 4, c3);
+        }
+    }
+
+    // out = parent * local, both affine with an implicit (0, 0, 0, 1) last row
+    void multiplyAffine(const float* parent, const float* local, float* out)
+    {
+        __m128 l0 = _mm_loadu_ps(local + 0);
+        __m128 l1 = _mm_loadu_ps(local + 4);
+        __m128 l2 = _mm_loadu_ps(local + 8);
+        __m128 translationMask = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            __m128 p = _mm_loadu_ps(parent + row * 4);
+            __m128 result = _mm_and_ps(p, translationMask);
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(0, 0, 0, 0)), l0));
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1)), l1));
+            result = _mm_add_ps(result, _mm_mul_ps(_mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2)), l2));
+            _mm_storeu_ps(out + row * 4, result);
+        }
+    }
+#else
+    void computeLocal4(const float* const lanes[10], float* out)
+    {
+        for (uint32_t i = 0; i < Scene::SIMD_WIDTH; ++i)
+        {
+            float x = lanes[3][i];
+            float y = lanes[4][i];
+            float z = lanes[5][i];
+            float w = lanes[6][i];
+            float sx = lanes[7][i];
+            float sy = lanes[8][i];
+            float sz = lanes[9][i];
+            float* m = out + i * 12;
+            m[0] = (1.0f - 2.0f * (y * y + z * z)) * sx;
+            m[1] = 2.0f * (x * y - w * z) * sy;
+            m[2] = 2.0f * (x * z + w * y) * sz;
+            m[3] = lanes[0][i];
+            m[4] = 2.0f * (x * y + w * z) * sx;
+            m[5] = (1.0f - 2.0f * (x * x + z * z)) * sy;
+            m[6] = 2.0f * (y * z - w * x) * sz;
+            m[7] = lanes[1][i];
+            m[8] = 2.0f * (x * z - w * y) * sx;
+            m[9] = 2.0f * (y * z + w * x) * sy;
+            m[10] = (1.0f - 2.0f * (x * x + y * y)) * sz;
+            m[11] = lanes[2][i];
+        }
+    }
+
+    void multiplyAffine(const float* parent, const float* local, float* out)
+    {
+        for (uint32_t row = 0; row < 3; ++row)
+        {
+            const float* p = parent + row * 4;
+            for (uint32_t column = 0; column < 4; ++column)
+            {
+                out[row * 4 + column] = p[0] * local[column] + p[1] * local[4 + column] + p[2] * local[8 + column]
+                    + (column == 3 ? p[3] : 0.0f);
+            }
+        }
+    }
+#endif
+}
+
+Scene::Scene()
+    :mDirtyCount(0)
+    ,mOrderStale(false)
+    ,mStats()
+{
+}
+
+SceneNode Scene::AddNode(SceneNode parent, InstanceHandle instance)
+{
+    uint32_t index = static_cast<uint32_t>(mParents.size());
+    uint32_t parentIndex = UINT32_MAX;
+    if (parent != INVALID_SCENE_NODE)
+    {
+        parentIndex = indexOf(parent);
+    }
+
+    const float defaults[CHANNEL_COUNT] = { 0.0f, 0.0f, 0.0f,  0.0f, 0.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f };
+    for (uint32_t c = 0; c < CHANNEL_COUNT; ++c)
+    {
+        mChannels[c].push_back(defaults[c]);
+    }
+    mParents.push_back(parentIndex);
+    mSubtreeSizes.push_back(1);
+    mWorld.insert(mWorld.end(), IDENTITY, IDENTITY + 12);
+    mDirty.push_back(0);
+    mInstances.push_back(instance);
+
+    SceneNode node = static_cast<SceneNode>(mHandleToIndex.size());
+    mIndexToHandle.push_back(node);
+    mHandleToIndex.push_back(index);
+    markDirty(index);
+
+    // 루트는 맨 뒤에 붙여도 깊이 우선 순서가 유지됨
+    if (parentIndex != UINT32_MAX)
+    {
+        mOrderStale = true;
+    }
+    return node;
+}
+
+void Scene::Clear()
+{
+    for (uint32_t c = 0; c < CHANNEL_COUNT; ++c)
+    {
+        mChannels[c].clear();
+    }
+    mParents.clear();
+    mSubtreeSizes.clear();
+    mWorld.clear();
+    mDirty.clear();
+    mInstances.clear();
+    mIndexToHandle.clear();
+    mHandleToIndex.clear();
+    mDirtyCount = 0;
+    mOrderStale = false;
+}
+
+void Scene::SetPosition(SceneNode node, float x, float y, float z)
+{
+    setChannels(node, POSITION_X, x, y, z);
+}
+
+void Scene::SetRotation(SceneNode node, float x, float y, float z, float w)
+{
+    setChannels(node, ROTATION_X, x, y, z);
+    mChannels[ROTATION_W][indexOf(node)] = w;
+}
+
+void Scene::SetScale(SceneNode node, float x, float y, float z)
+{
+    setChannels(node, SCALE_X, x, y, z);
+}
+
+SceneNode Scene::GetParent(SceneNode node) const
+{
+    uint32_t parentIndex = mParents[indexOf(node)];
+    return parentIndex != UINT32_MAX ? mIndexToHandle[parentIndex] : INVALID_SCENE_NODE;
+}
+
+uint32_t Scene::GetCount() const
+{
+    return static_cast<uint32_t>(mParents.size());
+}
+
+const float* Scene::GetWorldTransform(SceneNode node) const
+{
+    return mWorld.data() + static_cast<size_t>(indexOf(node)) * 12;
+}
+
+void Scene::Update(InstanceBuffer& instances)
+{
+    mStats = {};
+    mStats.nodeCount = GetCount();
+    if (mOrderStale)
+    {
+        rebuildOrder();
+    }
+    if (mDirtyCount == 0)
+    {
+        return;
+    }
+
+    // 더러운 노드를 찾으면 그 서브트리 구간을 통째로 갱신하고 건너뜀
+    // 바로 뒤에 이어지는 더러운 서브트리는 한 구간으로 합쳐 4개씩 묶음이 끊기지 않게 함
+    const uint8_t* dirty = mDirty.data();
+    uint32_t count = GetCount();
+    uint32_t index = 0;
+    while (index < count)
+    {
+        const void* found = memchr(dirty + index, 1, count - index);
+        if (found == nullptr)
+        {
+            break;
+        }
+        index = static_cast<uint32_t>(static_cast<const uint8_t*>(found) - dirty);
+        uint32_t end = index + mSubtreeSizes[index];
+        while (end < count && dirty[end] != 0)
+        {
+            end += mSubtreeSizes[end];
+        }
+        updateRange(index, end, instances);
+        ++mStats.dirtySubtrees;
+        index = end;
+    }
+    mDirtyCount = 0;
+}
+
+const SceneStats& Scene::GetStats() const
+{
+    return mStats;
+}
+
+uint32_t Scene::indexOf(SceneNode node) const
+{
+    VkUtil::ExitIfFalse(node < mHandleToIndex.size(), "invalid scene node");
+    return mHandleToIndex[node];
+}
+
+void Scene::setChannels(SceneNode node, Channel first, float x, float y, float z)
+{
+    uint32_t index = indexOf(node);
+    mChannels[first][index] = x;
+    mChannels[first + 1][index] = y;
+    mChannels[first + 2][index] = z;
+    markDirty(index);
+}
+
+void Scene::markDirty(uint32_t index)
+{
+    if (mDirty[index] == 0)
+    {
+        mDirty[index] = 1;
+        ++mDirtyCount;
+    }
+}
+
+void Scene::rebuildOrder()
+{
+    uint32_t count = GetCount();
+
+    // 자식 목록 (추가된 순서 유지)
+    std::vector<uint32_t> childBegin(count + 1, 0);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (mParents[i] != UINT32_MAX)
+        {
+            ++childBegin[mParents[i] + 1];
+        }
+    }
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        childBegin[i + 1] += childBegin[i];
+    }
+    std::vector<uint32_t> children(childBegin[count]);
+    std::vector<uint32_t> childFill(childBegin.begin(), childBegin.end() - 1);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (mParents[i] != UINT32_MAX)
+        {
+            children[childFill[mParents[i]]++] = i;
+        }
+    }
+
+    // 깊이 우선 순서, 형제는 뒤에서부터 쌓아서 앞의 것이 먼저 나옴
+    std::vector<uint32_t> order;
+    order.reserve(count);
+    std::vector<uint32_t> stack;
+    for (uint32_t root = 0; root < count; ++root)
+    {
+        if (mParents[root] != UINT32_MAX)
+        {
+            continue;
+        }
+        stack.push_back(root);
+        while (stack.empty() == false)
+        {
+            uint32_t node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+            for (uint32_t c = childBegin[node + 1]; c > childBegin[node]; --c)
+            {
+                stack.push_back(children[c - 1]);
+            }
+        }
+    }
+    VkUtil::ExitIfFalse(order.size() == count, "scene hierarchy has a cycle");
+
+    std::vector<uint32_t> newIndex(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        newIndex[order[i]] = i;
+    }
+
+    std::vector<float> floats(count);
+    for (uint32_t c = 0; c < CHANNEL_COUNT; ++c)
+    {
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            floats[i] = mChannels[c][order[i]];
+        }
+        mChannels[c].swap(floats);
+    }
+    std::vector<float> world(mWorld.size());
+    std::vector<uint32_t> parents(count);
+    std::vector<uint8_t> dirty(count);
+    std::vector<InstanceHandle> instances(count);
+    std::vector<SceneNode> indexToHandle(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        uint32_t old = order[i];
+        memcpy(world.data() + static_cast<size_t>(i) * 12, mWorld.data() + static_cast<size_t>(old) * 12, sizeof(float) * 12);
+        parents[i] = mParents[old] != UINT32_MAX ? newIndex[mParents[old]] : UINT32_MAX;
+        dirty[i] = mDirty[old];
+        instances[i] = mInstances[old];
+        indexToHandle[i] = mIndexToHandle[old];
+        mHandleToIndex[indexToHandle[i]] = i;
+    }
+    mWorld.swap(world);
+    mParents.swap(parents);
+    mDirty.swap(dirty);
+    mInstances.swap(instances);
+    mIndexToHandle.swap(indexToHandle);
+
+    // 자식이 부모보다 뒤에 있으므로 뒤에서부터 더하면 서브트리 크기
+    std::fill(mSubtreeSizes.begin(), mSubtreeSizes.end(), 1);
+    for (uint32_t i = count; i-- > 0;)
+    {
+        if (mParents[i] != UINT32_MAX)
+        {
+            mSubtreeSizes[mParents[i]] += mSubtreeSizes[i];
+        }
+    }
+    mOrderStale = false;
+}
+
+void Scene::updateRange(uint32_t begin, uint32_t end, InstanceBuffer& instances)
+{
+    float local[SIMD_WIDTH * 12];
+    // 마지막 묶음의 빈 자리는 단위 변환으로 채움
+    float tail[CHANNEL_COUNT][SIMD_WIDTH];
+    const float* lanes[CHANNEL_COUNT];
+
+    for (uint32_t first = begin; first < end; first += SIMD_WIDTH)
+    {
+        uint32_t width = std::min<uint32_t>(SIMD_WIDTH, end - first);
+        for (uint32_t c = 0; c < CHANNEL_COUNT; ++c)
+        {
+            if (width == SIMD_WIDTH)
+            {
+                lanes[c] = mChannels[c].data() + first;
+                continue;
+            }
+            float fill = (c == ROTATION_W || c >= SCALE_X) ? 1.0f : 0.0f;
+            for (uint32_t i = 0; i < SIMD_WIDTH; ++i)
+            {
+                tail[c][i] = i < width ? mChannels[c][first + i] : fill;
+            }
+            lanes[c] = tail[c];
+        }
+        computeLocal4(lanes, local);
+
+        // 부모가 같은 묶음에 있어도 앞에 있으므로 먼저 계산됨
+        for (uint32_t i = 0; i < width; ++i)
+        {
+            uint32_t index = first + i;
+            float* world = mWorld.data() + static_cast<size_t>(index) * 12;
+            uint32_t parent = mParents[index];
+            if (parent == UINT32_MAX)
+            {
+                memcpy(world, local + i * 12, sizeof(float) * 12);
+            }
+            else
+            {
+                multiplyAffine(mWorld.data() + static_cast<size_t>(parent) * 12, local + i * 12, world);
+            }
+            mDirty[index] = 0;
+            if (mInstances[index] != INVALID_INSTANCE)
+            {
+                instances.UpdateTransform(mInstances[index], world);
+                ++mStats.instanceWrites;
+            }
+        }
+        mStats.worldUpdates += width;
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "InstanceBuffer.h"
+
+typedef uint32_t SceneNode;
+const SceneNode INVALID_SCENE_NODE = UINT32_MAX;
+
+struct SceneStats
+{
+	uint32_t nodeCount;
+	// contiguous ranges walked, adjacent dirty subtrees are merged into one and nested
+	// dirty nodes are not counted
+	uint32_t dirtySubtrees;
+	uint32_t worldUpdates;
+	uint32_t instanceWrites;
+};
+
+// Transform hierarchy kept as structure of arrays (one array per position, rotation and
+// scale component, plus parent index and world matrix arrays). Nodes are stored in depth
+// first order, so parents come before their children and every subtree is a contiguous
+// range. Update() walks the dirty flags once and recomputes only the ranges under dirty
+// nodes (adjacent ranges merged), four local transforms at a time with SSE, and writes
+// the world transform of nodes with an instance into the InstanceBuffer.
+class Scene
+{
+public:
+	enum
+	{
+		SIMD_WIDTH = 4
+	};
+
+	Scene();
+
+	// parent must already exist, INVALID_SCENE_NODE for a root; instance may be INVALID_INSTANCE
+	SceneNode AddNode(SceneNode parent, InstanceHandle instance);
+	void Clear();
+
+	void SetPosition(SceneNode node, float x, float y, float z);
+	// unit quaternion
+	void SetRotation(SceneNode node, float x, float y, float z, float w);
+	void SetScale(SceneNode node, float x, float y, float z);
+
+	SceneNode GetParent(SceneNode node) const;
+	uint32_t GetCount() const;
+	// rows of a 3x4 affine transform, valid after Update()
+	const float* GetWorldTransform(SceneNode node) const;
+
+	void Update(InstanceBuffer& instances);
+	const SceneStats& GetStats() const;
+
+private:
+	enum Channel
+	{
+		POSITION_X,
+		POSITION_Y,
+		POSITION_Z,
+		ROTATION_X,
+		ROTATION_Y,
+		ROTATION_Z,
+		ROTATION_W,
+		SCALE_X,
+		SCALE_Y,
+		SCALE_Z,
+		CHANNEL_COUNT
+	};
+
+	// indexed by position in depth first order, except mHandleToIndex
+	std::vector<float> mChannels[CHANNEL_COUNT];
+	std::vector<uint32_t> mParents;
+	std::vector<uint32_t> mSubtreeSizes;
+	// 12 floats per node
+	std::vector<float> mWorld;
+	std::vector<uint8_t> mDirty;
+	std::vector<InstanceHandle> mInstances;
+	std::vector<SceneNode> mIndexToHandle;
+	std::vector<uint32_t> mHandleToIndex;
+
+	uint32_t mDirtyCount;
+	// nodes were added since the last Update(), the depth first order must be rebuilt
+	bool mOrderStale;
+	SceneStats mStats;
+
+	uint32_t indexOf(SceneNode node) const;
+	void setChannels(SceneNode node, Channel first, float x, float y, float z);
+	void markDirty(uint32_t index);
+	void rebuildOrder();
+	void updateRange(uint32_t begin, uint32_t end, InstanceBuffer& instances);
+};
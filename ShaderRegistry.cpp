@@ -0,0 +1,231 @@
+#include "ShaderRegistry.h"
+#include "Logger.h"
+#include "MappedFile.h"
+#include "VkUtil.h"
+#include <cstdlib>
+#include <filesystem>
+
+ShaderRegistry::ShaderRegistry()
+	:mDevice(VK_NULL_HANDLE)
+{
+}
+
+void ShaderRegistry::Create(VkDevice device)
+{
+    mDevice = device;
+}
+
+void ShaderRegistry::Destroy()
+{
+    DestroyModules();
+    mDevice = VK_NULL_HANDLE;
+}
+
+bool ShaderRegistry::Build(const char* sourcePath, const char* spirvPath)
+{
+    std::error_code ec;
+    if (std::filesystem::exists(sourcePath, ec) == false)
+    {
+        // 소스 없이 .spv만 배포한 경우
+        return std::filesystem::exists(spirvPath, ec);
+    }
+    if (std::filesystem::exists(spirvPath, ec))
+    {
+        std::filesystem::file_time_type spirvTime = std::filesystem::last_write_time(spirvPath, ec);
+        std::filesystem::file_time_type sourceTime = std::filesystem::last_write_time(sourcePath, ec);
+        if (!ec && spirvTime >= sourceTime)
+        {
+            return true;
+        }
+    }
+
+    LOG_INFO("Compiling shader {} -> {}", sourcePath, spirvPath);
+    std::string quotedSource = std::string("\"") + sourcePath + "\"";
+    std::string quotedSpirv = std::string("\"") + spirvPath + "\"";
+    if (runTool(findTool("GLSLC", "glslc"), "--target-env=vulkan1.3 -O " + quotedSource + " -o " + quotedSpirv) == false)
+    {
+        LOG_ERROR("glslc failed or was not found for {} (install the Vulkan SDK or set GLSLC)", sourcePath);
+        return false;
+    }
+    // 검증 안 된 바이너리는 남기지 않음
+    if (runTool(findTool("SPIRV_VAL", "spirv-val"), "--target-env vulkan1.3 " + quotedSpirv) == false)
+    {
+        LOG_ERROR("spirv-val rejected {} or was not found (install SPIRV-Tools or set SPIRV_VAL)", spirvPath);
+        std::filesystem::remove(spirvPath, ec);
+        return false;
+    }
+    return true;
+}
+
+VkShaderModule ShaderRegistry::Load(const char* path)
+{
+    auto found = mPathToModule.find(path);
+    if (found != mPathToModule.end())
+    {
+        return found->second;
+    }
+
+    MappedFile file;
+    if (file.Open(path) == false)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    // 매핑은 페이지 정렬이므로 uint32_t로 바로 넘겨도 안전
+    if (isValidSpirv(file.GetData(), file.GetSize()) == false)
+    {
+        LOG_ERROR("Invalid SPIR-V: {}", path);
+        return VK_NULL_HANDLE;
+    }
+
+    const uint32_t* code = static_cast<const uint32_t*>(file.GetData());
+    uint64_t hash = hashWords(code, file.GetSize() / sizeof(uint32_t));
+    VkShaderModule module = createModule(code, file.GetSize(), hash);
+    mPathToModule[path] = module;
+    return module;
+}
+
+VkShaderModule ShaderRegistry::CreateFromMemory(const uint32_t* code, size_t codeSize)
+{
+    if (isValidSpirv(code, codeSize) == false)
+    {
+        return VK_NULL_HANDLE;
+    }
+    return createModule(code, codeSize, hashWords(code, codeSize / sizeof(uint32_t)));
+}
+
+void ShaderRegistry::DestroyModules()
+{
+    for (auto& entry : mModules)
+    {
+        for (const Module& module : entry.second)
+        {
+            vkDestroyShaderModule(mDevice, module.module, nullptr);
+        }
+    }
+    mModules.clear();
+    mModuleHashes.clear();
+    mPathToModule.clear();
+}
+
+size_t ShaderRegistry::GetModuleCount() const
+{
+    return mModuleHashes.size();
+}
+
+void ShaderRegistry::GetHash(VkShaderModule module, uint64_t& outHash, uint64_t& outCheckHash) const
+{
+    auto found = mModuleHashes.find(module);
+    VkUtil::ExitIfFalse(found != mModuleHashes.end(), "shader module not created by the ShaderRegistry");
+    outHash = found->second.hash;
+    outCheckHash = found->second.checkHash;
+}
+
+VkShaderModule ShaderRegistry::createModule(const uint32_t* code, size_t codeSize, uint64_t hash)
+{
+    // 크기와 두 번째 해시까지 같아야 같은 코드로 봄
+    uint64_t checkHash = checkHashWords(code, codeSize / sizeof(uint32_t));
+    std::vector<Module>& chain = mModules[hash];
+    for (const Module& entry : chain)
+    {
+        if (entry.codeSize == codeSize && entry.checkHash == checkHash)
+        {
+            return entry.module;
+        }
+    }
+
+    // 해시만 같은 다른 코드면 새 모듈을 만들어 체인에 추가
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = codeSize;
+    createInfo.pCode = code;
+
+    VkShaderModule module;
+    VkResult result = vkCreateShaderModule(mDevice, &createInfo, nullptr, &module);
+	VkUtil::ExitIfFailed(result, "fail vkCreateShaderModule");
+
+    chain.push_back({ module, codeSize, checkHash });
+    mModuleHashes[module] = { hash, checkHash };
+    return module;
+}
+
+bool ShaderRegistry::isValidSpirv(const void* code, size_t codeSize)
+{
+    const uint32_t kSpirvMagic = 0x07230203;
+    const size_t kHeaderWords = 5;
+
+    if (code == nullptr || codeSize % sizeof(uint32_t) != 0 || codeSize < kHeaderWords * sizeof(uint32_t))
+    {
+        return false;
+    }
+    if (reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) != 0)
+    {
+        return false;
+    }
+    return static_cast<const uint32_t*>(code)[0] == kSpirvMagic;
+}
+
+std::string ShaderRegistry::findTool(const char* environmentVariable, const char* name)
+{
+    const char* path = std::getenv(environmentVariable);
+    if (path != nullptr && path[0] != '\0')
+    {
+        return path;
+    }
+    const char* sdk = std::getenv("VULKAN_SDK");
+    if (sdk != nullptr && sdk[0] != '\0')
+    {
+#ifdef _WIN32
+        std::string sdkTool = std::string(sdk) + "\\Bin\\" + name + ".exe";
+#else
+        std::string sdkTool = std::string(sdk) + "/bin/" + name;
+#endif
+        std::error_code ec;
+        if (std::filesystem::exists(sdkTool, ec))
+        {
+            return sdkTool;
+        }
+    }
+    // PATH에서 찾음
+    return name;
+}
+
+bool ShaderRegistry::runTool(const std::string& tool, const std::string& arguments)
+{
+    std::string command = "\"" + tool + "\" " + arguments;
+#ifdef _WIN32
+    // cmd /c는 맨 앞뒤 따옴표를 벗기므로 전체를 한 번 더 감쌈
+    command = "\"" + command + "\"";
+#endif
+    return std::system(command.c_str()) == 0;
+}
+
+uint64_t ShaderRegistry::hashWords(const uint32_t* code, size_t wordCount)
+{
+    // FNV-1a 64, 길이도 섞음
+    uint64_t hash = 14695981039346656037ull;
+    hash ^= wordCount;
+    hash *= 1099511628211ull;
+    for (size_t i = 0; i < wordCount; ++i)
+    {
+        hash ^= code[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t ShaderRegistry::checkHashWords(const uint32_t* code, size_t wordCount)
+{
+    // FNV와 독립적인 곱셈-회전 섞기, 위치도 섞음
+    uint64_t hash = 0x9E3779B97F4A7C15ull ^ wordCount;
+    for (size_t i = 0; i < wordCount; ++i)
+    {
+        hash ^= (static_cast<uint64_t>(code[i]) << 32) | static_cast<uint64_t>(i);
+        hash *= 0xFF51AFD7ED558CCDull;
+        hash = (hash << 31) | (hash >> 33);
+    }
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
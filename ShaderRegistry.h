@@ -0,0 +1,61 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+// SPIR-V loaded through a file mapping (no intermediate copy),
+// VkShaderModules shared by content hash
+class ShaderRegistry
+{
+public:
+	ShaderRegistry();
+
+	void Create(VkDevice device);
+	void Destroy();
+
+	// Compiles sourcePath into spirvPath with glslc when the .spv is missing or older than the
+	// source, then validates it with spirv-val (tools from $GLSLC / $SPIRV_VAL, $VULKAN_SDK or
+	// PATH). A .spv that fails validation is deleted. Without the source the .spv is used as is.
+	// false if there is no up to date, validated .spv afterwards
+	static bool Build(const char* sourcePath, const char* spirvPath);
+	// VK_NULL_HANDLE if the file is missing or not valid SPIR-V
+	VkShaderModule Load(const char* path);
+	VkShaderModule CreateFromMemory(const uint32_t* code, size_t codeSize);
+
+	// once pipelines are built the modules are no longer needed
+	void DestroyModules();
+
+	size_t GetModuleCount() const;
+	// content hashes of a module created here, stay valid for the same code after
+	// DestroyModules() while the handle value may be reused
+	void GetHash(VkShaderModule module, uint64_t& outHash, uint64_t& outCheckHash) const;
+
+private:
+	VkDevice mDevice;
+
+	struct Module
+	{
+		VkShaderModule module;
+		size_t codeSize;
+		// second, independent hash, the map key alone can collide
+		uint64_t checkHash;
+	};
+	struct ModuleHash
+	{
+		uint64_t hash;
+		uint64_t checkHash;
+	};
+	// different code with the same 64-bit hash gets its own module in the chain
+	std::unordered_map<uint64_t, std::vector<Module>> mModules;
+	std::unordered_map<VkShaderModule, ModuleHash> mModuleHashes;
+	std::unordered_map<std::string, VkShaderModule> mPathToModule;
+
+	VkShaderModule createModule(const uint32_t* code, size_t codeSize, uint64_t hash);
+
+	static bool isValidSpirv(const void* code, size_t codeSize);
+	static std::string findTool(const char* environmentVariable, const char* name);
+	static bool runTool(const std::string& tool, const std::string& arguments);
+	static uint64_t hashWords(const uint32_t* code, size_t wordCount);
+	static uint64_t checkHashWords(const uint32_t* code, size_t wordCount);
+};
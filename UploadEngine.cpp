@@ -0,0 +1,498 @@
+#include "UploadEngine.h"
+#include "VkUtil.h"
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+    // 업로드된 리소스를 처음 사용할 수 있는 단계들
+    const VkPipelineStageFlags kConsumerStages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
+        | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    const VkAccessFlags kConsumerAccess = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_INDEX_READ_BIT
+        | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+UploadEngine::UploadEngine()
+	:mDevice(VK_NULL_HANDLE)
+	,mAllocator(nullptr)
+	,mQueue(VK_NULL_HANDLE)
+	,mTransferFamilyIndex(0)
+	,mGraphicsFamilyIndex(0)
+	,mTimeline(VK_NULL_HANDLE)
+	,mSubmittedValue(0)
+	,mRingBuffer(VK_NULL_HANDLE)
+	,mRingAllocation(nullptr)
+	,mRingData(nullptr)
+	,mRingSize(0)
+	,mRingHead(0)
+	,mRingTail(0)
+	,mBatches()
+	,mNextBatch(0)
+	,mOldestBatch(0)
+	,mInFlightCount(0)
+	,mStats()
+{
+}
+
+void UploadEngine::Create(VkDevice device, MemoryAllocator& allocator, VkQueue transferQueue, uint32_t transferFamilyIndex,
+    uint32_t graphicsFamilyIndex, VkDeviceSize ringSize)
+{
+    mDevice = device;
+    mAllocator = &allocator;
+    mQueue = transferQueue;
+    mTransferFamilyIndex = transferFamilyIndex;
+    mGraphicsFamilyIndex = graphicsFamilyIndex;
+    mRingSize = alignUp(ringSize, RING_ALIGNMENT);
+    // 배치마다 펜스/세마포어를 두지 않고 값 하나로 완료 여부를 봄
+    mTimeline = VkUtil::CreateTimelineSemaphore(mDevice, 0);
+    mSubmittedValue = 0;
+
+    VkBufferCreateInfo bufferCI{};
+    bufferCI.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferCI.size = mRingSize;
+    bufferCI.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferCI.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VkResult result = vkCreateBuffer(mDevice, &bufferCI, nullptr, &mRingBuffer);
+    VkUtil::ExitIfFailed(result, "fail vkCreateBuffer (staging ring)");
+
+    // coherent이므로 memcpy 후 flush가 필요 없음, 매핑은 Destroy까지 유지
+    mRingAllocation = mAllocator->AllocateForBuffer(mRingBuffer, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 0);
+    mRingData = static_cast<uint8_t*>(mRingAllocation->mapped);
+    VkUtil::ExitIfFalse(mRingData != nullptr, "staging ring is not mapped");
+
+    for (Batch& batch : mBatches)
+    {
+        VkCommandPoolCreateInfo poolCI{};
+        poolCI.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolCI.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolCI.queueFamilyIndex = mTransferFamilyIndex;
+        result = vkCreateCommandPool(mDevice, &poolCI, nullptr, &batch.pool);
+        VkUtil::ExitIfFailed(result, "fail vkCreateCommandPool (upload)");
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = batch.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        result = vkAllocateCommandBuffers(mDevice, &allocInfo, &batch.cmd);
+        VkUtil::ExitIfFailed(result, "fail vkAllocateCommandBuffers (upload)");
+
+        batch.timelineValue = 0;
+        batch.submitted = false;
+        batch.consumed = true;
+        batch.ringEnd = 0;
+    }
+}
+
+void UploadEngine::Destroy()
+{
+    if (mDevice == VK_NULL_HANDLE)
+    {
+        return;
+    }
+    WaitIdle();
+    for (Batch& batch : mBatches)
+    {
+        vkDestroyCommandPool(mDevice, batch.pool, nullptr);
+    }
+    vkDestroySemaphore(mDevice, mTimeline, nullptr);
+    mTimeline = VK_NULL_HANDLE;
+    vkDestroyBuffer(mDevice, mRingBuffer, nullptr);
+    mAllocator->Free(mRingAllocation);
+    mRingAllocation = nullptr;
+    mDevice = VK_NULL_HANDLE;
+}
+
+void UploadEngine::UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size)
+{
+    // 링보다 큰 데이터(대형 메시 등)는 링 절반 크기로 나눠서 올림
+    VkDeviceSize maxChunk = mRingSize / 2;
+    while (size > maxChunk)
+    {
+        UploadBuffer(dst, dstOffset, data, maxChunk);
+        data = static_cast<const uint8_t*>(data) + maxChunk;
+        dstOffset += maxChunk;
+        size -= maxChunk;
+    }
+
+    VkDeviceSize srcOffset = allocateRing(size);
+    memcpy(mRingData + srcOffset, data, static_cast<size_t>(size));
+
+    BufferCopies* copies = nullptr;
+    for (BufferCopies& pending : mPendingBuffers)
+    {
+        if (pending.buffer == dst)
+        {
+            copies = &pending;
+            break;
+        }
+    }
+    if (copies == nullptr)
+    {
+        mPendingBuffers.push_back({ dst, {} });
+        copies = &mPendingBuffers.back();
+    }
+
+    // 앞 복사와 이어지면 region 하나로 합침
+    if (copies->regions.empty() == false)
+    {
+        VkBufferCopy& last = copies->regions.back();
+        if (last.srcOffset + last.size == srcOffset && last.dstOffset + last.size == dstOffset)
+        {
+            last.size += size;
+            mStats.bytes += size;
+            return;
+        }
+    }
+    copies->regions.push_back({ srcOffset, dstOffset, size });
+    mStats.bytes += size;
+    ++mStats.copies;
+}
+
+void UploadEngine::UploadImage(VkImage dst, VkExtent3D extent, VkImageAspectFlags aspect, const void* data, VkDeviceSize size, VkImageLayout finalLayout)
+{
+    VkDeviceSize srcOffset = allocateRing(size);
+    memcpy(mRingData + srcOffset, data, static_cast<size_t>(size));
+
+    ImageCopy copy{};
+    copy.image = dst;
+    copy.aspect = aspect;
+    copy.finalLayout = finalLayout;
+    copy.region.bufferOffset = srcOffset;
+    copy.region.imageSubresource.aspectMask = aspect;
+    copy.region.imageSubresource.mipLevel = 0;
+    copy.region.imageSubresource.baseArrayLayer = 0;
+    copy.region.imageSubresource.layerCount = 1;
+    copy.region.imageExtent = extent;
+    mPendingImages.push_back(copy);
+    mStats.bytes += size;
+    ++mStats.copies;
+}
+
+void UploadEngine::Flush()
+{
+    if (mPendingBuffers.empty() && mPendingImages.empty())
+    {
+        return;
+    }
+
+    Batch& batch = mBatches[mNextBatch];
+    if (batch.submitted)
+    {
+        // 배치는 순서대로 제출되므로 재사용할 배치가 가장 오래된 배치
+        retireOldestBatch(true);
+    }
+    if (batch.consumed == false)
+    {
+        // 배치는 이미 끝났으므로 acquire만 다음 RecordAcquires로 넘김
+        mOrphanBufferAcquires.insert(mOrphanBufferAcquires.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+        mOrphanImageAcquires.insert(mOrphanImageAcquires.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+    }
+
+    recordBatch(batch);
+
+    batch.timelineValue = ++mSubmittedValue;
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &batch.timelineValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.cmd;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &mTimeline;
+    VkResult result = vkQueueSubmit(mQueue, 1, &submitInfo, VK_NULL_HANDLE);
+    VkUtil::ExitIfFailed(result, "fail vkQueueSubmit (upload)");
+
+    batch.submitted = true;
+    batch.consumed = false;
+    batch.ringEnd = mRingHead;
+    mNextBatch = (mNextBatch + 1) % BATCH_COUNT;
+    ++mInFlightCount;
+    ++mStats.submits;
+}
+
+void UploadEngine::RecordAcquires(VkCommandBuffer graphicsCmd, std::vector<VkSemaphore>& outWaitSemaphores,
+    std::vector<VkPipelineStageFlags>& outWaitStages, std::vector<uint64_t>& outWaitValues)
+{
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    bufferBarriers.swap(mOrphanBufferAcquires);
+    imageBarriers.swap(mOrphanImageAcquires);
+
+    // 제출된 순서대로, 마지막 배치 값 하나만 기다리면 앞 배치도 끝난 것
+    uint64_t waitValue = 0;
+    for (uint32_t i = 0; i < BATCH_COUNT; ++i)
+    {
+        Batch& batch = mBatches[(mNextBatch + i) % BATCH_COUNT];
+        if (batch.consumed)
+        {
+            continue;
+        }
+        waitValue = std::max(waitValue, batch.timelineValue);
+        bufferBarriers.insert(bufferBarriers.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+        imageBarriers.insert(imageBarriers.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+        batch.consumed = true;
+    }
+    if (waitValue > 0)
+    {
+        outWaitSemaphores.push_back(mTimeline);
+        outWaitStages.push_back(kConsumerStages);
+        outWaitValues.push_back(waitValue);
+    }
+
+    if (bufferBarriers.empty() && imageBarriers.empty())
+    {
+        return;
+    }
+    vkCmdPipelineBarrier(graphicsCmd, kConsumerStages, kConsumerStages, 0, 0, nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+bool UploadEngine::HasPendingAcquires() const
+{
+    if (mOrphanBufferAcquires.empty() == false || mOrphanImageAcquires.empty() == false)
+    {
+        return true;
+    }
+    for (const Batch& batch : mBatches)
+    {
+        if (batch.consumed == false && (batch.bufferAcquires.empty() == false || batch.imageAcquires.empty() == false))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void UploadEngine::WaitIdle()
+{
+    while (retireOldestBatch(true))
+    {
+    }
+}
+
+bool UploadEngine::IsDedicatedTransfer() const
+{
+    return mTransferFamilyIndex != mGraphicsFamilyIndex;
+}
+
+VkSemaphore UploadEngine::GetTimeline() const
+{
+    return mTimeline;
+}
+
+uint64_t UploadEngine::GetSubmittedValue() const
+{
+    return mSubmittedValue;
+}
+
+uint64_t UploadEngine::GetCompletedValue() const
+{
+    uint64_t value = 0;
+    vkGetSemaphoreCounterValue(mDevice, mTimeline, &value);
+    return value;
+}
+
+const UploadStats& UploadEngine::GetStats() const
+{
+    return mStats;
+}
+
+VkDeviceSize UploadEngine::allocateRing(VkDeviceSize size)
+{
+    size = alignUp(size, RING_ALIGNMENT);
+    VkUtil::ExitIfFalse(size <= mRingSize, "upload larger than the staging ring");
+
+    while (retireOldestBatch(false))
+    {
+    }
+
+    while (true)
+    {
+        // head == tail 은 항상 비어 있는 상태, 꽉 차는 경우가 없도록 tail 직전까지만 씀
+        VkDeviceSize offset = mRingHead;
+        bool fits = false;
+        if (mRingHead >= mRingTail)
+        {
+            if (mRingHead + size <= mRingSize)
+            {
+                fits = true;
+            }
+            else if (size < mRingTail)
+            {
+                // 끝부분은 건너뛰고 앞에서부터
+                offset = 0;
+                fits = true;
+            }
+        }
+        else if (mRingHead + size < mRingTail)
+        {
+            fits = true;
+        }
+
+        if (fits)
+        {
+            mRingHead = offset + size;
+            return offset;
+        }
+
+        // 공간이 없으면 쌓인 복사를 제출하고 가장 오래된 배치가 끝나길 기다림
+        Flush();
+        ++mStats.ringStalls;
+        retireOldestBatch(true);
+    }
+}
+
+bool UploadEngine::retireOldestBatch(bool wait)
+{
+    if (mInFlightCount == 0)
+    {
+        return false;
+    }
+
+    Batch& batch = mBatches[mOldestBatch];
+    if (wait)
+    {
+        VkUtil::WaitTimeline(mDevice, mTimeline, batch.timelineValue);
+    }
+    else if (GetCompletedValue() < batch.timelineValue)
+    {
+        return false;
+    }
+
+    batch.submitted = false;
+    mRingTail = batch.ringEnd;
+    mOldestBatch = (mOldestBatch + 1) % BATCH_COUNT;
+    --mInFlightCount;
+    if (mInFlightCount == 0 && mPendingBuffers.empty() && mPendingImages.empty())
+    {
+        mRingHead = 0;
+        mRingTail = 0;
+    }
+    return true;
+}
+
+void UploadEngine::recordBatch(Batch& batch)
+{
+    VkResult result = vkResetCommandPool(mDevice, batch.pool, 0);
+    VkUtil::ExitIfFailed(result, "fail vkResetCommandPool (upload)");
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    result = vkBeginCommandBuffer(batch.cmd, &beginInfo);
+    VkUtil::ExitIfFailed(result, "fail vkBeginCommandBuffer (upload)");
+
+    bool ownershipTransfer = IsDedicatedTransfer();
+    uint32_t srcFamily = ownershipTransfer ? mTransferFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+    uint32_t dstFamily = ownershipTransfer ? mGraphicsFamilyIndex : VK_QUEUE_FAMILY_IGNORED;
+
+    std::vector<VkImageMemoryBarrier> toTransfer;
+    for (const ImageCopy& copy : mPendingImages)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = copy.image;
+        barrier.subresourceRange = { copy.aspect, 0, 1, 0, 1 };
+        toTransfer.push_back(barrier);
+    }
+    if (toTransfer.empty() == false)
+    {
+        vkCmdPipelineBarrier(batch.cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr,
+            static_cast<uint32_t>(toTransfer.size()), toTransfer.data());
+    }
+
+    // 같은 대상 버퍼로 가는 복사는 vkCmdCopyBuffer 한 번으로
+    for (const BufferCopies& copies : mPendingBuffers)
+    {
+        vkCmdCopyBuffer(batch.cmd, mRingBuffer, copies.buffer, static_cast<uint32_t>(copies.regions.size()), copies.regions.data());
+    }
+    for (const ImageCopy& copy : mPendingImages)
+    {
+        vkCmdCopyBufferToImage(batch.cmd, mRingBuffer, copy.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy.region);
+    }
+
+    // 큐 패밀리가 다르면 release, 그래픽 큐에서 같은 값으로 acquire
+    // 같으면 세마포어가 메모리 의존성을 보장하므로 이미지 레이아웃 전환만 필요
+    std::vector<VkBufferMemoryBarrier> bufferReleases;
+    std::vector<VkImageMemoryBarrier> imageReleases;
+    batch.bufferAcquires.clear();
+    batch.imageAcquires.clear();
+    if (ownershipTransfer)
+    {
+        for (const BufferCopies& copies : mPendingBuffers)
+        {
+            VkDeviceSize begin = copies.regions[0].dstOffset;
+            VkDeviceSize end = begin;
+            for (const VkBufferCopy& region : copies.regions)
+            {
+                begin = std::min(begin, region.dstOffset);
+                end = std::max(end, region.dstOffset + region.size);
+            }
+
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = 0;
+            barrier.srcQueueFamilyIndex = srcFamily;
+            barrier.dstQueueFamilyIndex = dstFamily;
+            barrier.buffer = copies.buffer;
+            barrier.offset = begin;
+            barrier.size = end - begin;
+            bufferReleases.push_back(barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = kConsumerAccess;
+            batch.bufferAcquires.push_back(barrier);
+        }
+    }
+    for (const ImageCopy& copy : mPendingImages)
+    {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = copy.finalLayout;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+        barrier.image = copy.image;
+        barrier.subresourceRange = { copy.aspect, 0, 1, 0, 1 };
+        imageReleases.push_back(barrier);
+
+        if (ownershipTransfer)
+        {
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = kConsumerAccess;
+            batch.imageAcquires.push_back(barrier);
+        }
+    }
+    if (bufferReleases.empty() == false || imageReleases.empty() == false)
+    {
+        vkCmdPipelineBarrier(batch.cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+            static_cast<uint32_t>(bufferReleases.size()), bufferReleases.data(),
+            static_cast<uint32_t>(imageReleases.size()), imageReleases.data());
+    }
+
+    result = vkEndCommandBuffer(batch.cmd);
+    VkUtil::ExitIfFailed(result, "fail vkEndCommandBuffer (upload)");
+
+    mPendingBuffers.clear();
+    mPendingImages.clear();
+}
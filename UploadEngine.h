@@ -0,0 +1,118 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "MemoryAllocator.h"
+
+struct UploadStats
+{
+	uint64_t bytes;
+	uint64_t copies;
+	uint64_t submits;
+	// times an upload had to wait for the GPU to free ring space
+	uint64_t ringStalls;
+};
+
+// streams data to buffers and images through a persistently mapped staging ring,
+// copies are batched and submitted on the transfer queue, each batch signals the next
+// value of one transfer timeline semaphore
+class UploadEngine
+{
+public:
+	enum
+	{
+		BATCH_COUNT = 4,
+		RING_ALIGNMENT = 16
+	};
+
+	UploadEngine();
+
+	// transferQueue may be the graphics queue when the device has no transfer family
+	void Create(VkDevice device, MemoryAllocator& allocator, VkQueue transferQueue, uint32_t transferFamilyIndex,
+		uint32_t graphicsFamilyIndex, VkDeviceSize ringSize);
+	void Destroy();
+
+	// data is copied into the ring immediately, the GPU copy happens at the next Flush();
+	// buffers larger than half the ring are split into chunks
+	void UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+	// whole mip 0 of a 2D image, tightly packed texels; the image ends up in finalLayout
+	void UploadImage(VkImage dst, VkExtent3D extent, VkImageAspectFlags aspect, const void* data, VkDeviceSize size, VkImageLayout finalLayout);
+
+	// submit everything recorded since the last flush as one batch
+	void Flush();
+	// Records the graphics-side ownership acquire for every flushed batch that has not
+	// been consumed yet, and appends the timeline wait the graphics submit needs.
+	void RecordAcquires(VkCommandBuffer graphicsCmd, std::vector<VkSemaphore>& outWaitSemaphores,
+		std::vector<VkPipelineStageFlags>& outWaitStages, std::vector<uint64_t>& outWaitValues);
+	// RecordAcquires() would record barriers, a command buffer holding them must not be resubmitted;
+	// when false RecordAcquires() only hands out the timeline wait and graphicsCmd may be VK_NULL_HANDLE
+	bool HasPendingAcquires() const;
+	void WaitIdle();
+
+	bool IsDedicatedTransfer() const;
+	VkSemaphore GetTimeline() const;
+	uint64_t GetSubmittedValue() const;
+	uint64_t GetCompletedValue() const;
+	const UploadStats& GetStats() const;
+
+private:
+	struct BufferCopies
+	{
+		VkBuffer buffer;
+		std::vector<VkBufferCopy> regions;
+	};
+
+	struct ImageCopy
+	{
+		VkImage image;
+		VkImageAspectFlags aspect;
+		VkImageLayout finalLayout;
+		VkBufferImageCopy region;
+	};
+
+	struct Batch
+	{
+		VkCommandPool pool;
+		VkCommandBuffer cmd;
+		// transfer timeline value signaled by this batch's submit
+		uint64_t timelineValue;
+		bool submitted;
+		bool consumed;
+		// ring head when the batch was submitted, the tail moves here once it retires
+		VkDeviceSize ringEnd;
+		std::vector<VkBufferMemoryBarrier> bufferAcquires;
+		std::vector<VkImageMemoryBarrier> imageAcquires;
+	};
+
+	VkDevice mDevice;
+	MemoryAllocator* mAllocator;
+	VkQueue mQueue;
+	uint32_t mTransferFamilyIndex;
+	uint32_t mGraphicsFamilyIndex;
+	VkSemaphore mTimeline;
+	uint64_t mSubmittedValue;
+
+	VkBuffer mRingBuffer;
+	Allocation* mRingAllocation;
+	uint8_t* mRingData;
+	VkDeviceSize mRingSize;
+	VkDeviceSize mRingHead;
+	VkDeviceSize mRingTail;
+
+	Batch mBatches[BATCH_COUNT];
+	uint32_t mNextBatch;
+	// oldest submitted batch that has not retired yet
+	uint32_t mOldestBatch;
+	uint32_t mInFlightCount;
+
+	std::vector<BufferCopies> mPendingBuffers;
+	std::vector<ImageCopy> mPendingImages;
+	// acquires of batches reused before anyone recorded them
+	std::vector<VkBufferMemoryBarrier> mOrphanBufferAcquires;
+	std::vector<VkImageMemoryBarrier> mOrphanImageAcquires;
+
+	UploadStats mStats;
+
+	VkDeviceSize allocateRing(VkDeviceSize size);
+	bool retireOldestBatch(bool wait);
+	void recordBatch(Batch& batch);
+};
@@ -1,6 +1,6 @@
 
 #include "VkUtil.h"
-#include <iostream>
+#include "Logger.h"
 #include <filesystem>
 #include <fstream>
 #include <GLFW/glfw3.h>
@@ -114,7 +114,18 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VkUtil::DebugCallback(
         return VK_FALSE;
     }
 
-    std::cerr << "[Validation] " << data->pMessage << "\n";
+    if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    {
+        LOG_ERROR("[Validation] {}", msg);
+    }
+    else if (severity >= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+    {
+        LOG_WARNING("[Validation] {}", msg);
+    }
+    else
+    {
+        LOG_INFO("[Validation] {}", msg);
+    }
     return VK_FALSE;
 }
 
@@ -173,7 +184,8 @@ void VkUtil::ExitIfFalse(bool condition, const char* what)
     {
         return;
     }
-    std::cerr << what << std::endl;
+    LOG_ERROR("{}", what);
+    Logger::Flush();
     std::exit(EXIT_FAILURE);
 }
 
@@ -184,7 +196,8 @@ void VkUtil::ExitIfFailed(VkResult result, const char* what)
     {
         return;
 	}
-	std::cerr << what << " : " << ResultToString(result) << std::endl;
+	LOG_ERROR("{} : {}", what, ResultToString(result));
+	Logger::Flush();
 	std::exit(EXIT_FAILURE);
 }
 
@@ -202,8 +215,95 @@ std::vector<char> VkUtil::ReadFile(const char* filename)
 	}
     else
     {
-		std::cerr << "Failed to open file: " << filename << std::endl;
+		LOG_ERROR("Failed to open file: {}", filename);
     }
     return buffer;
 }
 
+uint32_t VkUtil::FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits, VkMemoryPropertyFlags properties)
+{
+    VkPhysicalDeviceMemoryProperties memProps{};
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProps);
+
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i)
+    {
+        if ((typeBits & (1u << i)) && (memProps.memoryTypes[i].propertyFlags & properties) == properties)
+        {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+VkImageView VkUtil::CreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect)
+{
+    VkImageViewCreateInfo ivCI{};
+    ivCI.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    ivCI.image = image;
+    ivCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    ivCI.format = format;
+    ivCI.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ivCI.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ivCI.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ivCI.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    ivCI.subresourceRange.aspectMask = aspect;
+    ivCI.subresourceRange.baseMipLevel = 0;
+    ivCI.subresourceRange.levelCount = 1;
+    ivCI.subresourceRange.baseArrayLayer = 0;
+    ivCI.subresourceRange.layerCount = 1;
+
+    VkImageView imageView = VK_NULL_HANDLE;
+    VkResult result = vkCreateImageView(device, &ivCI, nullptr, &imageView);
+    ExitIfFailed(result, "fail vkCreateImageView");
+    return imageView;
+}
+
+void VkUtil::TransitionImageLayout(VkCommandBuffer cmd, VkImage image, VkImageAspectFlags aspect,
+    VkImageLayout oldLayout, VkImageLayout newLayout,
+    VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = aspect;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+
+    vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+VkSemaphore VkUtil::CreateTimelineSemaphore(VkDevice device, uint64_t initialValue)
+{
+    VkSemaphoreTypeCreateInfo typeCI{};
+    typeCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeCI.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeCI.initialValue = initialValue;
+
+    VkSemaphoreCreateInfo semaphoreCI{};
+    semaphoreCI.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreCI.pNext = &typeCI;
+    VkSemaphore semaphore = VK_NULL_HANDLE;
+    VkResult result = vkCreateSemaphore(device, &semaphoreCI, nullptr, &semaphore);
+    ExitIfFailed(result, "fail vkCreateSemaphore (timeline)");
+    return semaphore;
+}
+
+void VkUtil::WaitTimeline(VkDevice device, VkSemaphore timeline, uint64_t value)
+{
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &timeline;
+    waitInfo.pValues = &value;
+    VkResult result = vkWaitSemaphores(device, &waitInfo, UINT64_MAX);
+    ExitIfFailed(result, "fail vkWaitSemaphores");
+}
@@ -27,6 +27,17 @@ public:
 
 	static std::vector<char> ReadFile(const char* filename);
 
+	static uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeBits, VkMemoryPropertyFlags properties);
+	static VkImageView CreateImageView(VkDevice device, VkImage image, VkFormat format, VkImageAspectFlags aspect);
+	static void TransitionImageLayout(VkCommandBuffer cmd, VkImage image, VkImageAspectFlags aspect,
+		VkImageLayout oldLayout, VkImageLayout newLayout,
+		VkPipelineStageFlags srcStage, VkAccessFlags srcAccess,
+		VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+	static VkSemaphore CreateTimelineSemaphore(VkDevice device, uint64_t initialValue);
+	// blocks until the timeline reaches value, returns immediately if it already has
+	static void WaitTimeline(VkDevice device, VkSemaphore timeline, uint64_t value);
+
 private:
 	static const std::vector<const char*> kValidationLayers;
 
@@ -0,0 +1,404 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "Renderer.h"
+#include "Scene.h"
+#include "Logger.h"
+
+// 프레임 벤치마크 : 고정 프레임 수 또는 고정 시간 동안 렌더링 후 JSON으로 결과 출력
+//   bench [--headless] [--frames N | --duration SEC] [--warmup N] [--frames-in-flight N] [--pipeline-stats] [--instances N] [--record-threads N] [--per-instance-draws] [--reuse-commands] [--depth-prepass] [--animate-scene] [--out FILE]
+
+struct BenchOptions
+{
+    bool headless = false;
+    uint32_t frames = 1000;
+    double durationSec = 0.0;   // 0이면 frames 기준
+    uint32_t warmup = 30;
+    uint32_t framesInFlight = 2;
+    bool pipelineStatistics = false;
+    uint32_t instances = 0;     // 0이면 기본 인스턴스 하나
+    uint32_t recordThreads = 0; // 0이면 메인 스레드만
+    bool perInstanceDraws = false; // 인스턴스마다 드로우 하나 - 기록 스레드가 나눌 만큼 드로우가 생김
+    bool reuseCommands = false;
+    bool depthPrepass = false;
+    bool animateScene = false;  // 인스턴스 격자를 계층으로 묶고 매 프레임 회전
+    const char* outPath = nullptr;
+};
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty())
+    {
+        return 0.0;
+    }
+    // nearest-rank
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+    rank = std::clamp<size_t>(rank, 1, sorted.size());
+    return sorted[rank - 1];
+}
+
+static double sum(const std::vector<double>& values)
+{
+    double total = 0.0;
+    for (double v : values)
+    {
+        total += v;
+    }
+    return total;
+}
+
+// 실행하는 동안 stdout을 stderr로 돌림 - 렌더러, 드라이버, 자식 프로세스(glslc)가 stdout에
+// 무엇을 쓰든 JSON과 섞이지 않음. 원래 stdout의 복제본을 돌려줌
+static int redirectStdoutToStderr()
+{
+    std::cout.flush();
+    std::fflush(stdout);
+#ifdef _WIN32
+    int saved = _dup(_fileno(stdout));
+    _dup2(_fileno(stderr), _fileno(stdout));
+#else
+    int saved = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+    return saved;
+}
+
+static void restoreStdout(int saved)
+{
+    if (saved < 0)
+    {
+        return;
+    }
+    std::cout.flush();
+    std::fflush(stdout);
+#ifdef _WIN32
+    _dup2(saved, _fileno(stdout));
+    _close(saved);
+#else
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+#endif
+}
+
+static BenchOptions parseArgs(int argc, char** argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            options.headless = true;
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            options.frames = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc)
+        {
+            options.durationSec = std::atof(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+        {
+            options.warmup = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            options.framesInFlight = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--pipeline-stats") == 0)
+        {
+            options.pipelineStatistics = true;
+        }
+        else if (std::strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+        {
+            options.instances = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--record-threads") == 0 && i + 1 < argc)
+        {
+            options.recordThreads = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--per-instance-draws") == 0)
+        {
+            options.perInstanceDraws = true;
+        }
+        else if (std::strcmp(argv[i], "--reuse-commands") == 0)
+        {
+            options.reuseCommands = true;
+        }
+        else if (std::strcmp(argv[i], "--depth-prepass") == 0)
+        {
+            options.depthPrepass = true;
+        }
+        else if (std::strcmp(argv[i], "--animate-scene") == 0)
+        {
+            options.animateScene = true;
+        }
+        else if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+        {
+            options.outPath = argv[++i];
+        }
+        else
+        {
+            std::cerr << "unknown argument: " << argv[i] << std::endl;
+        }
+    }
+    return options;
+}
+
+int main(int argc, char** argv)
+{
+    using Clock = std::chrono::steady_clock;
+
+    BenchOptions options = parseArgs(argc, argv);
+    int jsonOut = redirectStdoutToStderr();
+    // stdout에는 결과 JSON만 나가도록 로그는 전부 stderr로 보냄
+    Logger::SetStderrOnly(true);
+    Logger::Start();
+
+    RendererConfig config;
+    config.headless = options.headless;
+    config.framesInFlight = options.framesInFlight;
+    config.pipelineStatistics = options.pipelineStatistics;
+    config.recordThreads = options.recordThreads;
+    config.perInstanceDraws = options.perInstanceDraws;
+    config.reuseCommandBuffers = options.reuseCommands;
+    config.depthPrepass = options.depthPrepass;
+    Renderer renderer(config);
+
+    // 루트 - 행 - 인스턴스 계층, 인스턴스 노드만 회전시킴
+    Scene scene;
+    std::vector<SceneNode> animatedNodes;
+    if (options.instances > 0)
+    {
+        // 화면을 채우는 정사각 격자
+        InstanceBuffer& instances = renderer.GetInstances();
+        instances.Clear();
+        uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(options.instances))));
+        float cell = 2.0f / side;
+        SceneNode root = options.animateScene ? scene.AddNode(INVALID_SCENE_NODE, INVALID_INSTANCE) : INVALID_SCENE_NODE;
+        SceneNode row = INVALID_SCENE_NODE;
+        for (uint32_t i = 0; i < options.instances; ++i)
+        {
+            float x = -1.0f + cell * (i % side + 0.5f);
+            float y = -1.0f + cell * (i / side + 0.5f);
+            InstanceData data = { { cell, 0.0f, 0.0f, x,  0.0f, cell, 0.0f, y,  0.0f, 0.0f, cell, 0.0f },
+                { static_cast<float>(i % side) / side, static_cast<float>(i / side) / side, 1.0f, 1.0f } };
+            InstanceHandle instance = instances.Add(data);
+
+            if (options.animateScene)
+            {
+                if (i % side == 0)
+                {
+                    row = scene.AddNode(root, INVALID_INSTANCE);
+                    scene.SetPosition(row, 0.0f, y, 0.0f);
+                }
+                SceneNode node = scene.AddNode(row, instance);
+                scene.SetPosition(node, x, 0.0f, 0.0f);
+                scene.SetScale(node, cell, cell, cell);
+                animatedNodes.push_back(node);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < options.warmup && renderer.ShouldClose() == false; ++i)
+    {
+        renderer.RenderFrame();
+    }
+
+    std::vector<double> frameMs;
+    std::vector<double> waitGpuMs;
+    std::vector<double> gpuFramesBehind;
+    std::vector<double> acquireMs;
+    std::vector<double> recordMs;
+    std::vector<double> recordSlices;
+    std::vector<double> submitMs;
+    std::vector<double> presentMs;
+    std::vector<double> gpuFrameMs;
+    std::vector<double> sceneUpdateMs;
+    uint64_t lastGpuFrame = UINT64_MAX;
+    GpuFrameStats lastGpuStats{};
+    if (options.durationSec <= 0.0)
+    {
+        frameMs.reserve(options.frames);
+    }
+
+    Clock::time_point benchStart = Clock::now();
+    while (renderer.ShouldClose() == false)
+    {
+        double elapsedSec = std::chrono::duration<double>(Clock::now() - benchStart).count();
+        if (options.durationSec > 0.0 ? elapsedSec >= options.durationSec : frameMs.size() >= options.frames)
+        {
+            break;
+        }
+
+        if (options.animateScene && animatedNodes.empty() == false)
+        {
+            // z축 회전, 노드마다 위상을 다르게
+            float time = static_cast<float>(frameMs.size()) * 0.02f;
+            for (size_t n = 0; n < animatedNodes.size(); ++n)
+            {
+                float half = 0.5f * (time + static_cast<float>(n) * 0.1f);
+                scene.SetRotation(animatedNodes[n], 0.0f, 0.0f, std::sin(half), std::cos(half));
+            }
+            Clock::time_point sceneStart = Clock::now();
+            scene.Update(renderer.GetInstances());
+            sceneUpdateMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - sceneStart).count());
+        }
+
+        Clock::time_point frameStart = Clock::now();
+        renderer.RenderFrame();
+        frameMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count());
+
+        const FrameTimings& timings = renderer.GetLastFrameTimings();
+        waitGpuMs.push_back(timings.waitGpuMs);
+        gpuFramesBehind.push_back(static_cast<double>(timings.gpuFramesBehind));
+        acquireMs.push_back(timings.acquireMs);
+        recordMs.push_back(timings.recordMs);
+        recordSlices.push_back(static_cast<double>(timings.recordSlices));
+        submitMs.push_back(timings.submitMs);
+        presentMs.push_back(timings.presentMs);
+
+        // GPU 결과는 몇 프레임 늦게 들어옴
+        const GpuFrameStats* gpuStats = renderer.GetGpuProfiler().GetLatest();
+        if (gpuStats != nullptr && gpuStats->frameNumber != lastGpuFrame)
+        {
+            lastGpuFrame = gpuStats->frameNumber;
+            gpuFrameMs.push_back(gpuStats->frameMs);
+            lastGpuStats = *gpuStats;
+        }
+    }
+    double totalSec = std::chrono::duration<double>(Clock::now() - benchStart).count();
+
+    StartupMetrics startup = renderer.GetStartupMetrics();
+    std::vector<PipelineCompileStats> pipelines = renderer.GetPipelineStats();
+    PipelineLibraryStats library = renderer.GetPipelineLibraryStats();
+    CommandReuseStats reuse = renderer.GetCommandReuseStats();
+    MemoryStats memory = renderer.GetMemoryStats();
+    RenderGraphStats graph = renderer.GetRenderGraphStats();
+    DrawListStats draws = renderer.GetDrawStats();
+    renderer.Shutdown();
+    // 결과 JSON과 섞이지 않게 남은 로그를 먼저 씀
+    Logger::Stop();
+    restoreStdout(jsonOut);
+
+    std::vector<double> sorted = frameMs;
+    std::sort(sorted.begin(), sorted.end());
+    size_t frameCount = frameMs.size();
+    double count = frameCount > 0 ? static_cast<double>(frameCount) : 1.0;
+
+    std::ostringstream json;
+    json << "{\n"
+        << "  \"headless\": " << (options.headless ? "true" : "false") << ",\n"
+        << "  \"instances\": " << (options.instances > 0 ? options.instances : 1) << ",\n"
+        << "  \"frames_in_flight\": " << options.framesInFlight << ",\n"
+        << "  \"record_threads\": " << options.recordThreads << ",\n"
+        << "  \"per_instance_draws\": " << (options.perInstanceDraws ? "true" : "false") << ",\n"
+        << "  \"depth_prepass\": " << (options.depthPrepass ? "true" : "false") << ",\n"
+        << "  \"command_reuse\": { \"reused_frames\": " << reuse.reusedFrames << ", \"recorded_frames\": " << reuse.recordedFrames << " },\n"
+        << "  \"frames\": " << frameCount << ",\n"
+        << "  \"duration_sec\": " << totalSec << ",\n"
+        << "  \"fps\": " << (totalSec > 0.0 ? frameCount / totalSec : 0.0) << ",\n"
+        << "  \"frame_ms\": {\n"
+        << "    \"mean\": " << sum(frameMs) / count << ",\n"
+        << "    \"p50\": " << percentile(sorted, 50.0) << ",\n"
+        << "    \"p95\": " << percentile(sorted, 95.0) << ",\n"
+        << "    \"p99\": " << percentile(sorted, 99.0) << ",\n"
+        << "    \"max\": " << (sorted.empty() ? 0.0 : sorted.back()) << "\n"
+        << "  },\n"
+        << "  \"stage_mean_ms\": {\n"
+        << "    \"wait_gpu\": " << sum(waitGpuMs) / count << ",\n"
+        << "    \"acquire\": " << sum(acquireMs) / count << ",\n"
+        << "    \"record\": " << sum(recordMs) / count << ",\n"
+        << "    \"submit\": " << sum(submitMs) / count << ",\n"
+        << "    \"present\": " << sum(presentMs) / count << "\n"
+        << "  },\n"
+        << "  \"record_slices\": { \"mean\": " << sum(recordSlices) / count
+        << ", \"max\": " << (recordSlices.empty() ? 0.0 : *std::max_element(recordSlices.begin(), recordSlices.end())) << " },\n"
+        << "  \"gpu_frames_behind\": { \"mean\": " << sum(gpuFramesBehind) / count
+        << ", \"max\": " << (gpuFramesBehind.empty() ? 0.0 : *std::max_element(gpuFramesBehind.begin(), gpuFramesBehind.end())) << " },\n"
+        << "  \"startup\": {\n"
+        << "    \"pipeline_cache_warm\": " << (startup.pipelineCacheWarm ? "true" : "false") << ",\n"
+        << "    \"pipeline_cache_bytes\": " << startup.pipelineCacheLoadedBytes << ",\n"
+        << "    \"pipeline_creation_ms\": " << startup.pipelineCreationMs << "\n"
+        << "  },\n"
+        << "  \"pipelines\": [";
+    for (size_t i = 0; i < pipelines.size(); ++i)
+    {
+        const PipelineCompileStats& pipeline = pipelines[i];
+        json << (i > 0 ? ",\n" : "\n")
+            << "    { \"name\": \"" << pipeline.name << "\", \"ready\": " << (pipeline.ready ? "true" : "false")
+            << ", \"queued_ms\": " << pipeline.queuedMs << ", \"compile_ms\": " << pipeline.compileMs
+            << ", \"cache_hit\": " << (pipeline.cacheHit ? "true" : "false") << " }";
+    }
+    json << (pipelines.empty() ? "],\n" : "\n  ],\n")
+        << "  \"pipeline_library\": { \"hits\": " << library.hits << ", \"misses\": " << library.misses << " },\n"
+        << "  \"memory\": {\n"
+        << "    \"blocks\": " << memory.blockCount << ",\n"
+        << "    \"dedicated\": " << memory.dedicatedCount << ",\n"
+        << "    \"used_bytes\": " << memory.usedBytes << ",\n"
+        << "    \"wasted_bytes\": " << memory.wastedBytes << ",\n"
+        << "    \"fragmented_bytes\": " << memory.fragmentedBytes << "\n"
+        << "  },\n"
+        << "  \"render_graph\": { \"passes\": " << graph.passCount << ", \"culled\": " << graph.culledPassCount
+        << ", \"levels\": " << graph.levelCount << ", \"barrier_batches\": " << graph.barrierBatchCount
+        << ", \"image_barriers\": " << graph.imageBarrierCount << ", \"transient_images\": " << graph.transientImageCount
+        << ", \"transient_bytes\": " << graph.transientBytes << ", \"aliased_bytes\": " << graph.aliasedBytes << " },\n"
+        << "  \"draw_binds\": {\n"
+        << "    \"draws\": " << draws.draws << ",\n"
+        << "    \"pipeline\": { \"issued\": " << draws.pipelineBinds << ", \"skipped\": " << draws.pipelineBindsSkipped << " },\n"
+        << "    \"descriptor_set\": { \"issued\": " << draws.descriptorBinds << ", \"skipped\": " << draws.descriptorBindsSkipped << " },\n"
+        << "    \"vertex_buffer\": { \"issued\": " << draws.vertexBufferBinds << ", \"skipped\": " << draws.vertexBufferBindsSkipped << " },\n"
+        << "    \"push_constants\": { \"issued\": " << draws.pushConstants << ", \"skipped\": " << draws.pushConstantsSkipped << " }\n"
+        << "  },\n"
+        << "  \"scene\": { \"nodes\": " << scene.GetCount() << ", \"world_updates\": " << scene.GetStats().worldUpdates
+        << ", \"instance_writes\": " << scene.GetStats().instanceWrites
+        << ", \"update_ms_mean\": " << (sceneUpdateMs.empty() ? 0.0 : sum(sceneUpdateMs) / sceneUpdateMs.size()) << " },\n"
+        << "  \"gpu_frame_ms_mean\": " << (gpuFrameMs.empty() ? 0.0 : sum(gpuFrameMs) / gpuFrameMs.size()) << ",\n"
+        << "  \"pipeline_statistics\": ";
+    if (lastGpuStats.hasPipelineStatistics)
+    {
+        json << "{\n"
+            << "    \"ia_vertices\": " << lastGpuStats.inputAssemblyVertices << ",\n"
+            << "    \"ia_primitives\": " << lastGpuStats.inputAssemblyPrimitives << ",\n"
+            << "    \"vs_invocations\": " << lastGpuStats.vertexShaderInvocations << ",\n"
+            << "    \"clipping_invocations\": " << lastGpuStats.clippingInvocations << ",\n"
+            << "    \"clipping_primitives\": " << lastGpuStats.clippingPrimitives << ",\n"
+            << "    \"fs_invocations\": " << lastGpuStats.fragmentShaderInvocations << "\n"
+            << "  }\n";
+    }
+    else
+    {
+        json << "null\n";
+    }
+    json << "}\n";
+
+    if (options.outPath != nullptr)
+    {
+        std::ofstream file(options.outPath);
+        if (file.is_open() == false)
+        {
+            std::cerr << "Failed to open file: " << options.outPath << std::endl;
+            return EXIT_FAILURE;
+        }
+        file << json.str();
+    }
+    else
+    {
+        std::cout << json.str();
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,20 @@
+@echo off
+rem Compiles the GLSL sources into the .spv files the renderer loads (RendererConfig paths) and
+rem validates them with spirv-val. The renderer runs the same step at startup for any .spv that is
+rem missing or older than its source (ShaderRegistry::Build); the .spv files are not committed.
+setlocal
+cd /d "%~dp0"
+set GLSLC=glslc
+set SPIRV_VAL=spirv-val
+if defined VULKAN_SDK set GLSLC="%VULKAN_SDK%\Bin\glslc.exe"
+if defined VULKAN_SDK set SPIRV_VAL="%VULKAN_SDK%\Bin\spirv-val.exe"
+
+call :compile shader.vert vert.spv || exit /b 1
+call :compile shader.frag frag.spv || exit /b 1
+call :compile cull.comp cull.spv || exit /b 1
+exit /b 0
+
+:compile
+%GLSLC% --target-env=vulkan1.3 -O %1 -o %2 || exit /b 1
+%SPIRV_VAL% --target-env vulkan1.3 %2 || (del %2 & exit /b 1)
+exit /b 0
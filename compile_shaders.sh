@@ -0,0 +1,23 @@
+#!/bin/sh
+# Compiles the GLSL sources into the .spv files the renderer loads (RendererConfig paths) and
+# validates them with spirv-val. The renderer runs the same step at startup for any .spv that is
+# missing or older than its source (ShaderRegistry::Build); the .spv files are not committed.
+set -e
+cd "$(dirname "$0")"
+GLSLC="${GLSLC:-glslc}"
+SPIRV_VAL="${SPIRV_VAL:-spirv-val}"
+if [ -n "$VULKAN_SDK" ] && [ -x "$VULKAN_SDK/bin/glslc" ]; then
+    GLSLC="$VULKAN_SDK/bin/glslc"
+fi
+if [ -n "$VULKAN_SDK" ] && [ -x "$VULKAN_SDK/bin/spirv-val" ]; then
+    SPIRV_VAL="$VULKAN_SDK/bin/spirv-val"
+fi
+
+compile() {
+    "$GLSLC" --target-env=vulkan1.3 -O "$1" -o "$2"
+    "$SPIRV_VAL" --target-env vulkan1.3 "$2" || { rm -f "$2"; exit 1; }
+}
+
+compile shader.vert vert.spv
+compile shader.frag frag.spv
+compile cull.comp cull.spv
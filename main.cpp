@@ -8,17 +8,37 @@
 
 #include <iostream>
 #include <filesystem> 
+#include <cstring>
 
 #include "Renderer.h"
+#include "Logger.h"
 
 
 
-int main() 
+int main(int argc, char** argv) 
 {
-
-    Renderer renderer;
+    Logger::Start();
+    RendererConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--headless") == 0)
+        {
+            config.headless = true;
+        }
+        else if (std::strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            config.headlessFrameCount = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc)
+        {
+            config.framesInFlight = static_cast<uint32_t>(std::atoi(argv[++i]));
+        }
+    }
+
+    Renderer renderer(config);
 	renderer.Run();
 
+    Logger::Stop();
     return EXIT_SUCCESS;
 }
 
@@ -1,5 +1,20 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+layout(location = 0) in vec3 inNormal;
+layout(location = 1) in vec2 inUV;
+layout(location = 2) in vec4 inColor;
+layout(location = 3) flat in uint inTextureIndex;
+layout(location = 4) flat in uint inSamplerIndex;
 layout(location = 0) out vec4 outColor;
+
+// BindlessHeap, bound once per command buffer
+layout(set = 2, binding = 0) uniform texture2D textures[];
+layout(set = 2, binding = 1) uniform sampler samplers[];
+
 void main() {
-    outColor = vec4(1.0, 0.5, 0.2, 1.0);
+    // Vulkan clip space looks down +z, so -z faces the camera
+    float light = 0.3 + 0.7 * max(dot(normalize(inNormal), normalize(vec3(0.3, -0.5, -1.0))), 0.0);
+    // instances of one draw may use different textures
+    vec4 albedo = texture(sampler2D(textures[nonuniformEXT(inTextureIndex)], samplers[nonuniformEXT(inSamplerIndex)]), inUV);
+    outColor = vec4(vec3(1.0, 0.5, 0.2) * albedo.rgb * inColor.rgb * light, albedo.a * inColor.a);
 }
\ No newline at end of file
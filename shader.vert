@@ -1,11 +1,68 @@
-
 #version 450
 
-vec2 positions[3] = vec2[](
-    vec2( 0.0, -0.5),
-    vec2( 0.5,  0.5),
-    vec2(-0.5,  0.5)
-);
+// MeshVertex : unorm16 position, octahedral snorm16 normal, half uv
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inUV;
+
+// InstanceData : 3x4 affine transform rows, color, mesh index, bindless texture / sampler slots
+struct InstanceData {
+    vec4 rows[3];
+    vec4 color;
+    uint meshIndex;
+    uint textureIndex;
+    uint samplerIndex;
+};
+layout(std430, set = 0, binding = 0) readonly buffer Instances {
+    InstanceData instances[];
+};
+
+// written by cull.comp, each mesh's draw starts at its bucket through firstInstance
+layout(std430, set = 1, binding = 1) readonly buffer Visible {
+    uint visible[];
+};
+
+// FrameConstants : written once per frame into the FrameAllocator ring
+layout(std140, set = 3, binding = 0) uniform FrameConstants {
+    mat4 viewProjection;
+} frame;
+
+// DrawConstants : MeshDecode, whether instances go through the visible list
+layout(push_constant) uniform DrawConstants {
+    vec4 positionOffset;
+    vec4 positionScale;
+    uint culled;
+} draw;
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 outUV;
+layout(location = 2) out vec4 outColor;
+layout(location = 3) flat out uint outTextureIndex;
+layout(location = 4) flat out uint outSamplerIndex;
+
+// the depth prepass runs this shader too, the EQUAL depth test needs bit-identical positions
+invariant gl_Position;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
+    uint objectIndex = draw.culled != 0 ? visible[gl_InstanceIndex] : uint(gl_InstanceIndex);
+    InstanceData instance = instances[objectIndex];
+    vec4 local = vec4(draw.positionOffset.xyz + inPosition.xyz * draw.positionScale.xyz, 1.0);
+    vec3 world = vec3(dot(instance.rows[0], local), dot(instance.rows[1], local), dot(instance.rows[2], local));
+    gl_Position = frame.viewProjection * vec4(world, 1.0);
+
+    // uniform scale assumed, no inverse transpose
+    vec3 normal = octDecode(inNormal);
+    outNormal = vec3(dot(instance.rows[0].xyz, normal), dot(instance.rows[1].xyz, normal), dot(instance.rows[2].xyz, normal));
+    outUV = inUV;
+    outColor = instance.color;
+    outTextureIndex = instance.textureIndex;
+    outSamplerIndex = instance.samplerIndex;
 }
\ No newline at end of file